@@ -11,67 +11,40 @@ void nex_PDO_Send_Receive(int wkc)
 }
 
 
+/* PDO mapping of the drives, written only if the drive holds another one */
+static const nex_PDOobjt DrivePDOobj[] =
+{
+	{ 0x1600, 3, { 0x60400010, 0x607A0020, 0x60B80010 } },//keywords, targetposition, touchproble
+	{ 0x1c12, 1, { 0x1600 } },
+	{ 0x1A00, 7, { 0x603F0010, 0x60410010, 0x60610008, 0x60640020, 0x60B90010, 0x60BA0020, 0x60FD0020 } },
+	{ 0x1c13, 1, { 0x1A00 } },
+};
+
+static const nex_PDOprofilet DrivePDOprofile[] =
+{
+	{ 0, 0, 0, sizeof(DrivePDOobj) / sizeof(DrivePDOobj[0]), DrivePDOobj },//any device
+};
+
 int nex_MasterPDOmapping(uint16 slave)
 {
+	const nex_PDOprofilet *profile;
 	int retval;
 	uint8 u8val;
-	uint16 u16val;
-	uint32 u32val;
-	uint16 SM2_PDO_OUT = 0x1600;
-	uint16 SM3_PDO_INPUT = 0x1A00;
-	retval = 0;
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u32val = 0x60400010;//keywords
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x01, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x607A0020;//targetposition
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x02, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60B80010;//touchproble
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x03, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u8val = 3;//
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, 0x1c12, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u16val = SM2_PDO_OUT;//
-	retval += nex_SDOwrite(slave, 0x1c12, 0x01, FALSE, sizeof(u16val), &u16val, NEX_TIMEOUTRXM);
-	u8val = 1;
-	retval += nex_SDOwrite(slave, 0x1c12, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u32val = 0x603F0010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x01, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60410010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x02, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60610008;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x03, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60640020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x04, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60B90010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x05, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60BA0020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x06, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60FD0020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x07, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u8val = 7;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, 0x1c13, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u16val = SM3_PDO_INPUT;//
-	retval += nex_SDOwrite(slave, 0x1c13, 0x01, FALSE, sizeof(u16val), &u16val, NEX_TIMEOUTRXM);
-	u8val = 1;
-	retval += nex_SDOwrite(slave, 0x1c13, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
+
+	retval = -1;
+	profile = nex_PDOprofile_find(slave, DrivePDOprofile, sizeof(DrivePDOprofile) / sizeof(DrivePDOprofile[0]));
+	if (profile)
+	{
+		retval = nex_PDOprofile_apply(slave, profile, NEX_TIMEOUTRXM);
+	}
 
 	u8val = 8;//operation model
-	retval += nex_SDOwrite(slave, 0x6060, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
+	nex_SDOwrite(slave, 0x6060, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
 
 	while (EcatError) debug_PRINT("%s", nex_elist2string());
 
-	debug_PRINT("have %d slave set, retval = %d\n", slave, retval);
-	return 0;
+	debug_PRINT("have %d slave set, PDO objects written = %d\n", slave, retval);
+	return (retval < 0) ? -1 : 0;
 }
 
 
@@ -131,11 +104,19 @@ int nex_RequestStatus(uint16 reqstate)
 int nex_MasterCheck(boolean inOP, int wkc, int expectedWKC)
 {
 	int slave;
+	int i, nsuspect;
+	uint16 suspect[NEX_MAXSLAVE];
 	uint8 currentgroup = 0;
 	if (inOP && ((wkc < expectedWKC) || nex_group[currentgroup].docheckstate))
 	{
 		// one ore more slaves are not responding 
 		nex_group[currentgroup].docheckstate = FALSE;
+		// report the slaves in the IO segments that returned a low workcounter
+		nsuspect = nex_suspectslaves(currentgroup, suspect, NEX_MAXSLAVE);
+		for (i = 0; i < nsuspect; i++)
+		{
+			debug_PRINT("WARNING : slave %d in IO segment with low workcounter\n", suspect[i]);
+		}
 		nex_readstate();
 		for (slave = 1; slave <= nex_slavecount; slave++)
 		{
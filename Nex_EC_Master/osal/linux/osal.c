@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <osal.h>
 
 #define USECS_PER_SEC     1000000
@@ -99,6 +100,81 @@ void osal_free(void *ptr)
    free(ptr);
 }
 
+/* IOmap memory is page aligned, locked in memory and backed by transparent
+ * huge pages when the kernel supports it.
+ */
+void *osal_iomap_alloc(size_t size)
+{
+   void *ptr;
+
+   ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (ptr == MAP_FAILED)
+   {
+      return NULL;
+   }
+#ifdef MADV_HUGEPAGE
+   madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+   /* best effort, fails without CAP_IPC_LOCK or RLIMIT_MEMLOCK */
+   mlock(ptr, size);
+   return ptr;
+}
+
+void osal_iomap_free(void *ptr, size_t size)
+{
+   if (ptr)
+   {
+      munlock(ptr, size);
+      munmap(ptr, size);
+   }
+}
+
+/* Atomic operations for the lock-free exchange between the RT thread and
+ * application threads. Load has acquire and store has release semantics,
+ * the read-modify-write operations are full barriers.
+ */
+uint32 osal_atomic_load(volatile uint32 *ptr)
+{
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void osal_atomic_store(volatile uint32 *ptr, uint32 value)
+{
+   __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+uint32 osal_atomic_exchange(volatile uint32 *ptr, uint32 value)
+{
+   return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+boolean osal_atomic_cas(volatile uint32 *ptr, uint32 expected, uint32 desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired, FALSE,
+      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? TRUE : FALSE;
+}
+
+uint32 osal_atomic_add(volatile uint32 *ptr, uint32 value)
+{
+   return __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+void osal_atomic_fence(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void *osal_atomic_exchangeptr(void *volatile *ptr, void *value)
+{
+   return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+boolean osal_atomic_casptr(void *volatile *ptr, void *expected, void *desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired, FALSE,
+      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? TRUE : FALSE;
+}
+
 int osal_thread_create(void *thandle, int stacksize, void *func, void *param)
 {
    int                  ret;
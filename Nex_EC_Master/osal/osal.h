@@ -12,6 +12,7 @@ extern "C"
 #endif
 
 #include "osal_defs.h"
+#include <stddef.h>
 #include <stdint.h>
 
 /* General types */
@@ -47,6 +48,18 @@ nex_timet osal_current_time(void);
 void osal_time_diff(nex_timet *start, nex_timet *end, nex_timet *diff);
 int osal_thread_create(void *thandle, int stacksize, void *func, void *param);
 int osal_thread_create_rt(void *thandle, int stacksize, void *func, void *param);
+void *osal_malloc(size_t size);
+void osal_free(void *ptr);
+void *osal_iomap_alloc(size_t size);
+void osal_iomap_free(void *ptr, size_t size);
+uint32 osal_atomic_load(volatile uint32 *ptr);
+void osal_atomic_store(volatile uint32 *ptr, uint32 value);
+uint32 osal_atomic_exchange(volatile uint32 *ptr, uint32 value);
+boolean osal_atomic_cas(volatile uint32 *ptr, uint32 expected, uint32 desired);
+uint32 osal_atomic_add(volatile uint32 *ptr, uint32 value);
+void osal_atomic_fence(void);
+void *osal_atomic_exchangeptr(void *volatile *ptr, void *value);
+boolean osal_atomic_casptr(void *volatile *ptr, void *expected, void *desired);
 
 #ifdef __cplusplus
 }
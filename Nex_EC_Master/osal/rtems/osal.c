@@ -99,6 +99,62 @@ void osal_free(void *ptr)
    free(ptr);
 }
 
+void *osal_iomap_alloc(size_t size)
+{
+   return malloc(size);
+}
+
+void osal_iomap_free(void *ptr, size_t size)
+{
+   free(ptr);
+}
+
+/* Atomic operations for the lock-free exchange between the RT thread and
+ * application threads. Load has acquire and store has release semantics,
+ * the read-modify-write operations are full barriers.
+ */
+uint32 osal_atomic_load(volatile uint32 *ptr)
+{
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void osal_atomic_store(volatile uint32 *ptr, uint32 value)
+{
+   __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+uint32 osal_atomic_exchange(volatile uint32 *ptr, uint32 value)
+{
+   return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+boolean osal_atomic_cas(volatile uint32 *ptr, uint32 expected, uint32 desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired, FALSE,
+      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? TRUE : FALSE;
+}
+
+uint32 osal_atomic_add(volatile uint32 *ptr, uint32 value)
+{
+   return __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+void osal_atomic_fence(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void *osal_atomic_exchangeptr(void *volatile *ptr, void *value)
+{
+   return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+boolean osal_atomic_casptr(void *volatile *ptr, void *expected, void *desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired, FALSE,
+      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? TRUE : FALSE;
+}
+
 int osal_thread_create(void *thandle, int stacksize, void *func, void *param)
 {
    int                  ret;
@@ -103,6 +103,90 @@ void osal_free(void *ptr)
    free(ptr);
 }
 
+/* IOmap memory is page aligned, locked in memory and uses large pages
+ * when the process holds SeLockMemoryPrivilege and the IOmap is big enough.
+ */
+void *osal_iomap_alloc(size_t size)
+{
+   void *ptr = NULL;
+   SIZE_T largepage;
+
+   largepage = GetLargePageMinimum();
+   if (largepage && (size >= largepage))
+   {
+      ptr = VirtualAlloc(NULL, (size + largepage - 1) & ~(largepage - 1),
+         MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+   }
+   if (!ptr)
+   {
+      ptr = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+      if (ptr)
+      {
+         /* best effort, fails if working set is too small */
+         VirtualLock(ptr, size);
+      }
+   }
+   return ptr;
+}
+
+void osal_iomap_free(void *ptr, size_t size)
+{
+   if (ptr)
+   {
+      VirtualUnlock(ptr, size);
+      VirtualFree(ptr, 0, MEM_RELEASE);
+   }
+}
+
+/* Atomic operations for the lock-free exchange between the RT thread and
+ * application threads. Load has acquire and store has release semantics,
+ * the read-modify-write operations are full barriers.
+ */
+uint32 osal_atomic_load(volatile uint32 *ptr)
+{
+   uint32 value;
+
+   value = *ptr;
+   MemoryBarrier();
+   return value;
+}
+
+void osal_atomic_store(volatile uint32 *ptr, uint32 value)
+{
+   MemoryBarrier();
+   *ptr = value;
+}
+
+uint32 osal_atomic_exchange(volatile uint32 *ptr, uint32 value)
+{
+   return (uint32)InterlockedExchange((volatile LONG *)ptr, (LONG)value);
+}
+
+boolean osal_atomic_cas(volatile uint32 *ptr, uint32 expected, uint32 desired)
+{
+   return (InterlockedCompareExchange((volatile LONG *)ptr, (LONG)desired, (LONG)expected) == (LONG)expected);
+}
+
+uint32 osal_atomic_add(volatile uint32 *ptr, uint32 value)
+{
+   return (uint32)InterlockedExchangeAdd((volatile LONG *)ptr, (LONG)value) + value;
+}
+
+void osal_atomic_fence(void)
+{
+   MemoryBarrier();
+}
+
+void *osal_atomic_exchangeptr(void *volatile *ptr, void *value)
+{
+   return InterlockedExchangePointer(ptr, value);
+}
+
+boolean osal_atomic_casptr(void *volatile *ptr, void *expected, void *desired)
+{
+   return (InterlockedCompareExchangePointer(ptr, desired, expected) == expected);
+}
+
 int osal_thread_create(void **thandle, int stacksize, void *func, void *param)
 {
    *thandle = CreateThread(NULL, stacksize, func, param, 0, NULL);
@@ -70,6 +70,11 @@ const uint16 secMAC[3] = { 0x0404, 0x0404, 0x0404 };
 /** second MAC word is used for identification */
 #define RX_SEC secMAC[1]
 
+/** wait between checks of a delayed acyclic frame in us */
+#define NEX_SCHEDPOLL 50
+/** wire time in us of a frame at 100Mbit incl. preamble and gap */
+#define NEX_SCHEDWIRE(len) ((((len) + 20) * 8 + 99) / 100)
+
 static char errbuf[PCAP_ERRBUF_SIZE];
 
 static void nexx_clear_rxbufstat(int *rxbufstat)
@@ -122,6 +127,8 @@ int nexx_setupnic(nexx_portt *port, const char *ifname, int secondary)
       InitializeCriticalSection(&(port->getindex_mutex));
       InitializeCriticalSection(&(port->tx_mutex));
       InitializeCriticalSection(&(port->rx_mutex));
+      InitializeCriticalSection(&(port->sched_mutex));
+      memset(&(port->sched), 0x00, sizeof(port->sched));
       port->sockhandle        = NULL;
       port->lastidx           = 0;
       port->redstate          = ECT_RED_NONE;
@@ -168,6 +175,7 @@ int nexx_closenic(nexx_portt *port)
       DeleteCriticalSection(&(port->getindex_mutex));
       DeleteCriticalSection(&(port->tx_mutex));
       DeleteCriticalSection(&(port->rx_mutex));
+      DeleteCriticalSection(&(port->sched_mutex));
       pcap_close(port->sockhandle);
       port->sockhandle = NULL;
    }
@@ -278,12 +286,193 @@ int nexx_outframe(nexx_portt *port, int idx, int stacknumber)
    return rval;
 }
 
-/** Transmit buffer over socket (non blocking).
+/** Time in us from start to now. */
+static int nexx_sched_elapsed(nex_timet *start)
+{
+   nex_timet now, diff;
+
+   now = osal_current_time();
+   osal_time_diff(start, &now, &diff);
+   if (diff.sec > 1)
+   {
+      return 2000000;
+   }
+   return (int)(diff.sec * 1000000 + diff.usec);
+}
+
+/** Traffic class of an acyclic frame from its first datagram.
+ * @param[in] port        = port context struct
+ * @param[in] idx         = index in tx buffer array
+ * @return NEX_TXCLASS_xxx
+ */
+static int nexx_sched_class(nexx_portt *port, int idx)
+{
+   nex_comt *datagramP;
+   uint16 ado;
+
+   datagramP = (nex_comt*)&(port->txbuf[idx][ETH_HEADERSIZE]);
+   if ((datagramP->command == NEX_CMD_LRD) || (datagramP->command == NEX_CMD_LWR) ||
+       (datagramP->command == NEX_CMD_LRW))
+   {
+      return NEX_TXCLASS_OTHER;
+   }
+   ado = etohs(datagramP->ADO);
+   if (((ado >= ECT_REG_SM0) && (ado < ECT_REG_SM0 + 0x80)) || (ado >= 0x1000))
+   {
+      /* sync manager status and mailbox memory */
+      return NEX_TXCLASS_MBX;
+   }
+   if ((ado >= ECT_REG_EEPCFG) && (ado <= ECT_REG_EEPDAT + 7))
+   {
+      return NEX_TXCLASS_EEPROM;
+   }
+   if ((ado >= ECT_REG_ALCTL) && (ado <= ECT_REG_ALSTATCODE + 1))
+   {
+      return NEX_TXCLASS_STATE;
+   }
+   return NEX_TXCLASS_OTHER;
+}
+
+/** Account a cyclic frame. The first LRD or LRW frame after the gap starts a
+ * new cycle, so the LWR frames of a two-phase cycle do not. LWR frames only
+ * start a cycle for groups without inputs.
+ * @param[in] port        = port context struct
+ * @param[in] idx         = index in tx buffer array
+ */
+static void nexx_sched_cyclic(nexx_portt *port, int idx)
+{
+   nex_txschedt *sched = &(port->sched);
+   nex_comt *datagramP;
+   boolean start;
+   int elapsed;
+
+   if (!sched->enabled)
+   {
+      return;
+   }
+   datagramP = (nex_comt*)&(port->txbuf[idx][ETH_HEADERSIZE]);
+   EnterCriticalSection(&(port->sched_mutex));
+   if ((datagramP->command == NEX_CMD_LRD) || (datagramP->command == NEX_CMD_LRW))
+   {
+      sched->inputs = TRUE;
+      start = TRUE;
+   }
+   else
+   {
+      start = (boolean)((datagramP->command == NEX_CMD_LWR) && !sched->inputs);
+   }
+   if (start && (sched->cyclic <= 0))
+   {
+      elapsed = nexx_sched_elapsed(&(sched->cyclestart));
+      /* more than a second between cycles is no cyclic traffic */
+      sched->period = (elapsed < 1000000) ? elapsed : 0;
+      sched->cyclestart = osal_current_time();
+      sched->usedtotal = 0;
+      memset(sched->used, 0x00, sizeof(sched->used));
+      sched->cyclic = 0;
+   }
+   sched->cyclic++;
+   LeaveCriticalSection(&(port->sched_mutex));
+}
+
+/** Account a received or lost cyclic frame.
+ * @param[in] port        = port context struct
+ */
+static void nexx_sched_cyclicdone(nexx_portt *port)
+{
+   if (!port->sched.enabled)
+   {
+      return;
+   }
+   EnterCriticalSection(&(port->sched_mutex));
+   if (port->sched.cyclic > 0)
+   {
+      port->sched.cyclic--;
+   }
+   LeaveCriticalSection(&(port->sched_mutex));
+}
+
+/** Wait until an acyclic frame may be sent. Cyclic frames have priority,
+ * an acyclic frame goes only in the gap after the cyclic frames returned,
+ * if it is back before the next cycle and the byte budget of the cycle and
+ * of its traffic class allow it. Without cyclic traffic it goes at once.
+ * Every class may send one frame per cycle regardless of its share.
+ *
+ * @param[in] port        = port context struct
+ * @param[in] idx         = index in tx buffer array
+ * @param[in] timer       = timeout of the caller
+ * @return 1 if the frame may be sent, 0 if the timeout expired
+ */
+static int nexx_sched_wait(nexx_portt *port, int idx, osal_timert *timer)
+{
+   nex_txschedt *sched = &(port->sched);
+   int txclass, len, elapsed, limit;
+   boolean ok;
+
+   if (!sched->enabled)
+   {
+      return 1;
+   }
+   txclass = nexx_sched_class(port, idx);
+   len = port->txbuflength[idx];
+   for (;;)
+   {
+      EnterCriticalSection(&(port->sched_mutex));
+      elapsed = nexx_sched_elapsed(&(sched->cyclestart));
+      if (!sched->period || (elapsed > (4 * sched->period)))
+      {
+         /* cyclic traffic not running */
+         sched->cyclic = 0;
+         sched->inputs = FALSE;
+         ok = TRUE;
+      }
+      else if ((sched->cyclic > 0) && (elapsed < sched->period) && (elapsed < NEX_TIMEOUTRET))
+      {
+         /* cyclic frames on the wire */
+         ok = FALSE;
+      }
+      else
+      {
+         if (sched->cyclic > 0)
+         {
+            /* frame of a cycle that was not received */
+            sched->cyclic = 0;
+         }
+         /* frame and its return fit in the gap before the next cycle */
+         ok = (boolean)((sched->period - elapsed) > (sched->guard + 2 * NEX_SCHEDWIRE(len)));
+         if (ok && sched->budget && sched->used[txclass])
+         {
+            limit = sched->share[txclass] ? (sched->budget * sched->share[txclass] / 100) : sched->budget;
+            ok = (boolean)(((sched->usedtotal + len) <= sched->budget) &&
+                           ((sched->used[txclass] + len) <= limit));
+         }
+      }
+      if (ok)
+      {
+         sched->used[txclass] += len;
+         sched->usedtotal += len;
+      }
+      else if (osal_timer_is_expired(timer))
+      {
+         sched->deferred++;
+         LeaveCriticalSection(&(port->sched_mutex));
+         return 0;
+      }
+      LeaveCriticalSection(&(port->sched_mutex));
+      if (ok)
+      {
+         return 1;
+      }
+      osal_usleep(NEX_SCHEDPOLL);
+   }
+}
+
+/** Transmit buffer over primary and, in redundant mode, secondary socket.
  * @param[in] port        = port context struct
  * @param[in] idx      = index in tx buffer array
  * @return socket send result
  */
-int nexx_outframe_red(nexx_portt *port, int idx)
+static int nexx_outframe_dual(nexx_portt *port, int idx)
 {
    nex_comt *datagramP;
    nex_etherheadert *ehp;
@@ -316,6 +505,19 @@ int nexx_outframe_red(nexx_portt *port, int idx)
    return rval;
 }
 
+/** Transmit buffer over socket (non blocking). Used for cyclic frames, the
+ * TX scheduler holds back acyclic frames until they returned.
+ * @param[in] port        = port context struct
+ * @param[in] idx      = index in tx buffer array
+ * @return socket send result
+ */
+int nexx_outframe_red(nexx_portt *port, int idx)
+{
+   nexx_sched_cyclic(port, idx);
+
+   return nexx_outframe_dual(port, idx);
+}
+
 /** Non blocking read of socket. Put frame in temporary buffer.
  * @param[in] port        = port context struct
  * @param[in] stacknumber = 0=primary 1=secondary stack
@@ -555,6 +757,7 @@ int nexx_waitinframe(nexx_portt *port, int idx, int timeout)
 
    osal_timer_start (&timer, timeout);
    wkc = nexx_waitinframe_red(port, idx, &timer);
+   nexx_sched_cyclicdone(port);
 
    return wkc;
 }
@@ -579,8 +782,13 @@ int nexx_srconfirm(nexx_portt *port, int idx, int timeout)
    osal_timer_start (&timer1, timeout);
    do
    {
+      /* wait for the gap after the cyclic frames */
+      if (!nexx_sched_wait(port, idx, &timer1))
+      {
+         break;
+      }
       /* tx frame on primary and if in redundant mode a dummy on secondary */
-      nexx_outframe_red(port, idx);
+      nexx_outframe_dual(port, idx);
       if (timeout < NEX_TIMEOUTRET)
       {
          osal_timer_start (&timer2, timeout);
@@ -603,6 +811,34 @@ int nexx_srconfirm(nexx_portt *port, int idx, int timeout)
    return wkc;
 }
 
+/** Configure the TX scheduler for acyclic frames. Cyclic frames are the
+ * frames sent by send processdata, all frames of nexx_srconfirm() are
+ * acyclic. With the scheduler enabled acyclic frames wait for the gap after
+ * the cyclic frames returned and share a byte budget per cycle.
+ *
+ * @param[in] port        = port context struct
+ * @param[in] enabled     = TRUE to schedule acyclic frames
+ * @param[in] budget      = acyclic bytes per cycle, 0 = no byte limit
+ * @param[in] guard       = time in us before the next cycle without acyclic frames
+ * @param[in] share       = NEX_TXCLASSES shares of budget in percent, NULL = no shares
+ */
+void nexx_setsched(nexx_portt *port, boolean enabled, int budget, int guard, const int *share)
+{
+   int i;
+
+   EnterCriticalSection(&(port->sched_mutex));
+   port->sched.budget = budget;
+   port->sched.guard = guard;
+   for (i = 0; i < NEX_TXCLASSES; i++)
+   {
+      port->sched.share[i] = share ? share[i] : 0;
+   }
+   port->sched.cyclic = 0;
+   port->sched.period = 0;
+   port->sched.enabled = enabled;
+   LeaveCriticalSection(&(port->sched_mutex));
+}
+
 
 #ifdef NEX_VER1
 
@@ -651,4 +887,9 @@ int nex_srconfirm(int idx, int timeout)
    return nexx_srconfirm(&nexx_port, idx, timeout);
 }
 
+void nex_setsched(boolean enabled, int budget, int guard, const int *share)
+{
+   nexx_setsched(&nexx_port, enabled, budget, guard, share);
+}
+
 #endif
@@ -21,6 +21,44 @@ extern "C"
 #include <pcap.h>
 #include <Packet32.h>
 
+/** acyclic traffic class, mailbox incl. FoE and SM status polls */
+#define NEX_TXCLASS_MBX     0
+/** acyclic traffic class, SII EEPROM access */
+#define NEX_TXCLASS_EEPROM  1
+/** acyclic traffic class, AL control and status */
+#define NEX_TXCLASS_STATE   2
+/** acyclic traffic class, all other acyclic datagrams */
+#define NEX_TXCLASS_OTHER   3
+/** number of acyclic traffic classes */
+#define NEX_TXCLASSES       4
+
+/** TX scheduler, acyclic frames are sent in the gap after the cyclic frames */
+typedef struct
+{
+   /** scheduler active, else acyclic frames are sent at once */
+   boolean     enabled;
+   /** acyclic bytes per cycle, 0 = no byte limit */
+   int         budget;
+   /** share of budget per traffic class in percent, 0 = only the budget limits */
+   int         share[NEX_TXCLASSES];
+   /** time in us before the expected next cyclic frame in which no acyclic frame starts */
+   int         guard;
+   /** cyclic frames sent and not yet received */
+   int         cyclic;
+   /** time the first cyclic frame of the current cycle was sent */
+   nex_timet   cyclestart;
+   /** cyclic frames with inputs seen, then only they start a cycle */
+   boolean     inputs;
+   /** measured cycle time in us, 0 = cyclic traffic not running */
+   int         period;
+   /** acyclic bytes sent per traffic class in the current cycle */
+   int         used[NEX_TXCLASSES];
+   /** acyclic bytes sent in the current cycle */
+   int         usedtotal;
+   /** acyclic frames that had to wait for a later cycle */
+   uint32      deferred;
+} nex_txschedt;
+
 /** pointer structure to Tx and Rx stacks */
 typedef struct
 {
@@ -87,6 +125,9 @@ typedef struct
    CRITICAL_SECTION getindex_mutex;
    CRITICAL_SECTION tx_mutex;
    CRITICAL_SECTION rx_mutex;
+   /** TX scheduler for acyclic frames */
+   nex_txschedt sched;
+   CRITICAL_SECTION sched_mutex;
 } nexx_portt;
 
 extern const uint16 priMAC[3];
@@ -104,6 +145,7 @@ int nex_outframe(int idx, int sock);
 int nex_outframe_red(int idx);
 int nex_waitinframe(int idx, int timeout);
 int nex_srconfirm(int idx,int timeout);
+void nex_setsched(boolean enabled, int budget, int guard, const int *share);
 #endif
 
 void nex_setupheader(void *p);
@@ -115,6 +157,7 @@ int nexx_outframe(nexx_portt *port, int idx, int sock);
 int nexx_outframe_red(nexx_portt *port, int idx);
 int nexx_waitinframe(nexx_portt *port, int idx, int timeout);
 int nexx_srconfirm(nexx_portt *port, int idx,int timeout);
+void nexx_setsched(nexx_portt *port, boolean enabled, int budget, int guard, const int *share);
 
 #ifdef __cplusplus
 }
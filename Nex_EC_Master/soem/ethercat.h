@@ -15,12 +15,22 @@
 #include "nicdrv.h"
 #include "ethercatbase.h"
 #include "ethercatmain.h"
+#include "ethercatmbxq.h"
 #include "ethercatdc.h"
 #include "ethercatcoe.h"
 #include "ethercatfoe.h"
 #include "ethercatsoe.h"
 #include "ethercatconfig.h"
 #include "ethercatprint.h"
+#include "ethercatpdx.h"
+#include "ethercatroute.h"
+#include "ethercatlayout.h"
+#include "ethercatbitio.h"
+#include "ethercatcond.h"
+#include "ethercatovs.h"
+#include "ethercatrec.h"
+#include "ethercatodc.h"
+#include "ethercatbackup.h"
 #include "osal.h"
 
 #endif /* _NEX_ETHERCAT_H */
@@ -0,0 +1,679 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Parameter backup and restore.
+ *
+ * The CoE objects of all slaves are read and written with nexx_SDObatch(),
+ * one object per slave and round, so every round carries all slaves in the
+ * same frames. Complete Access objects take one transfer per object. SoE
+ * slaves are served by up to NEX_BACKUP_MAXT threads, one slave per thread,
+ * an IDN list like S-0-0192 is expanded to its IDNs. A restore can verify
+ * every object by reading it back.
+ *
+ * File format, all values little endian:
+ * - header: "NEXBAK" 0 version(uint8), time(uint32) in s, nitem(uint32).
+ * - per item: slave(uint16) proto(uint8) sub(uint8) index(uint16) CA(uint8)
+ *   0(uint8) eep_man(uint32) eep_id(uint32) eep_rev(uint32) size(uint32)
+ *   and the data.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatmbxq.h"
+#include "ethercatcoe.h"
+#include "ethercatsoe.h"
+#include "ethercatbackup.h"
+
+#define NEX_BACKUP_HEADSIZE 16
+#define NEX_BACKUP_ITEMSIZE 24
+
+/** one saved object */
+typedef struct nex_bkitem
+{
+   uint16           slave;
+   uint8            proto;
+   uint8            sub;
+   uint16           index;
+   boolean          CA;
+   uint32           eep_man;
+   uint32           eep_id;
+   uint32           eep_rev;
+   uint32           size;
+   uint8            *data;
+   struct nex_bkitem *next;
+} nex_bkitemt;
+
+/** SoE thread, serves one slave */
+typedef struct
+{
+   nexx_contextt    *context;
+   uint16           slave;
+   /** backup: objects to read, restore: NULL */
+   const nex_bkobjt *obj;
+   int              nobj;
+   /** backup: items read, restore: items to write */
+   nex_bkitemt      *item;
+   int              nitem;
+   boolean          verify;
+   /** restore: items written */
+   int              done;
+   volatile int     running;
+} nex_bkworkert;
+
+static uint8 *nexx_bk_put(uint8 *p, uint32 value, int bytes)
+{
+   int i;
+
+   for (i = 0; i < bytes; i++)
+   {
+      *p++ = (uint8)(value >> (i * 8));
+   }
+   return p;
+}
+
+static const uint8 *nexx_bk_get(const uint8 *p, uint32 *value, int bytes)
+{
+   int i;
+
+   *value = 0;
+   for (i = 0; i < bytes; i++)
+   {
+      *value |= (uint32)(*p++) << (i * 8);
+   }
+   return p;
+}
+
+/** Write an item to the file.
+ * @return TRUE if written */
+static boolean nexx_bk_write(FILE *fp, const nex_bkitemt *item)
+{
+   uint8 head[NEX_BACKUP_ITEMSIZE], *p;
+
+   p = nexx_bk_put(head, item->slave, 2);
+   *p++ = item->proto;
+   *p++ = item->sub;
+   p = nexx_bk_put(p, item->index, 2);
+   *p++ = item->CA ? 1 : 0;
+   *p++ = 0;
+   p = nexx_bk_put(p, item->eep_man, 4);
+   p = nexx_bk_put(p, item->eep_id, 4);
+   p = nexx_bk_put(p, item->eep_rev, 4);
+   p = nexx_bk_put(p, item->size, 4);
+   return (boolean)((fwrite(head, 1, NEX_BACKUP_ITEMSIZE, fp) == NEX_BACKUP_ITEMSIZE) &&
+                    (fwrite(item->data, 1, item->size, fp) == item->size));
+}
+
+/** Read one SoE IDN of a slave and append it to the items of the worker. */
+static void nexx_bk_soeread(nex_bkworkert *w, uint8 drive, uint16 idn, uint8 *buf)
+{
+   nex_slavet *sl = &(w->context->slavelist[w->slave]);
+   nex_bkitemt *item, **pp;
+   int size;
+
+   size = NEX_BACKUP_MAXDATA;
+   if ((nexx_SoEread(w->context, w->slave, drive, NEX_SOE_VALUE_B, idn, &size, buf, NEX_TIMEOUTRXM) <= 0) ||
+       (size <= 0))
+   {
+      return;
+   }
+   item = (nex_bkitemt *)osal_malloc(sizeof(nex_bkitemt) + size);
+   if (!item)
+   {
+      return;
+   }
+   memset(item, 0x00, sizeof(nex_bkitemt));
+   item->slave = w->slave;
+   item->proto = ECT_MBXT_SOE;
+   item->sub = drive;
+   item->index = idn;
+   item->eep_man = sl->eep_man;
+   item->eep_id = sl->eep_id;
+   item->eep_rev = sl->eep_rev;
+   item->size = (uint32)size;
+   item->data = (uint8 *)(item + 1);
+   memcpy(item->data, buf, size);
+   /* keep the order of the configuration */
+   for (pp = &(w->item); *pp; pp = &((*pp)->next))
+   {
+      ;
+   }
+   *pp = item;
+   w->nitem++;
+}
+
+OSAL_THREAD_FUNC nexx_bk_soethread(void *param)
+{
+   nex_bkworkert *w;
+   nex_bkitemt *item;
+   nex_SoElistt *list;
+   uint8 *buf;
+   int i, j, n, size;
+
+   w = (nex_bkworkert *)param;
+   buf = (uint8 *)osal_malloc(2 * NEX_BACKUP_MAXDATA);
+   if (buf && w->obj)
+   {
+      /* backup */
+      list = (nex_SoElistt *)(buf + NEX_BACKUP_MAXDATA);
+      for (i = 0; i < w->nobj; i++)
+      {
+         if ((w->obj[i].slave != w->slave) || (w->obj[i].proto != ECT_MBXT_SOE))
+         {
+            continue;
+         }
+         if (!w->obj[i].all)
+         {
+            nexx_bk_soeread(w, w->obj[i].sub, w->obj[i].index, buf);
+            continue;
+         }
+         size = NEX_BACKUP_MAXDATA;
+         if ((nexx_SoEread(w->context, w->slave, w->obj[i].sub, NEX_SOE_VALUE_B, w->obj[i].index,
+                           &size, list, NEX_TIMEOUTRXM) > 0) && (size >= 4))
+         {
+            n = etohs(list->currentlength) / 2;
+            if (n > ((size - 4) / 2))
+            {
+               n = (size - 4) / 2;
+            }
+            for (j = 0; j < n; j++)
+            {
+               nexx_bk_soeread(w, w->obj[i].sub, etohs(list->word[j]), buf);
+            }
+         }
+      }
+   }
+   else if (buf)
+   {
+      /* restore */
+      for (item = w->item; item; item = item->next)
+      {
+         if (nexx_SoEwrite(w->context, w->slave, item->sub, NEX_SOE_VALUE_B, item->index,
+                           (int)item->size, item->data, NEX_TIMEOUTRXM) <= 0)
+         {
+            continue;
+         }
+         if (w->verify)
+         {
+            size = NEX_BACKUP_MAXDATA;
+            if ((nexx_SoEread(w->context, w->slave, item->sub, NEX_SOE_VALUE_B, item->index,
+                              &size, buf, NEX_TIMEOUTRXM) <= 0) ||
+                (size != (int)item->size) || memcmp(buf, item->data, size))
+            {
+               continue;
+            }
+         }
+         w->done++;
+      }
+   }
+   if (buf)
+   {
+      osal_free(buf);
+   }
+   w->running = 0;
+}
+
+/** Run the SoE threads for all slaves with SoE items.
+ * @param[in]  want = TRUE per slave to serve */
+static void nexx_bk_soerun(nexx_contextt *context, nex_bkworkert *w, const boolean *want)
+{
+   OSAL_THREAD_HANDLE thread[NEX_BACKUP_MAXT];
+   nex_bkworkert *slot[NEX_BACKUP_MAXT];
+   int thrn, running;
+   uint16 slave;
+
+   memset(slot, 0x00, sizeof(slot));
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      if (!want[slave])
+      {
+         continue;
+      }
+      w[slave].context = context;
+      w[slave].slave = slave;
+      w[slave].running = 1;
+      if (NEX_BACKUP_MAXT <= 1)
+      {
+         /* serialised version */
+         nexx_bk_soethread(&(w[slave]));
+         continue;
+      }
+      /* multi-threaded version, take a free worker */
+      do
+      {
+         for (thrn = 0; (thrn < NEX_BACKUP_MAXT) && slot[thrn] && slot[thrn]->running; thrn++)
+         {
+            ;
+         }
+         if (thrn >= NEX_BACKUP_MAXT)
+         {
+            osal_usleep(1000);
+         }
+      } while (thrn >= NEX_BACKUP_MAXT);
+      slot[thrn] = &(w[slave]);
+      if (!osal_thread_create(&(thread[thrn]), 128000, &nexx_bk_soethread, &(w[slave])))
+      {
+         /* no thread, serve the slave here */
+         nexx_bk_soethread(&(w[slave]));
+      }
+   }
+   /* wait for all threads to finish */
+   do
+   {
+      running = 0;
+      for (thrn = 0; thrn < NEX_BACKUP_MAXT; thrn++)
+      {
+         running += slot[thrn] ? slot[thrn]->running : 0;
+      }
+      if (running)
+      {
+         osal_usleep(1000);
+      }
+   } while (running);
+}
+
+/** Save objects and IDNs of the slaves to a file. Call in PRE-OP or higher.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  obj            = objects and IDNs to save
+ * @param[in]  n              = number of objects
+ * @param[in]  fname          = file name
+ * @return number of items saved, -1 if the file could not be written or out of memory
+ */
+int nexx_backup(nexx_contextt *context, const nex_bkobjt *obj, int n, const char *fname)
+{
+   FILE *fp;
+   nex_bkworkert *w;
+   nex_bkitemt item, *next;
+   nex_SDOopt *op;
+   nex_slavet *sl;
+   boolean *want;
+   uint8 head[NEX_BACKUP_HEADSIZE], *buf, *p;
+   int *cur, *opobj, nop, i, saved;
+   uint16 slave;
+   boolean ok;
+
+   w = (nex_bkworkert *)osal_malloc(NEX_MAXSLAVE * sizeof(nex_bkworkert));
+   op = (nex_SDOopt *)osal_malloc(NEX_MAXSLAVE * sizeof(nex_SDOopt));
+   cur = (int *)osal_malloc(2 * NEX_MAXSLAVE * sizeof(int));
+   want = (boolean *)osal_malloc(NEX_MAXSLAVE * sizeof(boolean));
+   buf = (uint8 *)osal_malloc(NEX_MAXSLAVE * NEX_BACKUP_MAXDATA);
+   fp = (w && op && cur && want && buf) ? fopen(fname, "wb") : NULL;
+   saved = 0;
+   ok = (boolean)(fp != NULL);
+   if (ok)
+   {
+      opobj = cur + NEX_MAXSLAVE;
+      memset(w, 0x00, NEX_MAXSLAVE * sizeof(nex_bkworkert));
+      memset(cur, 0x00, NEX_MAXSLAVE * sizeof(int));
+      memset(want, 0x00, NEX_MAXSLAVE * sizeof(boolean));
+      /* the count is written when done */
+      memcpy(head, "NEXBAK", 7);
+      head[7] = NEX_BACKUP_VERSION;
+      p = nexx_bk_put(head + 8, (uint32)osal_current_time().sec, 4);
+      p = nexx_bk_put(p, 0, 4);
+      ok = (boolean)(fwrite(head, 1, NEX_BACKUP_HEADSIZE, fp) == NEX_BACKUP_HEADSIZE);
+      /* SoE slaves in threads */
+      for (i = 0; i < n; i++)
+      {
+         if ((obj[i].proto == ECT_MBXT_SOE) && obj[i].slave && (obj[i].slave <= *(context->slavecount)) &&
+             (context->slavelist[obj[i].slave].mbx_proto & ECT_MBXPROT_SOE))
+         {
+            want[obj[i].slave] = TRUE;
+            w[obj[i].slave].obj = obj;
+            w[obj[i].slave].nobj = n;
+         }
+      }
+      nexx_bk_soerun(context, w, want);
+      /* CoE objects, one per slave and round */
+      do
+      {
+         nop = 0;
+         for (slave = 1; slave <= *(context->slavecount); slave++)
+         {
+            sl = &(context->slavelist[slave]);
+            for (i = cur[slave]; i < n; i++)
+            {
+               if ((obj[i].slave == slave) && (obj[i].proto == ECT_MBXT_COE) &&
+                   (!obj[i].all || (sl->CoEdetails & ECT_COEDET_SDOCA)))
+               {
+                  break;
+               }
+            }
+            cur[slave] = i + 1;
+            if (i >= n)
+            {
+               cur[slave] = n;
+               continue;
+            }
+            memset(&(op[nop]), 0x00, sizeof(nex_SDOopt));
+            op[nop].slave = slave;
+            op[nop].index = obj[i].index;
+            op[nop].subindex = obj[i].sub;
+            op[nop].CA = obj[i].all;
+            op[nop].write = FALSE;
+            op[nop].size = NEX_BACKUP_MAXDATA;
+            op[nop].p = buf + nop * NEX_BACKUP_MAXDATA;
+            opobj[nop] = i;
+            nop++;
+         }
+         if (nop)
+         {
+            nexx_SDObatch(context, op, nop, NEX_TIMEOUTRXM);
+         }
+         for (i = 0; ok && (i < nop); i++)
+         {
+            if ((op[i].wkc <= 0) || (op[i].size <= 0))
+            {
+               continue;
+            }
+            sl = &(context->slavelist[op[i].slave]);
+            memset(&item, 0x00, sizeof(item));
+            item.slave = op[i].slave;
+            item.proto = ECT_MBXT_COE;
+            item.sub = obj[opobj[i]].sub;
+            item.index = obj[opobj[i]].index;
+            item.CA = obj[opobj[i]].all;
+            item.eep_man = sl->eep_man;
+            item.eep_id = sl->eep_id;
+            item.eep_rev = sl->eep_rev;
+            item.size = (uint32)op[i].size;
+            item.data = (uint8 *)op[i].p;
+            ok = nexx_bk_write(fp, &item);
+            saved++;
+         }
+      } while (nop && ok);
+      /* SoE items of the threads */
+      for (slave = 1; slave <= *(context->slavecount); slave++)
+      {
+         while (w[slave].item)
+         {
+            next = w[slave].item->next;
+            if (ok)
+            {
+               ok = nexx_bk_write(fp, w[slave].item);
+               saved++;
+            }
+            osal_free(w[slave].item);
+            w[slave].item = next;
+         }
+      }
+      nexx_bk_put(head, (uint32)saved, 4);
+      if (ok)
+      {
+         ok = (boolean)(!fseek(fp, 12, SEEK_SET) && (fwrite(head, 1, 4, fp) == 4));
+      }
+      if (fclose(fp))
+      {
+         ok = FALSE;
+      }
+   }
+   if (buf)
+   {
+      osal_free(buf);
+   }
+   if (want)
+   {
+      osal_free(want);
+   }
+   if (cur)
+   {
+      osal_free(cur);
+   }
+   if (op)
+   {
+      osal_free(op);
+   }
+   if (w)
+   {
+      osal_free(w);
+   }
+   return ok ? saved : -1;
+}
+
+/** Restore the items of a backup file to the slaves in PRE-OP. Items are
+ * written to the slave at the same position if the slave has the same
+ * vendor and product, the revision may differ. CoE items are written with
+ * nexx_SDObatch() one per slave and round, SoE slaves by threads.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  fname          = file name
+ * @param[in]  slave          = restore only this slave, f.e. after a device swap, 0 = all
+ * @param[in]  verify         = TRUE to read every item back and compare
+ * @return number of items restored, -1 if the file is missing or invalid
+ */
+int nexx_restore(nexx_contextt *context, const char *fname, uint16 slave, boolean verify)
+{
+   FILE *fp;
+   nex_bkworkert *w;
+   nex_bkitemt *item, **last;
+   nex_SDOopt *op;
+   nex_slavet *sl;
+   boolean *want;
+   uint8 *file, *buf;
+   const uint8 *p, *end;
+   uint32 v, nitem, i;
+   int *cur, *opitem, nop, restored, j, pass;
+   long size;
+   uint16 s;
+   boolean valid;
+
+   fp = fopen(fname, "rb");
+   if (!fp)
+   {
+      return -1;
+   }
+   file = NULL;
+   size = 0;
+   if (!fseek(fp, 0, SEEK_END) && ((size = ftell(fp)) > 0) && !fseek(fp, 0, SEEK_SET))
+   {
+      file = (uint8 *)osal_malloc((size_t)size);
+   }
+   if (file && (fread(file, 1, (size_t)size, fp) != (size_t)size))
+   {
+      osal_free(file);
+      file = NULL;
+   }
+   fclose(fp);
+   if (!file)
+   {
+      return -1;
+   }
+   end = file + size;
+   valid = (boolean)((size >= NEX_BACKUP_HEADSIZE) && !memcmp(file, "NEXBAK", 7) &&
+                     (file[7] == NEX_BACKUP_VERSION));
+   nitem = 0;
+   if (valid)
+   {
+      nexx_bk_get(file + 12, &nitem, 4);
+      /* every item has a header, also keeps the allocation below from overflowing */
+      if (nitem > (uint32)((size - NEX_BACKUP_HEADSIZE) / NEX_BACKUP_ITEMSIZE))
+      {
+         valid = FALSE;
+      }
+   }
+   item = valid ? (nex_bkitemt *)osal_malloc((nitem ? nitem : 1) * sizeof(nex_bkitemt)) : NULL;
+   w = (nex_bkworkert *)osal_malloc(NEX_MAXSLAVE * sizeof(nex_bkworkert));
+   op = (nex_SDOopt *)osal_malloc(NEX_MAXSLAVE * sizeof(nex_SDOopt));
+   cur = (int *)osal_malloc(2 * NEX_MAXSLAVE * sizeof(int));
+   want = (boolean *)osal_malloc(NEX_MAXSLAVE * sizeof(boolean));
+   buf = (uint8 *)osal_malloc(NEX_MAXSLAVE * NEX_BACKUP_MAXDATA);
+   valid = (boolean)(valid && item && w && op && cur && want && buf);
+   /* parse the items */
+   p = file + NEX_BACKUP_HEADSIZE;
+   for (i = 0; valid && (i < nitem); i++)
+   {
+      if ((end - p) < NEX_BACKUP_ITEMSIZE)
+      {
+         valid = FALSE;
+         break;
+      }
+      p = nexx_bk_get(p, &v, 2);
+      item[i].slave = (uint16)v;
+      item[i].proto = *p++;
+      item[i].sub = *p++;
+      p = nexx_bk_get(p, &v, 2);
+      item[i].index = (uint16)v;
+      item[i].CA = (boolean)(*p++ != 0);
+      p++;
+      p = nexx_bk_get(p, &(item[i].eep_man), 4);
+      p = nexx_bk_get(p, &(item[i].eep_id), 4);
+      p = nexx_bk_get(p, &(item[i].eep_rev), 4);
+      p = nexx_bk_get(p, &(item[i].size), 4);
+      if (((uint32)(end - p) < item[i].size) || (item[i].size > NEX_BACKUP_MAXDATA))
+      {
+         valid = FALSE;
+         break;
+      }
+      item[i].data = (uint8 *)p;
+      item[i].next = NULL;
+      p += item[i].size;
+   }
+   restored = 0;
+   if (valid)
+   {
+      opitem = cur + NEX_MAXSLAVE;
+      memset(w, 0x00, NEX_MAXSLAVE * sizeof(nex_bkworkert));
+      memset(cur, 0x00, NEX_MAXSLAVE * sizeof(int));
+      memset(want, 0x00, NEX_MAXSLAVE * sizeof(boolean));
+      /* items of other devices are skipped */
+      for (i = 0; i < nitem; i++)
+      {
+         s = item[i].slave;
+         sl = &(context->slavelist[s]);
+         if (!s || (s > *(context->slavecount)) || (slave && (s != slave)) ||
+             (sl->eep_man != item[i].eep_man) || (sl->eep_id != item[i].eep_id))
+         {
+            item[i].proto = 0;
+         }
+      }
+      /* SoE slaves in threads, the items of a slave in file order */
+      for (i = 0; i < nitem; i++)
+      {
+         s = item[i].slave;
+         if ((item[i].proto == ECT_MBXT_SOE) && (context->slavelist[s].mbx_proto & ECT_MBXPROT_SOE))
+         {
+            for (last = &(w[s].item); *last; last = &((*last)->next))
+            {
+               ;
+            }
+            *last = &(item[i]);
+            w[s].verify = verify;
+            want[s] = TRUE;
+         }
+      }
+      nexx_bk_soerun(context, w, want);
+      for (s = 1; s <= *(context->slavecount); s++)
+      {
+         restored += w[s].done;
+      }
+      /* CoE items, one per slave and round, written and then read back */
+      do
+      {
+         nop = 0;
+         for (s = 1; s <= *(context->slavecount); s++)
+         {
+            for (j = cur[s]; j < (int)nitem; j++)
+            {
+               if ((item[j].slave == s) && (item[j].proto == ECT_MBXT_COE))
+               {
+                  break;
+               }
+            }
+            cur[s] = j + 1;
+            if (j >= (int)nitem)
+            {
+               cur[s] = (int)nitem;
+               continue;
+            }
+            memset(&(op[nop]), 0x00, sizeof(nex_SDOopt));
+            op[nop].slave = s;
+            op[nop].index = item[j].index;
+            op[nop].subindex = item[j].sub;
+            op[nop].CA = item[j].CA;
+            op[nop].write = TRUE;
+            op[nop].size = (int)item[j].size;
+            op[nop].p = item[j].data;
+            opitem[nop] = j;
+            nop++;
+         }
+         for (pass = 0; nop && (pass < (verify ? 2 : 1)); pass++)
+         {
+            if (pass)
+            {
+               /* read back the written items */
+               for (j = 0; j < nop; j++)
+               {
+                  if (op[j].wkc > 0)
+                  {
+                     op[j].write = FALSE;
+                     op[j].size = NEX_BACKUP_MAXDATA;
+                     op[j].p = buf + j * NEX_BACKUP_MAXDATA;
+                  }
+                  else
+                  {
+                     /* not written, left out of the read back */
+                     op[j].slave = 0;
+                  }
+               }
+            }
+            nexx_SDObatch(context, op, nop, NEX_TIMEOUTRXM);
+         }
+         for (j = 0; j < nop; j++)
+         {
+            if ((op[j].wkc > 0) &&
+                (!verify || ((op[j].size == (int)item[opitem[j]].size) &&
+                             !memcmp(op[j].p, item[opitem[j]].data, op[j].size))))
+            {
+               restored++;
+            }
+         }
+      } while (nop);
+   }
+   if (buf)
+   {
+      osal_free(buf);
+   }
+   if (want)
+   {
+      osal_free(want);
+   }
+   if (cur)
+   {
+      osal_free(cur);
+   }
+   if (op)
+   {
+      osal_free(op);
+   }
+   if (w)
+   {
+      osal_free(w);
+   }
+   if (item)
+   {
+      osal_free(item);
+   }
+   osal_free(file);
+   return valid ? restored : -1;
+}
+
+#ifdef NEX_VER1
+int nex_backup(const nex_bkobjt *obj, int n, const char *fname)
+{
+   return nexx_backup(&nexx_context, obj, n, fname);
+}
+
+int nex_restore(const char *fname, uint16 slave, boolean verify)
+{
+   return nexx_restore(&nexx_context, fname, slave, verify);
+}
+#endif
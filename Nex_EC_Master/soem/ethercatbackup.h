@@ -0,0 +1,61 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatbackup.c
+ */
+
+#ifndef _NEX_ECATBACKUP_H
+#define _NEX_ECATBACKUP_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. threads for SoE slaves */
+#ifndef NEX_BACKUP_MAXT
+#define NEX_BACKUP_MAXT    4
+#endif
+/** max. data size of one object */
+#ifndef NEX_BACKUP_MAXDATA
+#define NEX_BACKUP_MAXDATA 1024
+#endif
+/** file version */
+#define NEX_BACKUP_VERSION 1
+
+/** SoE IDN list of all backup operation data */
+#define NEX_IDN_BACKUPLIST 192
+
+/** one object or IDN to back up */
+typedef struct nex_bkobj
+{
+   /** slave number */
+   uint16           slave;
+   /** ECT_MBXT_COE or ECT_MBXT_SOE */
+   uint8            proto;
+   /** CoE subindex or SoE drive number */
+   uint8            sub;
+   /** CoE index or SoE IDN */
+   uint16           index;
+   /** CoE: Complete Access, only on slaves that support it.
+    * SoE: the IDN is a list of IDNs, f.e. NEX_IDN_BACKUPLIST, each is saved */
+   boolean          all;
+} nex_bkobjt;
+
+#ifdef NEX_VER1
+int nex_backup(const nex_bkobjt *obj, int n, const char *fname);
+int nex_restore(const char *fname, uint16 slave, boolean verify);
+#endif
+
+int nexx_backup(nexx_contextt *context, const nex_bkobjt *obj, int n, const char *fname);
+int nexx_restore(nexx_contextt *context, const char *fname, uint16 slave, boolean verify);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATBACKUP_H */
@@ -0,0 +1,384 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Channel access to bit oriented slaves.
+ *
+ * Bit oriented slaves are packed at bit level in the IOmap, and adjacent
+ * slaves continue where the previous one ended. At init the slaves of a group
+ * are merged to a few long bit ranges. Unpack expands them to one byte per
+ * channel and pack collects the output channels back into the IOmap, 16 or
+ * 32 channels per step with SSE2, AVX2 or NEON and 8 per step otherwise.
+ */
+
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NEX_BITIO_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NEX_BITIO_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NEX_BITIO_NEON
+#endif
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatbitio.h"
+
+/** Expand 8 bits to 8 bytes of 0 or 1, bit 0 to the first byte. */
+static uint64 nex_spreadbyte(uint8 b)
+{
+   return (((uint64)(b & 0x7f) * 0x2040810204081ULL) & 0x0101010101010101ULL) |
+          ((uint64)(b & 0x80) << 49);
+}
+
+/** Collect 8 bytes, 0 or not 0, to 8 bits, first byte to bit 0. */
+static uint8 nex_gatherbyte(const uint8 *src)
+{
+   uint64 v;
+
+   memcpy(&v, src, sizeof(v));
+   v = etohll(v);
+   v |= v >> 4;
+   v |= v >> 2;
+   v |= v >> 1;
+   v &= 0x0101010101010101ULL;
+   return (uint8)((v * 0x0102040810204080ULL) >> 56);
+}
+
+/** Unpack bits from the IOmap to one byte per bit.
+ *
+ * @param[in]  src            = first byte of bits
+ * @param[in]  startbit       = first bit in first byte
+ * @param[out] dst            = channel array, 0 or 1 per bit
+ * @param[in]  nbits          = number of bits
+ */
+void nex_unpackbits(const uint8 *src, uint8 startbit, uint8 *dst, uint32 nbits)
+{
+   uint32 i = 0;
+   uint64 v;
+
+   /* up to the first byte boundary */
+   while (startbit && (i < nbits))
+   {
+      dst[i++] = (uint8)((*src >> startbit) & 1);
+      if (++startbit > 7)
+      {
+         startbit = 0;
+         src++;
+      }
+   }
+#if defined(NEX_BITIO_AVX2)
+   {
+      const __m256i sel = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                           2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+      const __m256i mask = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+      const __m256i one = _mm256_set1_epi8(1);
+      __m256i x;
+      int32 w;
+
+      for (; (i + 32) <= nbits; i += 32)
+      {
+         memcpy(&w, src, sizeof(w));
+         x = _mm256_shuffle_epi8(_mm256_set1_epi32(w), sel);
+         x = _mm256_cmpeq_epi8(_mm256_and_si256(x, mask), mask);
+         _mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(x, one));
+         src += 4;
+      }
+   }
+#endif
+#if defined(NEX_BITIO_SSE2)
+   {
+      const __m128i mask = _mm_set1_epi64x((long long)0x8040201008040201ULL);
+      const __m128i one = _mm_set1_epi8(1);
+      __m128i x;
+      uint16 w;
+
+      for (; (i + 16) <= nbits; i += 16)
+      {
+         memcpy(&w, src, sizeof(w));
+         x = _mm_cvtsi32_si128(w);
+         x = _mm_unpacklo_epi8(x, x);
+         x = _mm_unpacklo_epi16(x, x);
+         x = _mm_unpacklo_epi32(x, x);
+         x = _mm_cmpeq_epi8(_mm_and_si128(x, mask), mask);
+         _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(x, one));
+         src += 2;
+      }
+   }
+#elif defined(NEX_BITIO_NEON)
+   {
+      const uint8x16_t mask = vreinterpretq_u8_u64(vdupq_n_u64(0x8040201008040201ULL));
+      const uint8x16_t one = vdupq_n_u8(1);
+      uint8x16_t x;
+
+      for (; (i + 16) <= nbits; i += 16)
+      {
+         x = vcombine_u8(vdup_n_u8(src[0]), vdup_n_u8(src[1]));
+         vst1q_u8(dst + i, vandq_u8(vtstq_u8(x, mask), one));
+         src += 2;
+      }
+   }
+#endif
+   for (; (i + 8) <= nbits; i += 8)
+   {
+      v = htoell(nex_spreadbyte(*src++));
+      memcpy(dst + i, &v, sizeof(v));
+   }
+   for (startbit = 0; i < nbits; i++, startbit++)
+   {
+      dst[i] = (uint8)((*src >> startbit) & 1);
+   }
+}
+
+/** Pack one byte per bit to bits in the IOmap. Bits outside the range are
+ * not changed.
+ *
+ * @param[in]  src            = channel array, 0 or not 0 per bit
+ * @param[out] dst            = first byte of bits
+ * @param[in]  startbit       = first bit in first byte
+ * @param[in]  nbits          = number of bits
+ */
+void nex_packbits(const uint8 *src, uint8 *dst, uint8 startbit, uint32 nbits)
+{
+   uint32 i = 0;
+
+   /* up to the first byte boundary */
+   while (startbit && (i < nbits))
+   {
+      if (src[i++])
+      {
+         *dst |= (uint8)(1 << startbit);
+      }
+      else
+      {
+         *dst &= (uint8)~(1 << startbit);
+      }
+      if (++startbit > 7)
+      {
+         startbit = 0;
+         dst++;
+      }
+   }
+#if defined(NEX_BITIO_AVX2)
+   {
+      const __m256i zero = _mm256_setzero_si256();
+      uint32 m;
+
+      for (; (i + 32) <= nbits; i += 32)
+      {
+         m = ~(uint32)_mm256_movemask_epi8(
+               _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + i)), zero));
+         m = htoel(m);
+         memcpy(dst, &m, sizeof(m));
+         dst += 4;
+      }
+   }
+#endif
+#if defined(NEX_BITIO_SSE2)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      uint16 m;
+
+      for (; (i + 16) <= nbits; i += 16)
+      {
+         m = (uint16)~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + i)), zero));
+         m = htoes(m);
+         memcpy(dst, &m, sizeof(m));
+         dst += 2;
+      }
+   }
+#elif defined(NEX_BITIO_NEON)
+   {
+      const uint8x8_t mask = vreinterpret_u8_u64(vdup_n_u64(0x8040201008040201ULL));
+      uint8x8_t x;
+
+      for (; (i + 8) <= nbits; i += 8)
+      {
+         x = vld1_u8(src + i);
+         *dst++ = vaddv_u8(vand_u8(vtst_u8(x, x), mask));
+      }
+   }
+#endif
+   for (; (i + 8) <= nbits; i += 8)
+   {
+      *dst++ = nex_gatherbyte(src + i);
+   }
+   for (startbit = 0; i < nbits; i++, startbit++)
+   {
+      if (src[i])
+      {
+         *dst |= (uint8)(1 << startbit);
+      }
+      else
+      {
+         *dst &= (uint8)~(1 << startbit);
+      }
+   }
+}
+
+/** Add a slave bit range, merge with the previous range if adjacent. */
+static void nexx_bitio_addrun(nex_bitrunt *run, int *nrun, uint8 *iomap, uint8 startbit, uint32 nbits, uint32 channel)
+{
+   nex_bitrunt *prev;
+   uint32 end;
+
+   if (*nrun)
+   {
+      prev = &(run[*nrun - 1]);
+      end = prev->startbit + prev->nbits;
+      if (((prev->iomap + (end / 8)) == iomap) && ((end % 8) == startbit))
+      {
+         prev->nbits += nbits;
+         return;
+      }
+   }
+   run[*nrun].iomap = iomap;
+   run[*nrun].startbit = startbit;
+   run[*nrun].nbits = nbits;
+   run[*nrun].channel = channel;
+   (*nrun)++;
+}
+
+/** Initialise the channel arrays of the bit oriented slaves of a mapped group.
+ * Channels are numbered in slave order, ifirst and ofirst give the first
+ * channel of a slave.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] bitio          = bitio struct
+ * @param[in]  group          = group number
+ * @return 1 if successful, 0 if out of memory
+ */
+int nexx_bitio_init(nexx_contextt *context, nex_bitiot *bitio, uint8 group)
+{
+   uint16 slave, nslave;
+   uint32 memsize;
+   nex_slavet *sl;
+   uint8 *p;
+   int nirun = 0, norun = 0;
+
+   memset(bitio, 0x00, sizeof(nex_bitiot));
+   bitio->context = context;
+   bitio->group = group;
+   nslave = (uint16)(*(context->slavecount) + 1);
+   for (slave = 1; slave < nslave; slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if (!group || (group == sl->group))
+      {
+         if (sl->Ibits && !sl->Ibytes)
+         {
+            bitio->nin += sl->Ibits;
+            nirun++;
+         }
+         if (sl->Obits && !sl->Obytes)
+         {
+            bitio->nout += sl->Obits;
+            norun++;
+         }
+      }
+   }
+   memsize = 2 * nslave * sizeof(uint32) + (nirun + norun) * sizeof(nex_bitrunt) + bitio->nin + bitio->nout;
+   bitio->mem = osal_malloc(memsize);
+   if (!bitio->mem)
+   {
+      return 0;
+   }
+   memset(bitio->mem, 0x00, memsize);
+   p = bitio->mem;
+   bitio->ifirst = (uint32 *)p;
+   p += nslave * sizeof(uint32);
+   bitio->ofirst = (uint32 *)p;
+   p += nslave * sizeof(uint32);
+   bitio->irun = (nex_bitrunt *)p;
+   bitio->orun = bitio->irun + nirun;
+   p += (nirun + norun) * sizeof(nex_bitrunt);
+   bitio->inputs = p;
+   bitio->outputs = p + bitio->nin;
+   bitio->nin = 0;
+   bitio->nout = 0;
+   for (slave = 1; slave < nslave; slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      bitio->ifirst[slave] = bitio->nin;
+      bitio->ofirst[slave] = bitio->nout;
+      if (group && (group != sl->group))
+      {
+         continue;
+      }
+      if (sl->Ibits && !sl->Ibytes)
+      {
+         nexx_bitio_addrun(bitio->irun, &(bitio->nirun), sl->inputs, sl->Istartbit, sl->Ibits, bitio->nin);
+         bitio->nin += sl->Ibits;
+      }
+      if (sl->Obits && !sl->Obytes)
+      {
+         nexx_bitio_addrun(bitio->orun, &(bitio->norun), sl->outputs, sl->Ostartbit, sl->Obits, bitio->nout);
+         /* start with the outputs as they are now */
+         nex_unpackbits(sl->outputs, sl->Ostartbit, bitio->outputs + bitio->nout, sl->Obits);
+         bitio->nout += sl->Obits;
+      }
+   }
+
+   return 1;
+}
+
+/** Release the channel arrays.
+ *
+ * @param[in]  bitio          = bitio struct
+ */
+void nexx_bitio_close(nex_bitiot *bitio)
+{
+   if (bitio->mem)
+   {
+      osal_free(bitio->mem);
+   }
+   memset(bitio, 0x00, sizeof(nex_bitiot));
+}
+
+/** Expand the inputs of all bit oriented slaves to the input channels.
+ * Call after receiving the processdata.
+ *
+ * @param[in]  bitio          = bitio struct
+ */
+void nexx_bitio_unpack(nex_bitiot *bitio)
+{
+   int i;
+
+   for (i = 0; i < bitio->nirun; i++)
+   {
+      nex_unpackbits(bitio->irun[i].iomap, bitio->irun[i].startbit,
+         bitio->inputs + bitio->irun[i].channel, bitio->irun[i].nbits);
+   }
+}
+
+/** Collect the output channels to the outputs of all bit oriented slaves.
+ * Call before sending the processdata.
+ *
+ * @param[in]  bitio          = bitio struct
+ */
+void nexx_bitio_pack(nex_bitiot *bitio)
+{
+   int i;
+
+   for (i = 0; i < bitio->norun; i++)
+   {
+      nex_packbits(bitio->outputs + bitio->orun[i].channel, bitio->orun[i].iomap,
+         bitio->orun[i].startbit, bitio->orun[i].nbits);
+   }
+}
+
+#ifdef NEX_VER1
+int nex_bitio_init(nex_bitiot *bitio, uint8 group)
+{
+   return nexx_bitio_init(&nexx_context, bitio, group);
+}
+#endif
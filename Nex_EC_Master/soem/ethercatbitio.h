@@ -0,0 +1,78 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatbitio.c
+ */
+
+#ifndef _NEX_ECATBITIO_H
+#define _NEX_ECATBITIO_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** contiguous range of bits in the IOmap */
+typedef struct nex_bitrun
+{
+   /** first byte in IOmap */
+   uint8            *iomap;
+   /** first bit in first byte */
+   uint8            startbit;
+   /** number of bits */
+   uint32           nbits;
+   /** first channel in channel array */
+   uint32           channel;
+} nex_bitrunt;
+
+/** channel arrays of the bit oriented slaves of a group, one byte per bit */
+typedef struct nex_bitio
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** input channels, 0 or 1 */
+   uint8            *inputs;
+   /** number of input channels */
+   uint32           nin;
+   /** output channels, 0 or not 0 */
+   uint8            *outputs;
+   /** number of output channels */
+   uint32           nout;
+   /** first input channel per slave, index is slave number */
+   uint32           *ifirst;
+   /** first output channel per slave, index is slave number */
+   uint32           *ofirst;
+   /** input bit ranges, adjacent slaves merged */
+   nex_bitrunt      *irun;
+   /** number of input bit ranges */
+   int              nirun;
+   /** output bit ranges, adjacent slaves merged */
+   nex_bitrunt      *orun;
+   /** number of output bit ranges */
+   int              norun;
+   /** internal, memory of all arrays */
+   uint8            *mem;
+} nex_bitiot;
+
+#ifdef NEX_VER1
+int nex_bitio_init(nex_bitiot *bitio, uint8 group);
+#endif
+
+void nex_unpackbits(const uint8 *src, uint8 startbit, uint8 *dst, uint32 nbits);
+void nex_packbits(const uint8 *src, uint8 *dst, uint8 startbit, uint32 nbits);
+int nexx_bitio_init(nexx_contextt *context, nex_bitiot *bitio, uint8 group);
+void nexx_bitio_close(nex_bitiot *bitio);
+void nexx_bitio_unpack(nex_bitiot *bitio);
+void nexx_bitio_pack(nex_bitiot *bitio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATBITIO_H */
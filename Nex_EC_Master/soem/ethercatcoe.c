@@ -17,6 +17,7 @@
 #include "ethercattype.h"
 #include "ethercatbase.h"
 #include "ethercatmain.h"
+#include "ethercatmbxq.h"
 #include "ethercatcoe.h"
 
 /** SDO structure, not to be confused with EcSDOserviceT */
@@ -126,16 +127,24 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
    int32 SDOlen;
    uint8 *bp;
    uint8 *hp;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt, toggle;
    boolean NotLast;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOt *)&MbxIn;
-   SDOp = (nex_SDOt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOt *)MbxIn;
+   SDOp = (nex_SDOt *)MbxOut;
    SDOp->MbxHeader.length = htoes(0x000a);
    SDOp->MbxHeader.address = htoes(0x0000);
    SDOp->MbxHeader.priority = 0x00;
@@ -160,13 +169,13 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
    SDOp->SubIndex = subindex;
    SDOp->ldata[0] = 0;
    /* send CoE request to slave */
-   wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
    if (wkc > 0) /* succeeded to place mailbox in slave ? */
    {
       /* clean mailboxbuffer */
-      nex_clearmbx(&MbxIn);
+      nexx_mbxclear(context, slave, MbxIn, FALSE);
       /* read slave response */
-      wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+      wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
       if (wkc > 0) /* succeeded to read slave response ? */
       {
          /* slave response should be CoE, SDO response and the correct index */
@@ -212,7 +221,7 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
                      toggle= 0x00;
                      while (NotLast) /* segmented transfer */
                      {
-                        SDOp = (nex_SDOt *)&MbxOut;
+                        SDOp = (nex_SDOt *)MbxOut;
                         SDOp->MbxHeader.length = htoes(0x000a);
                         SDOp->MbxHeader.address = htoes(0x0000);
                         SDOp->MbxHeader.priority = 0x00;
@@ -225,13 +234,13 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
                         SDOp->SubIndex = subindex;
                         SDOp->ldata[0] = 0;
                         /* send segmented upload request to slave */
-                        wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+                        wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
                         /* is mailbox transfered to slave ? */
                         if (wkc > 0)
                         {
-                           nex_clearmbx(&MbxIn);
+                           nexx_mbxclear(context, slave, MbxIn, FALSE);
                            /* read slave response */
-                           wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+                           wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
                            /* has slave responded ? */
                            if (wkc > 0)
                            {
@@ -307,6 +316,8 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
          }
       }
    }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -332,18 +343,26 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
 {
    nex_SDOt *SDOp, *aSDOp;
    int wkc, maxdata;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt, toggle;
    uint16 framedatasize;
    boolean  NotLast;
    uint8 *hp;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, Slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOt *)&MbxIn;
-   SDOp = (nex_SDOt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOt *)MbxIn;
+   SDOp = (nex_SDOt *)MbxOut;
    maxdata = context->slavelist[Slave].mbx_l - 0x10; /* data section=mailbox size - 6 mbx - 2 CoE - 8 sdo req */
    /* if small data use expedited transfer */
    if ((psize <= 4) && !CA)
@@ -363,12 +382,12 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
       /* copy parameter data to mailbox */
       memcpy(&SDOp->ldata[0], hp, psize);
       /* send mailbox SDO download request to slave */
-      wkc = nexx_mbxsend(context, Slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+      wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
       if (wkc > 0)
       {
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, Slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, Slave, (nex_mbxbuft *)&MbxIn, Timeout);
+         wkc = nexx_mbxreceive(context, Slave, MbxIn, Timeout);
          if (wkc > 0)
          {
             /* response should be CoE, SDO response, correct index and subindex */
@@ -433,12 +452,12 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
       hp += framedatasize;
       psize -= framedatasize;
       /* send mailbox SDO download request to slave */
-      wkc = nexx_mbxsend(context, Slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+      wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
       if (wkc > 0)
       {
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, Slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, Slave, (nex_mbxbuft *)&MbxIn, Timeout);
+         wkc = nexx_mbxreceive(context, Slave, MbxIn, Timeout);
          if (wkc > 0)
          {
             /* response should be CoE, SDO response, correct index and subindex */
@@ -453,7 +472,7 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
                /* repeat while segments left */
                while (NotLast)
                {
-                  SDOp = (nex_SDOt *)&MbxOut;
+                  SDOp = (nex_SDOt *)MbxOut;
                   framedatasize = psize;
                   NotLast = FALSE;
                   SDOp->Command = 0x01; /* last segment */
@@ -486,12 +505,12 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
                   hp += framedatasize;
                   psize -= framedatasize;
                   /* send SDO download request */
-                  wkc = nexx_mbxsend(context, Slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+                  wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
                   if (wkc > 0)
                   {
-                     nex_clearmbx(&MbxIn);
+                     nexx_mbxclear(context, Slave, MbxIn, FALSE);
                      /* read slave response */
-                     wkc = nexx_mbxreceive(context, Slave, (nex_mbxbuft *)&MbxIn, Timeout);
+                     wkc = nexx_mbxreceive(context, Slave, MbxIn, Timeout);
                      if (wkc > 0)
                      {
                         if (((aSDOp->MbxHeader.mbxtype & 0x0f) == ECT_MBXT_COE) &&
@@ -535,7 +554,855 @@ int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubI
       }
    }
 
-   return wkc;
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
+   return wkc;
+}
+
+/** Send a SDO abort request, f.e. when the application stops a transfer. */
+static void nexx_SDOabort(nexx_contextt *context, uint16 slave, uint16 index, uint8 subindex, int32 abortcode)
+{
+   nex_SDOt *SDOp;
+   nex_mbxbuft *MbxOut;
+   uint8 cnt;
+
+   MbxOut = nexx_mbxget(context);
+   if (!MbxOut)
+   {
+      return;
+   }
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   SDOp = (nex_SDOt *)MbxOut;
+   SDOp->MbxHeader.length = htoes(0x000a);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   cnt = nex_nextmbxcnt(context->slavelist[slave].mbx_cnt);
+   context->slavelist[slave].mbx_cnt = cnt;
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOREQ << 12)); /* number 9bits service upper 4 bits (SDO request) */
+   SDOp->Command = ECT_SDO_ABORT;
+   SDOp->Index = htoes(index);
+   SDOp->SubIndex = subindex;
+   SDOp->ldata[0] = htoel(abortcode);
+   nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
+   nexx_SDOerror(context, slave, index, subindex, abortcode);
+   nexx_mbxput(context, MbxOut);
+}
+
+/** Fill n bytes from the chunk callback of a download.
+ * @return n or -1 if the callback stopped the transfer */
+static int nexx_SDOchunk_fill(nex_SDOchunkt chunk, void *arg, uint8 *p, int n)
+{
+   int i, r;
+
+   for (i = 0; i < n; i += r)
+   {
+      r = chunk(arg, p + i, n - i);
+      if (r <= 0)
+      {
+         return -1;
+      }
+   }
+   return n;
+}
+
+/** Bytes of a response mailbox from offset to the end of the read mailbox. */
+static int nexx_SDOread_payload(nexx_contextt *context, uint16 slave, int offset)
+{
+   int size = context->slavelist[slave].mbx_rl;
+
+   if (size > NEX_MAXMBX)
+   {
+      size = NEX_MAXMBX;
+   }
+   return size - offset;
+}
+
+/** Streaming upload with the mailbox buffers of the caller. */
+static int nexx_SDOread_streambuf(nexx_contextt *context, nex_mbxbuft *MbxIn, nex_mbxbuft *MbxOut,
+                                  uint16 slave, uint16 index, uint8 subindex,
+                                  boolean CA, nex_SDOchunkt chunk, void *arg, int32 *psize, int timeout)
+{
+   nex_SDOt *SDOp, *aSDOp;
+   int wkc, framedatasize;
+   int32 SDOlen;
+   uint8 cnt, toggle;
+   boolean NotLast;
+
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
+   /* Empty slave out mailbox if something is in. Timout set to 0 */
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOt *)MbxIn;
+   SDOp = (nex_SDOt *)MbxOut;
+   if (CA && (subindex > 1))
+   {
+      subindex = 1;
+   }
+   SDOp->MbxHeader.length = htoes(0x000a);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   cnt = nex_nextmbxcnt(context->slavelist[slave].mbx_cnt);
+   context->slavelist[slave].mbx_cnt = cnt;
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOREQ << 12)); /* number 9bits service upper 4 bits (SDO request) */
+   SDOp->Command = CA ? ECT_SDO_UP_REQ_CA : ECT_SDO_UP_REQ;
+   SDOp->Index = htoes(index);
+   SDOp->SubIndex = subindex;
+   SDOp->ldata[0] = 0;
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
+   if (wkc > 0)
+   {
+      wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
+   }
+   if (wkc <= 0)
+   {
+      return wkc;
+   }
+   if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+       ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES) ||
+       (aSDOp->Index != SDOp->Index))
+   {
+      if (aSDOp->Command == ECT_SDO_ABORT) /* SDO abort frame received */
+      {
+         nexx_SDOerror(context, slave, index, subindex, etohl(aSDOp->ldata[0]));
+      }
+      else
+      {
+         nexx_packeterror(context, slave, index, subindex, 1); /* Unexpected frame returned */
+      }
+      return 0;
+   }
+   if ((aSDOp->Command & 0x02) > 0)
+   {
+      /* expedited frame response, the transfer is complete */
+      framedatasize = 4 - ((aSDOp->Command >> 2) & 0x03);
+      if (chunk(arg, (uint8 *)&(aSDOp->ldata[0]), framedatasize) < 0)
+      {
+         return 0;
+      }
+      *psize = framedatasize;
+      return wkc;
+   }
+   /* normal frame response */
+   SDOlen = etohl(aSDOp->ldata[0]);
+   framedatasize = etohs(aSDOp->MbxHeader.length) - 10;
+   if ((framedatasize < 0) || (SDOlen < 0) ||
+       (framedatasize > nexx_SDOread_payload(context, slave, (int)((uint8 *)&(aSDOp->ldata[1]) - (uint8 *)aSDOp))))
+   {
+      /* malformed response, the data would not be in the mailbox. The
+         initiate response of a segmented transfer has no data. */
+      nexx_packeterror(context, slave, index, subindex, 1); /* Unexpected frame returned */
+      nexx_SDOabort(context, slave, index, subindex, NEX_SDO_ABORT_GENERAL);
+      return 0;
+   }
+   NotLast = (boolean)(framedatasize < SDOlen);
+   if (framedatasize > SDOlen)
+   {
+      framedatasize = SDOlen;
+   }
+   if ((framedatasize > 0) && (chunk(arg, (uint8 *)&(aSDOp->ldata[1]), framedatasize) < 0))
+   {
+      nexx_SDOabort(context, slave, index, subindex, NEX_SDO_ABORT_STOPPED);
+      return 0;
+   }
+   *psize = framedatasize;
+   toggle = 0x00;
+   /* the segment requests only differ in counter and command */
+   while (NotLast)
+   {
+      cnt = nex_nextmbxcnt(context->slavelist[slave].mbx_cnt);
+      context->slavelist[slave].mbx_cnt = cnt;
+      SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+      SDOp->Command = ECT_SDO_SEG_UP_REQ + toggle; /* segment upload request */
+      wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
+      if (wkc > 0)
+      {
+         wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
+      }
+      if (wkc <= 0)
+      {
+         break;
+      }
+      if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+          ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES) ||
+          ((aSDOp->Command & 0xe0) != 0x00))
+      {
+         if (aSDOp->Command == ECT_SDO_ABORT) /* SDO abort frame received */
+         {
+            nexx_SDOerror(context, slave, index, subindex, etohl(aSDOp->ldata[0]));
+         }
+         else
+         {
+            nexx_packeterror(context, slave, index, subindex, 1); /* Unexpected frame returned */
+         }
+         wkc = 0;
+         break;
+      }
+      framedatasize = etohs(aSDOp->MbxHeader.length) - 3;
+      if ((aSDOp->Command & 0x01) > 0)
+      { /* last segment */
+         NotLast = FALSE;
+         if (framedatasize == 7)
+         {
+            /* substract unused bytes from frame */
+            framedatasize = framedatasize - ((aSDOp->Command & 0x0e) >> 1);
+         }
+      }
+      /* only the last segment may be empty */
+      if ((framedatasize < 0) || (NotLast && !framedatasize) ||
+          (framedatasize > nexx_SDOread_payload(context, slave, (int)((uint8 *)&(aSDOp->Index) - (uint8 *)aSDOp))))
+      {
+         /* malformed segment, the data would not be in the mailbox */
+         nexx_packeterror(context, slave, index, subindex, 1); /* Unexpected frame returned */
+         nexx_SDOabort(context, slave, index, subindex, NEX_SDO_ABORT_GENERAL);
+         wkc = 0;
+         break;
+      }
+      if (chunk(arg, (uint8 *)&(aSDOp->Index), framedatasize) < 0)
+      {
+         if (NotLast)
+         {
+            nexx_SDOabort(context, slave, index, subindex, NEX_SDO_ABORT_STOPPED);
+         }
+         wkc = 0;
+         break;
+      }
+      *psize += framedatasize;
+      toggle = toggle ^ 0x10; /* toggle bit for segment request */
+   }
+   return wkc;
+}
+
+/** CoE SDO read streaming, blocking. Single subindex or Complete Access.
+ *
+ * Like nexx_SDOread(), but the data is passed to the chunk callback as it
+ * arrives, segment by segment, instead of being collected in a buffer. The
+ * size of the object is not limited, f.e. for large domain objects written
+ * to a file. Each segment uses the full read mailbox of the slave, the
+ * mailboxes are not cleared or copied between segments. If the callback
+ * returns <0 the transfer is aborted.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  slave      = Slave number
+ * @param[in]  index      = Index to read
+ * @param[in]  subindex   = Subindex to read, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes read.
+ * @param[in]  chunk      = called with each piece of data
+ * @param[in]  arg        = argument of chunk
+ * @param[out] psize      = bytes read from SDO
+ * @param[in]  timeout    = Timeout per segment in us, standard is NEX_TIMEOUTRXM
+ * @return Workcounter from last slave response
+ */
+int nexx_SDOread_stream(nexx_contextt *context, uint16 slave, uint16 index, uint8 subindex,
+                        boolean CA, nex_SDOchunkt chunk, void *arg, int32 *psize, int timeout)
+{
+   nex_mbxbuft *MbxIn, *MbxOut;
+   int wkc;
+
+   wkc = 0;
+   *psize = 0;
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (MbxIn && MbxOut)
+   {
+      wkc = nexx_SDOread_streambuf(context, MbxIn, MbxOut, slave, index, subindex, CA, chunk, arg, psize, timeout);
+   }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
+   return wkc;
+}
+
+/** Streaming download with the mailbox buffers of the caller. */
+static int nexx_SDOwrite_streambuf(nexx_contextt *context, nex_mbxbuft *MbxIn, nex_mbxbuft *MbxOut,
+                                   uint16 Slave, uint16 Index, uint8 SubIndex,
+                                   boolean CA, int32 size, nex_SDOchunkt chunk, void *arg, int Timeout)
+{
+   nex_SDOt *SDOp, *aSDOp;
+   int wkc, maxdata, framedatasize;
+   uint8 cnt, toggle, command;
+   boolean NotLast;
+   uint8 small[4];
+
+   if (size < 0)
+   {
+      return 0;
+   }
+   if ((size <= 4) && !CA)
+   {
+      /* expedited transfer */
+      if (nexx_SDOchunk_fill(chunk, arg, small, size) < 0)
+      {
+         return 0;
+      }
+      return nexx_SDOwrite(context, Slave, Index, SubIndex, CA, size, small, Timeout);
+   }
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
+   /* Empty slave out mailbox if something is in. Timout set to 0 */
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOt *)MbxIn;
+   SDOp = (nex_SDOt *)MbxOut;
+   maxdata = context->slavelist[Slave].mbx_l - 0x10; /* data section=mailbox size - 6 mbx - 2 CoE - 8 sdo req */
+   framedatasize = (size > maxdata) ? maxdata : size;
+   NotLast = (boolean)(size > maxdata);
+   if (nexx_SDOchunk_fill(chunk, arg, (uint8 *)&(SDOp->ldata[1]), framedatasize) < 0)
+   {
+      return 0;
+   }
+   SDOp->MbxHeader.length = htoes(0x0a + framedatasize);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   cnt = nex_nextmbxcnt(context->slavelist[Slave].mbx_cnt);
+   context->slavelist[Slave].mbx_cnt = cnt;
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOREQ << 12)); /* number 9bits service upper 4 bits */
+   SDOp->Command = CA ? ECT_SDO_DOWN_INIT_CA : ECT_SDO_DOWN_INIT;
+   SDOp->Index = htoes(Index);
+   SDOp->SubIndex = (CA && (SubIndex > 1)) ? 1 : SubIndex;
+   SDOp->ldata[0] = htoel(size);
+   size -= framedatasize;
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
+   if (wkc > 0)
+   {
+      wkc = nexx_mbxreceive(context, Slave, MbxIn, Timeout);
+   }
+   if (wkc <= 0)
+   {
+      return wkc;
+   }
+   if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+       ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES) ||
+       (aSDOp->Index != SDOp->Index) ||
+       (aSDOp->SubIndex != SDOp->SubIndex))
+   {
+      if (aSDOp->Command == ECT_SDO_ABORT) /* SDO abort frame received */
+      {
+         nexx_SDOerror(context, Slave, Index, SubIndex, etohl(aSDOp->ldata[0]));
+      }
+      else
+      {
+         nexx_packeterror(context, Slave, Index, SubIndex, 1); /* Unexpected frame returned */
+      }
+      return 0;
+   }
+   maxdata += 7;
+   toggle = 0;
+   /* the segments are filled in place, only length, counter and command change */
+   while (NotLast)
+   {
+      framedatasize = size;
+      NotLast = FALSE;
+      command = 0x01; /* last segment */
+      if (framedatasize > maxdata)
+      {
+         framedatasize = maxdata;  /*  more segments needed  */
+         NotLast = TRUE;
+         command = 0x00; /* segments follow */
+      }
+      if (nexx_SDOchunk_fill(chunk, arg, (uint8 *)&(SDOp->Index), framedatasize) < 0)
+      {
+         nexx_SDOabort(context, Slave, Index, SubIndex, NEX_SDO_ABORT_STOPPED);
+         wkc = 0;
+         break;
+      }
+      if (!NotLast && (framedatasize < 7))
+      {
+         SDOp->MbxHeader.length = htoes(0x0a); /* minimum size */
+         command = 0x01 + ((7 - framedatasize) << 1); /* last segment reduced octets */
+      }
+      else
+      {
+         SDOp->MbxHeader.length = htoes(framedatasize + 3); /* data + 2 CoE + 1 SDO */
+      }
+      cnt = nex_nextmbxcnt(context->slavelist[Slave].mbx_cnt);
+      context->slavelist[Slave].mbx_cnt = cnt;
+      SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+      SDOp->Command = command + toggle; /* add toggle bit to command byte */
+      size -= framedatasize;
+      wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
+      if (wkc > 0)
+      {
+         wkc = nexx_mbxreceive(context, Slave, MbxIn, Timeout);
+      }
+      if (wkc <= 0)
+      {
+         break;
+      }
+      if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+          ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES) ||
+          ((aSDOp->Command & 0xe0) != 0x20))
+      {
+         if (aSDOp->Command == ECT_SDO_ABORT) /* SDO abort frame received */
+         {
+            nexx_SDOerror(context, Slave, Index, SubIndex, etohl(aSDOp->ldata[0]));
+         }
+         else
+         {
+            nexx_packeterror(context, Slave, Index, SubIndex, 1); /* Unexpected frame returned */
+         }
+         wkc = 0;
+         break;
+      }
+      toggle = toggle ^ 0x10; /* toggle bit for segment request */
+   }
+   return wkc;
+}
+
+/** CoE SDO write streaming, blocking. Single subindex or Complete Access.
+ *
+ * Like nexx_SDOwrite(), but the data is taken from the chunk callback
+ * segment by segment, straight into the mailbox. The callback fills up to
+ * the requested bytes and returns the bytes filled, <=0 aborts the transfer.
+ * Each segment uses the full write mailbox of the slave.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  Slave      = Slave number
+ * @param[in]  Index      = Index to write
+ * @param[in]  SubIndex   = Subindex to write, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes written.
+ * @param[in]  size       = Total size in bytes
+ * @param[in]  chunk      = called to fill each piece of data
+ * @param[in]  arg        = argument of chunk
+ * @param[in]  Timeout    = Timeout per segment in us, standard is NEX_TIMEOUTRXM
+ * @return Workcounter from last slave response
+ */
+int nexx_SDOwrite_stream(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubIndex,
+                         boolean CA, int32 size, nex_SDOchunkt chunk, void *arg, int Timeout)
+{
+   nex_mbxbuft *MbxIn, *MbxOut;
+   int wkc;
+
+   wkc = 0;
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (MbxIn && MbxOut)
+   {
+      wkc = nexx_SDOwrite_streambuf(context, MbxIn, MbxOut, Slave, Index, SubIndex, CA, size, chunk, arg, Timeout);
+   }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
+   return wkc;
+}
+
+/** Check the response of an asynchronous SDO upload. */
+static int nexx_SDOread_parse(nexx_contextt *context, nex_mbxreqt *req)
+{
+   nex_SDOt *aSDOp = (nex_SDOt *)&(req->in);
+   int32 SDOlen;
+   int bytesize;
+
+   if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+       ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES))
+   {
+      /* not a SDO response, f.e. a response of another protocol */
+      return 0;
+   }
+   if (aSDOp->Command == ECT_SDO_ABORT)
+   {
+      req->abortcode = (int32)etohl(aSDOp->ldata[0]);
+      nexx_SDOerror(context, req->slave, req->index, req->subindex, req->abortcode);
+      return -1;
+   }
+   if (etohs(aSDOp->Index) != req->index)
+   {
+      nexx_packeterror(context, req->slave, req->index, req->subindex, 1); /* Unexpected frame returned */
+      return -1;
+   }
+   if ((aSDOp->Command & 0x02) > 0)
+   {
+      /* expedited frame response */
+      bytesize = 4 - ((aSDOp->Command >> 2) & 0x03);
+      if (req->size < bytesize)
+      {
+         nexx_packeterror(context, req->slave, req->index, req->subindex, 3); /*  data container too small for type */
+         return -1;
+      }
+      memcpy(req->p, &aSDOp->ldata[0], bytesize);
+      req->size = bytesize;
+      return 1;
+   }
+   /* normal frame response, segmented transfers need the blocking call */
+   SDOlen = etohl(aSDOp->ldata[0]);
+   if (SDOlen > req->size)
+   {
+      nexx_packeterror(context, req->slave, req->index, req->subindex, 3); /*  data container too small for type */
+      return -1;
+   }
+   if (SDOlen > (etohs(aSDOp->MbxHeader.length) - 10))
+   {
+      /* segmented, fails without abort code */
+      return -1;
+   }
+   memcpy(req->p, &aSDOp->ldata[1], SDOlen);
+   req->size = SDOlen;
+
+   return 1;
+}
+
+/** Check the response of an asynchronous SDO download. */
+static int nexx_SDOwrite_parse(nexx_contextt *context, nex_mbxreqt *req)
+{
+   nex_SDOt *aSDOp = (nex_SDOt *)&(req->in);
+
+   if (((aSDOp->MbxHeader.mbxtype & 0x0f) != ECT_MBXT_COE) ||
+       ((etohs(aSDOp->CANOpen) >> 12) != ECT_COES_SDORES))
+   {
+      return 0;
+   }
+   if (aSDOp->Command == ECT_SDO_ABORT)
+   {
+      req->abortcode = (int32)etohl(aSDOp->ldata[0]);
+      nexx_SDOerror(context, req->slave, req->index, req->subindex, req->abortcode);
+      return -1;
+   }
+   if ((etohs(aSDOp->Index) != req->index) || (aSDOp->SubIndex != req->subindex))
+   {
+      nexx_packeterror(context, req->slave, req->index, req->subindex, 1); /* Unexpected frame returned */
+      return -1;
+   }
+
+   return 1;
+}
+
+/** CoE SDO read, asynchronous. Single subindex or Complete Access.
+ *
+ * The upload request is submitted to the mailbox engine and carried by the
+ * processdata cycle, the function returns immediately. Poll req->state for
+ * NEX_MBXREQ_DONE or NEX_MBXREQ_ERROR or use the callback. When done
+ * req->size holds the bytes read. Only expedited and normal responses are
+ * handled, objects larger than the mailbox fail with abortcode 0 and need
+ * nexx_SDOread().
+ *
+ * @param[in]  mbxq       = mailbox engine
+ * @param[out] req        = request, must stay valid until done or error
+ * @param[in]  slave      = Slave number
+ * @param[in]  index      = Index to read
+ * @param[in]  subindex   = Subindex to read, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes read.
+ * @param[in]  size       = Size in bytes of parameter buffer
+ * @param[out] p          = Pointer to parameter buffer
+ * @param[in]  timeout    = Timeout in us, standard is NEX_TIMEOUTRXM
+ * @param[in]  callback   = called by the processdata thread when done or failed, NULL = poll
+ * @param[in]  arg        = argument of callback
+ * @return 1 if submitted, 0 if not
+ */
+int nexx_SDOread_async(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 slave, uint16 index, uint8 subindex,
+                       boolean CA, int size, void *p, int timeout,
+                       void (*callback)(nex_mbxreqt *req, void *arg), void *arg)
+{
+   nex_SDOt *SDOp;
+
+   nexx_mbxq_clear(mbxq, req, slave);
+   if (CA && (subindex > 1))
+   {
+      subindex = 1;
+   }
+   SDOp = (nex_SDOt *)&(req->out);
+   SDOp->MbxHeader.length = htoes(0x000a);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   /* mailbox counter is set when the request is started */
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE; /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOREQ << 12)); /* number 9bits service upper 4 bits (SDO request) */
+   SDOp->Command = CA ? ECT_SDO_UP_REQ_CA : ECT_SDO_UP_REQ;
+   SDOp->Index = htoes(index);
+   SDOp->SubIndex = subindex;
+   SDOp->ldata[0] = 0;
+   req->slave = slave;
+   req->response = TRUE;
+   req->timeout = timeout;
+   req->parse = &nexx_SDOread_parse;
+   req->callback = callback;
+   req->arg = arg;
+   req->index = index;
+   req->subindex = subindex;
+   req->p = p;
+   req->size = size;
+
+   return nexx_mbxq_submit(mbxq, req);
+}
+
+/** CoE SDO write, asynchronous. Single subindex or Complete Access.
+ *
+ * Like nexx_SDOread_async(), an expedited download is used for small data,
+ * otherwise a normal download. Parameters larger than the mailbox need
+ * nexx_SDOwrite(). The data is copied to the request on submit.
+ *
+ * @param[in]  mbxq       = mailbox engine
+ * @param[out] req        = request, must stay valid until done or error
+ * @param[in]  Slave      = Slave number
+ * @param[in]  Index      = Index to write
+ * @param[in]  SubIndex   = Subindex to write, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes written.
+ * @param[in]  psize      = Size in bytes of parameter buffer.
+ * @param[in]  p          = Pointer to parameter buffer
+ * @param[in]  Timeout    = Timeout in us, standard is NEX_TIMEOUTRXM
+ * @param[in]  callback   = called by the processdata thread when done or failed, NULL = poll
+ * @param[in]  arg        = argument of callback
+ * @return 1 if submitted, 0 if not
+ */
+int nexx_SDOwrite_async(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 Slave, uint16 Index, uint8 SubIndex,
+                        boolean CA, int psize, const void *p, int Timeout,
+                        void (*callback)(nex_mbxreqt *req, void *arg), void *arg)
+{
+   nex_SDOt *SDOp;
+   int maxdata;
+
+   nexx_mbxq_clear(mbxq, req, Slave);
+   if ((Slave > *(mbxq->context->slavecount)) || (psize < 0))
+   {
+      return 0;
+   }
+   if (CA && (SubIndex > 1))
+   {
+      SubIndex = 1;
+   }
+   maxdata = mbxq->context->slavelist[Slave].mbx_l - 0x10; /* data section=mailbox size - 6 mbx - 2 CoE - 8 sdo req */
+   SDOp = (nex_SDOt *)&(req->out);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   /* mailbox counter is set when the request is started */
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE; /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOREQ << 12)); /* number 9bits service upper 4 bits */
+   SDOp->Index = htoes(Index);
+   SDOp->SubIndex = SubIndex;
+   /* if small data use expedited transfer */
+   if ((psize <= 4) && !CA)
+   {
+      SDOp->MbxHeader.length = htoes(0x000a);
+      SDOp->Command = ECT_SDO_DOWN_EXP | (((4 - psize) << 2) & 0x0c); /* expedited SDO download transfer */
+      memcpy(&SDOp->ldata[0], p, psize);
+   }
+   else if (psize <= maxdata)
+   {
+      SDOp->MbxHeader.length = htoes((uint16)(0x0a + psize));
+      SDOp->Command = CA ? ECT_SDO_DOWN_INIT_CA : ECT_SDO_DOWN_INIT;
+      SDOp->ldata[0] = htoel(psize);
+      memcpy(&SDOp->ldata[1], p, psize);
+   }
+   else
+   {
+      /* segmented transfer, use nexx_SDOwrite() */
+      return 0;
+   }
+   req->slave = Slave;
+   req->response = TRUE;
+   req->timeout = Timeout;
+   req->parse = &nexx_SDOwrite_parse;
+   req->callback = callback;
+   req->arg = arg;
+   req->index = Index;
+   req->subindex = SubIndex;
+   req->size = psize;
+
+   return nexx_mbxq_submit(mbxq, req);
+}
+
+
+/** Check if an asynchronous SDO read failed because the object needs a
+ * segmented upload. Continue such a read with nexx_SDOread().
+ *
+ * @param[in]  req        = failed request of nexx_SDOread_async()
+ * @return TRUE if segmented
+ */
+boolean nexx_SDOread_segmented(nex_mbxreqt *req)
+{
+   nex_SDOt *aSDOp = (nex_SDOt *)&(req->in);
+
+   return (boolean)((req->state == NEX_MBXREQ_ERROR) && !req->abortcode &&
+                    ((aSDOp->MbxHeader.mbxtype & 0x0f) == ECT_MBXT_COE) &&
+                    ((etohs(aSDOp->CANOpen) >> 12) == ECT_COES_SDORES) &&
+                    !(aSDOp->Command & 0x02));
+}
+
+/** state of a SDO batch */
+typedef struct
+{
+   nex_mbxqt    mbxq;
+   nex_SDOopt   *op;
+   int          n;
+   int          timeout;
+   /** number of finished requests, tells a step made progress */
+   int          finished;
+   /** operation in progress per slave, -1 = none */
+   int          cur[NEX_MAXSLAVE];
+   /** first operation per slave left for the blocking calls, -1 = none */
+   int          resume[NEX_MAXSLAVE];
+   /** one request per slave, indexed by slave number */
+   nex_mbxreqt  req[1];
+} nex_SDObatcht;
+
+static void nexx_SDObatch_done(nex_mbxreqt *req, void *arg);
+
+/** Submit the next operation of a slave, starting at operation i. */
+static void nexx_SDObatch_next(nex_SDObatcht *batch, uint16 slave, int i)
+{
+   nex_SDOopt *op;
+   int ok;
+
+   for (; i < batch->n; i++)
+   {
+      op = &(batch->op[i]);
+      if (op->slave != slave)
+      {
+         continue;
+      }
+      batch->cur[slave] = i;
+      if (op->write)
+      {
+         ok = nexx_SDOwrite_async(&(batch->mbxq), &(batch->req[slave]), slave, op->index, op->subindex,
+            op->CA, op->size, op->p, batch->timeout, &nexx_SDObatch_done, batch);
+      }
+      else
+      {
+         ok = nexx_SDOread_async(&(batch->mbxq), &(batch->req[slave]), slave, op->index, op->subindex,
+            op->CA, op->size, op->p, batch->timeout, &nexx_SDObatch_done, batch);
+      }
+      if (!ok)
+      {
+         /* segmented download, this and the following operations keep their order */
+         batch->resume[slave] = i;
+         break;
+      }
+      return;
+   }
+   batch->cur[slave] = -1;
+}
+
+/** Result of a batch operation, submit the next operation of the slave. */
+static void nexx_SDObatch_done(nex_mbxreqt *req, void *arg)
+{
+   nex_SDObatcht *batch = (nex_SDObatcht *)arg;
+   nex_SDOopt *op;
+   int i;
+
+   batch->finished++;
+   i = batch->cur[req->slave];
+   op = &(batch->op[i]);
+   op->abortcode = req->abortcode;
+   if (req->state == NEX_MBXREQ_DONE)
+   {
+      op->wkc = 1;
+      op->size = req->size;
+   }
+   else if (!op->write && nexx_SDOread_segmented(req))
+   {
+      /* segmented upload */
+      batch->resume[req->slave] = i;
+      batch->cur[req->slave] = -1;
+      return;
+   }
+   nexx_SDObatch_next(batch, req->slave, i + 1);
+}
+
+/** CoE SDO transfers of many slaves, blocking.
+ *
+ * The operations of different slaves run in parallel, the operations of one
+ * slave in list order. Each step packs the mailbox writes, SM status reads
+ * and mailbox reads of all slaves with an operation in progress in as few
+ * frames as possible, see nexx_mbxq_run(). Transfers that need segments
+ * continue with nexx_SDOread() or nexx_SDOwrite() after the batch, together
+ * with the remaining operations of that slave.
+ *
+ * @param[in]  context    = context struct
+ * @param[in,out] op      = operations, the results are set per operation
+ * @param[in]  n          = number of operations
+ * @param[in]  timeout    = Timeout per operation in us, standard is NEX_TIMEOUTRXM
+ * @return number of successful operations
+ */
+int nexx_SDObatch(nexx_contextt *context, nex_SDOopt *op, int n, int timeout)
+{
+   nex_SDObatcht *batch;
+   nex_SDOopt *o;
+   uint16 slave, nslave;
+   int i, size, active, finished, done = 0;
+
+   nslave = (uint16)*(context->slavecount);
+   if (nslave >= NEX_MAXSLAVE)
+   {
+      nslave = NEX_MAXSLAVE - 1;
+   }
+   batch = (nex_SDObatcht *)osal_malloc(sizeof(nex_SDObatcht) + nslave * sizeof(nex_mbxreqt));
+   if (!batch)
+   {
+      return 0;
+   }
+   nexx_mbxq_open(context, &(batch->mbxq));
+   batch->op = op;
+   batch->n = n;
+   batch->timeout = timeout;
+   batch->finished = 0;
+   for (i = 0; i < n; i++)
+   {
+      op[i].wkc = 0;
+      op[i].abortcode = 0;
+   }
+   for (slave = 0; slave < NEX_MAXSLAVE; slave++)
+   {
+      batch->cur[slave] = -1;
+      batch->resume[slave] = -1;
+   }
+   for (i = 0; i < n; i++)
+   {
+      slave = op[i].slave;
+      if (!slave || (slave > nslave))
+      {
+         continue;
+      }
+      if ((batch->cur[slave] < 0) && (batch->resume[slave] < 0))
+      {
+         /* first operation of the slave, submitted or left for the blocking calls */
+         nexx_SDObatch_next(batch, slave, i);
+      }
+   }
+   do
+   {
+      finished = batch->finished;
+      active = nexx_mbxq_run(&(batch->mbxq));
+      if ((active > 0) && (batch->finished == finished))
+      {
+         /* no request finished, give the slaves time to answer */
+         osal_usleep(NEX_SDOBATCHDELAY);
+      }
+   } while (active > 0);
+   /* segmented transfers and the rest of their slave */
+   for (slave = 1; slave <= nslave; slave++)
+   {
+      if (batch->resume[slave] < 0)
+      {
+         continue;
+      }
+      for (i = batch->resume[slave]; i < n; i++)
+      {
+         o = &(op[i]);
+         if (o->slave != slave)
+         {
+            continue;
+         }
+         if (o->write)
+         {
+            o->wkc = nexx_SDOwrite(context, slave, o->index, o->subindex, o->CA, o->size, o->p, timeout);
+         }
+         else
+         {
+            size = o->size;
+            o->wkc = nexx_SDOread(context, slave, o->index, o->subindex, o->CA, &size, o->p, timeout);
+            o->size = size;
+         }
+      }
+   }
+   nexx_mbxq_close(&(batch->mbxq));
+   osal_free(batch);
+   for (i = 0; i < n; i++)
+   {
+      if (op[i].wkc > 0)
+      {
+         done++;
+      }
+   }
+
+   return done;
 }
 
 /** CoE RxPDO write, blocking.
@@ -553,15 +1420,23 @@ int nexx_RxPDO(nexx_contextt *context, uint16 Slave, uint16 RxPDOnumber, int psi
 {
    nex_SDOt *SDOp;
    int wkc, maxdata;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    uint16 framedatasize;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, Slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   SDOp = (nex_SDOt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   SDOp = (nex_SDOt *)MbxOut;
    maxdata = context->slavelist[Slave].mbx_l - 0x08; /* data section=mailbox size - 6 mbx - 2 CoE */
    framedatasize = psize;
    if (framedatasize > maxdata)
@@ -579,8 +1454,10 @@ int nexx_RxPDO(nexx_contextt *context, uint16 Slave, uint16 RxPDOnumber, int psi
    /* copy PDO data to mailbox */
    memcpy(&SDOp->Command, p, framedatasize);
    /* send mailbox RxPDO request to slave */
-   wkc = nexx_mbxsend(context, Slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -600,16 +1477,24 @@ int nexx_TxPDO(nexx_contextt *context, uint16 slave, uint16 TxPDOnumber , int *p
 {
    nex_SDOt *SDOp, *aSDOp;
    int wkc;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    uint16 framedatasize;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOt *)&MbxIn;
-   SDOp = (nex_SDOt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOt *)MbxIn;
+   SDOp = (nex_SDOt *)MbxOut;
    SDOp->MbxHeader.length = htoes(0x02);
    SDOp->MbxHeader.address = htoes(0x0000);
    SDOp->MbxHeader.priority = 0x00;
@@ -618,13 +1503,13 @@ int nexx_TxPDO(nexx_contextt *context, uint16 slave, uint16 TxPDOnumber , int *p
    context->slavelist[slave].mbx_cnt = cnt;
    SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
    SDOp->CANOpen = htoes((TxPDOnumber & 0x01ff) + (ECT_COES_TXPDO_RR << 12)); /* number 9bits service upper 4 bits */
-   wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
    if (wkc > 0)
    {
       /* clean mailboxbuffer */
-      nex_clearmbx(&MbxIn);
+      nexx_mbxclear(context, slave, MbxIn, FALSE);
       /* read slave response */
-      wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+      wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
       if (wkc > 0) /* succeeded to read slave response ? */
       {
          /* slave response should be CoE, TxPDO */
@@ -663,6 +1548,8 @@ int nexx_TxPDO(nexx_contextt *context, uint16 slave, uint16 TxPDOnumber , int *p
       }
    }
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -988,6 +1875,187 @@ int nexx_readPDOmapCA(nexx_contextt *context, uint16 Slave, int Thread_n, int *O
    return retVal;
 }
 
+/** Bytes per entry of a PDO object, 2 for assignment objects, 4 for mapping objects. */
+static int nexx_PDOobj_esize(uint16 index)
+{
+   return ((index >= ECT_SDO_PDOASSIGN) && (index < (ECT_SDO_PDOASSIGN + 0x20))) ? 2 : 4;
+}
+
+/** Build the Complete Access image of a PDO object, subindex 0 padded to 16 bits.
+ * @return image size in bytes */
+static int nexx_PDOobj_image(const nex_PDOobjt *obj, nex_PDOdesct *image)
+{
+   uint8 *p;
+   uint32 entry;
+   int i, esize;
+
+   esize = nexx_PDOobj_esize(obj->index);
+   image->n = obj->n;
+   image->nu1 = 0;
+   p = (uint8 *)&(image->PDO[0]);
+   for (i = 0; i < obj->n; i++)
+   {
+      entry = obj->entry[i];
+      p[0] = (uint8)entry;
+      p[1] = (uint8)(entry >> 8);
+      if (esize == 4)
+      {
+         p[2] = (uint8)(entry >> 16);
+         p[3] = (uint8)(entry >> 24);
+      }
+      p += esize;
+   }
+   return 2 + obj->n * esize;
+}
+
+/** Read a PDO object back and compare it with the profile.
+ * @return TRUE if the slave holds the same entries */
+static boolean nexx_PDOobj_equal(nexx_contextt *context, uint16 slave, const nex_PDOobjt *obj,
+                                 boolean CA, int timeout)
+{
+   nex_PDOdesct want, cur;
+   int i, esize, size, wkc;
+   uint8 *p;
+
+   esize = nexx_PDOobj_esize(obj->index);
+   size = nexx_PDOobj_image(obj, &want);
+   memset(&cur, 0x00, sizeof(cur));
+   if (CA)
+   {
+      i = sizeof(cur);
+      wkc = nexx_SDOread(context, slave, obj->index, 0x00, TRUE, &i, &cur, timeout);
+      /* the padding byte after subindex 0 is not compared */
+      return (boolean)((wkc > 0) && (i >= size) && (cur.n == want.n) &&
+                       (memcmp(&(cur.PDO[0]), &(want.PDO[0]), size - 2) == 0));
+   }
+   i = sizeof(cur.n);
+   wkc = nexx_SDOread(context, slave, obj->index, 0x00, FALSE, &i, &(cur.n), timeout);
+   if ((wkc <= 0) || (cur.n != want.n))
+   {
+      return FALSE;
+   }
+   p = (uint8 *)&(cur.PDO[0]);
+   for (i = 1; i <= obj->n; i++)
+   {
+      size = esize;
+      wkc = nexx_SDOread(context, slave, obj->index, (uint8)i, FALSE, &size, p, timeout);
+      if ((wkc <= 0) || (size != esize) || (memcmp(p, (uint8 *)&(want.PDO[0]) + (i - 1) * esize, esize) != 0))
+      {
+         return FALSE;
+      }
+      p += esize;
+   }
+   return TRUE;
+}
+
+/** Write a PDO object, in one Complete Access download if possible.
+ * @return >0 if written */
+static int nexx_PDOobj_write(nexx_contextt *context, uint16 slave, const nex_PDOobjt *obj,
+                             boolean CA, int timeout)
+{
+   nex_PDOdesct image;
+   int i, esize, size, wkc;
+   uint8 n;
+
+   esize = nexx_PDOobj_esize(obj->index);
+   size = nexx_PDOobj_image(obj, &image);
+   if (CA)
+   {
+      wkc = nexx_SDOwrite(context, slave, obj->index, 0x00, TRUE, size, &image, timeout);
+      if (wkc > 0)
+      {
+         return wkc;
+      }
+   }
+   /* entry by entry, the entries can only be changed with subindex 0 cleared */
+   n = 0;
+   wkc = nexx_SDOwrite(context, slave, obj->index, 0x00, FALSE, sizeof(n), &n, timeout);
+   for (i = 1; (wkc > 0) && (i <= obj->n); i++)
+   {
+      wkc = nexx_SDOwrite(context, slave, obj->index, (uint8)i, FALSE, esize,
+                          (uint8 *)&(image.PDO[0]) + (i - 1) * esize, timeout);
+   }
+   if (wkc > 0)
+   {
+      n = obj->n;
+      wkc = nexx_SDOwrite(context, slave, obj->index, 0x00, FALSE, sizeof(n), &n, timeout);
+   }
+   return wkc;
+}
+
+/** Find the PDO profile of a slave by its identity.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  slave      = Slave number
+ * @param[in]  profile    = profile table, the first match is used
+ * @param[in]  n          = number of profiles
+ * @return profile or NULL if none matches
+ */
+const nex_PDOprofilet *nexx_PDOprofile_find(nexx_contextt *context, uint16 slave,
+                                            const nex_PDOprofilet *profile, int n)
+{
+   nex_slavet *sl = &(context->slavelist[slave]);
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      if ((!profile[i].eep_man || (profile[i].eep_man == sl->eep_man)) &&
+          (!profile[i].eep_id || (profile[i].eep_id == sl->eep_id)) &&
+          (!profile[i].eep_rev || (profile[i].eep_rev == sl->eep_rev)))
+      {
+         return &profile[i];
+      }
+   }
+   return NULL;
+}
+
+/** Apply a PDO profile to a slave in PRE-OP, f.e. from the PO2SOconfig hook.
+ *
+ * Every object is read back first and only written if the slave holds other
+ * entries. Slaves with Complete Access read and write each object in one
+ * transfer, so a warm restart with an unchanged mapping costs one upload per
+ * object. Once an object is written the following objects are written
+ * without a check, the assignment depends on the mapping before it.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  slave      = Slave number
+ * @param[in]  profile    = profile, objects in write order
+ * @param[in]  timeout    = Timeout per transfer in us, standard is NEX_TIMEOUTRXM
+ * @return number of objects written, 0 if all unchanged, -1 if a write failed
+ * or an object has more than NEX_MAXPDOOBJENTRY entries
+ */
+int nexx_PDOprofile_apply(nexx_contextt *context, uint16 slave, const nex_PDOprofilet *profile, int timeout)
+{
+   const nex_PDOobjt *obj;
+   boolean CA;
+   int i, written;
+
+   /* checked before anything is written, the entries would be read past entry[] */
+   for (i = 0; i < profile->nobj; i++)
+   {
+      if (profile->obj[i].n > NEX_MAXPDOOBJENTRY)
+      {
+         return -1;
+      }
+   }
+   CA = (boolean)((context->slavelist[slave].CoEdetails & ECT_COEDET_SDOCA) > 0);
+   written = 0;
+   for (i = 0; i < profile->nobj; i++)
+   {
+      obj = &(profile->obj[i]);
+      if (!written && nexx_PDOobj_equal(context, slave, obj, CA, timeout))
+      {
+         continue;
+      }
+      if (nexx_PDOobj_write(context, slave, obj, CA, timeout) <= 0)
+      {
+         return -1;
+      }
+      written++;
+   }
+   return written;
+}
+
 /** CoE read Object Description List.
  *
  * @param[in]  context  = context struct
@@ -998,21 +2066,29 @@ int nexx_readPDOmapCA(nexx_contextt *context, uint16 Slave, int Thread_n, int *O
 int nexx_readODlist(nexx_contextt *context, uint16 Slave, nex_ODlistt *pODlist)
 {
    nex_SDOservicet *SDOp, *aSDOp;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    int wkc;
    uint16 x, n, i, sp, offset;
    boolean stop;
    uint8 cnt;
    boolean First;
 
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
    pODlist->Slave = Slave;
    pODlist->Entries = 0;
-   nex_clearmbx(&MbxIn);
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
    /* clear pending out mailbox in slave if available. Timeout is set to 0 */
-   wkc = nexx_mbxreceive(context, Slave, &MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOservicet*)&MbxIn;
-   SDOp = (nex_SDOservicet*)&MbxOut;
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOservicet*)MbxIn;
+   SDOp = (nex_SDOservicet*)MbxOut;
    SDOp->MbxHeader.length = htoes(0x0008);
    SDOp->MbxHeader.address = htoes(0x0000);
    SDOp->MbxHeader.priority = 0x00;
@@ -1026,7 +2102,7 @@ int nexx_readODlist(nexx_contextt *context, uint16 Slave, nex_ODlistt *pODlist)
    SDOp->Fragments = 0; /* fragments left */
    SDOp->wdata[0] = htoes(0x01); /* all objects */
    /* send get object description list request to slave */
-   wkc = nexx_mbxsend(context, Slave, &MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
    /* mailbox placed in slave ? */
    if (wkc > 0)
    {
@@ -1037,9 +2113,9 @@ int nexx_readODlist(nexx_contextt *context, uint16 Slave, nex_ODlistt *pODlist)
       do
       {
          stop = TRUE; /* assume this is last iteration */
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, Slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, Slave, &MbxIn, NEX_TIMEOUTRXM);
+         wkc = nexx_mbxreceive(context, Slave, MbxIn, NEX_TIMEOUTRXM);
          /* got response ? */
          if (wkc > 0)
          {
@@ -1104,6 +2180,115 @@ int nexx_readODlist(nexx_contextt *context, uint16 Slave, nex_ODlistt *pODlist)
       }
       while ((x <= 128) && !stop);
    }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
+   return wkc;
+}
+
+/** CoE read Object Description List without the NEX_MAXODLIST limit of
+ * nex_ODlistt. Every index is passed to the callback as it is received.
+ *
+ * @param[in]  context  = context struct
+ * @param[in]  Slave    = Slave number.
+ * @param[in]  cb       = called for every index, <0 stops
+ * @param[in]  arg      = argument of cb
+ * @return Workcounter of slave response, 0 if failed or stopped.
+ */
+int nexx_readODlist_stream(nexx_contextt *context, uint16 Slave, nex_ODindext cb, void *arg)
+{
+   nex_SDOservicet *SDOp, *aSDOp;
+   nex_mbxbuft *MbxIn, *MbxOut;
+   int wkc, len;
+   uint16 x, n, i, offset;
+   boolean stop;
+   uint8 cnt;
+
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
+   /* clear pending out mailbox in slave if available. Timeout is set to 0 */
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOservicet*)MbxIn;
+   SDOp = (nex_SDOservicet*)MbxOut;
+   SDOp->MbxHeader.length = htoes(0x0008);
+   SDOp->MbxHeader.address = htoes(0x0000);
+   SDOp->MbxHeader.priority = 0x00;
+   /* Get new mailbox counter value */
+   cnt = nex_nextmbxcnt(context->slavelist[Slave].mbx_cnt);
+   context->slavelist[Slave].mbx_cnt = cnt;
+   SDOp->MbxHeader.mbxtype = ECT_MBXT_COE + (cnt << 4); /* CoE */
+   SDOp->CANOpen = htoes(0x000 + (ECT_COES_SDOINFO << 12)); /* number 9bits service upper 4 bits */
+   SDOp->Opcode = ECT_GET_ODLIST_REQ; /* get object description list request */
+   SDOp->Reserved = 0;
+   SDOp->Fragments = 0; /* fragments left */
+   SDOp->wdata[0] = htoes(0x01); /* all objects */
+   /* send get object description list request to slave */
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
+   /* mailbox placed in slave ? */
+   if (wkc > 0)
+   {
+      x = 0;
+      offset = 1; /* offset to skip info header in first frame, otherwise set to 0 */
+      do
+      {
+         stop = TRUE; /* assume this is last iteration */
+         nexx_mbxclear(context, Slave, MbxIn, FALSE);
+         /* read slave response */
+         wkc = nexx_mbxreceive(context, Slave, MbxIn, NEX_TIMEOUTRXM);
+         if (wkc <= 0)
+         {
+            break;
+         }
+         if (((aSDOp->MbxHeader.mbxtype & 0x0f) == ECT_MBXT_COE) &&
+             ((aSDOp->Opcode & 0x7f) == ECT_GET_ODLIST_RES))
+         {
+            /* number of indexes from mailbox data size */
+            len = (int)etohs(aSDOp->MbxHeader.length) - (6 + 2 * offset);
+            n = (len > 0) ? (uint16)(len / 2) : 0;
+            for (i = 0; i < n; i++)
+            {
+               if (cb(arg, etohs(aSDOp->wdata[i + offset])) < 0)
+               {
+                  wkc = 0;
+                  break;
+               }
+            }
+            /* check if more fragments will follow */
+            if ((wkc > 0) && (aSDOp->Fragments > 0))
+            {
+               stop = FALSE;
+            }
+            offset = 0;
+         }
+         else
+         {
+            if ((aSDOp->Opcode &  0x7f) == ECT_SDOINFO_ERROR) /* SDO info error received */
+            {
+               nexx_SDOinfoerror(context, Slave, 0, 0, etohl(aSDOp->ldata[0]));
+            }
+            else
+            {
+               nexx_packeterror(context, Slave, 0, 0, 1); /* Unexpected frame returned */
+            }
+            wkc = 0;
+         }
+         x++;
+      }
+      while ((x <= 128) && !stop);
+      if (!stop)
+      {
+         wkc = 0; /* more fragments than read */
+      }
+   }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -1119,20 +2304,28 @@ int nexx_readODdescription(nexx_contextt *context, uint16 Item, nex_ODlistt *pOD
    nex_SDOservicet *SDOp, *aSDOp;
    int wkc;
    uint16  n, Slave;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
 
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
    Slave = pODlist->Slave;
    pODlist->DataType[Item] = 0;
    pODlist->ObjectCode[Item] = 0;
    pODlist->MaxSub[Item] = 0;
    pODlist->Name[Item][0] = 0;
-   nex_clearmbx(&MbxIn);
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
    /* clear pending out mailbox in slave if available. Timeout is set to 0 */
-   wkc = nexx_mbxreceive(context, Slave, &MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOservicet*)&MbxIn;
-   SDOp = (nex_SDOservicet*)&MbxOut;
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOservicet*)MbxIn;
+   SDOp = (nex_SDOservicet*)MbxOut;
    SDOp->MbxHeader.length = htoes(0x0008);
    SDOp->MbxHeader.address = htoes(0x0000);
    SDOp->MbxHeader.priority = 0x00;
@@ -1146,13 +2339,13 @@ int nexx_readODdescription(nexx_contextt *context, uint16 Item, nex_ODlistt *pOD
    SDOp->Fragments = 0; /* fragments left */
    SDOp->wdata[0] = htoes(pODlist->Index[Item]); /* Data of Index */
    /* send get object description request to slave */
-   wkc = nexx_mbxsend(context, Slave, &MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
    /* mailbox placed in slave ? */
    if (wkc > 0)
    {
-      nex_clearmbx(&MbxIn);
+      nexx_mbxclear(context, Slave, MbxIn, FALSE);
       /* read slave response */
-      wkc = nexx_mbxreceive(context, Slave, &MbxIn, NEX_TIMEOUTRXM);
+      wkc = nexx_mbxreceive(context, Slave, MbxIn, NEX_TIMEOUTRXM);
       /* got response ? */
       if (wkc > 0)
       {
@@ -1160,15 +2353,15 @@ int nexx_readODdescription(nexx_contextt *context, uint16 Item, nex_ODlistt *pOD
              ((aSDOp->Opcode & 0x7f) == ECT_GET_OD_RES))
          {
             n = (etohs(aSDOp->MbxHeader.length) - 12); /* length of string(name of object) */
-            if (n > NEX_MAXNAME)
+            if (n >= sizeof(pODlist->Name[Item]))
             {
-               n = NEX_MAXNAME; /* max chars */
+               n = sizeof(pODlist->Name[Item]) - 1; /* max chars */
             }
             pODlist->DataType[Item] = etohs(aSDOp->wdata[1]);
             pODlist->ObjectCode[Item] = aSDOp->bdata[5];
             pODlist->MaxSub[Item] = aSDOp->bdata[4];
 
-            strncpy(pODlist->Name[Item] , (char *)&aSDOp->bdata[6], n);
+            memcpy(pODlist->Name[Item], &aSDOp->bdata[6], n);
             pODlist->Name[Item][n] = 0x00; /* String terminator */
          }
          /* got unexpected response from slave */
@@ -1187,6 +2380,8 @@ int nexx_readODdescription(nexx_contextt *context, uint16 Item, nex_ODlistt *pOD
       }
    }
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -1206,18 +2401,26 @@ int nexx_readOEsingle(nexx_contextt *context, uint16 Item, uint8 SubI, nex_ODlis
    int wkc;
    uint16 Index, Slave;
    int16 n;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
 
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
    wkc = 0;
    Slave = pODlist->Slave;
    Index = pODlist->Index[Item];
-   nex_clearmbx(&MbxIn);
+   nexx_mbxclear(context, Slave, MbxIn, FALSE);
    /* clear pending out mailbox in slave if available. Timeout is set to 0 */
-   wkc = nexx_mbxreceive(context, Slave, &MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSDOp = (nex_SDOservicet*)&MbxIn;
-   SDOp = (nex_SDOservicet*)&MbxOut;
+   wkc = nexx_mbxreceive(context, Slave, MbxIn, 0);
+   nexx_mbxclear(context, Slave, MbxOut, TRUE);
+   aSDOp = (nex_SDOservicet*)MbxIn;
+   SDOp = (nex_SDOservicet*)MbxOut;
    SDOp->MbxHeader.length = htoes(0x000a);
    SDOp->MbxHeader.address = htoes(0x0000);
    SDOp->MbxHeader.priority = 0x00;
@@ -1233,13 +2436,13 @@ int nexx_readOEsingle(nexx_contextt *context, uint16 Item, uint8 SubI, nex_ODlis
    SDOp->bdata[2] = SubI;       /* SubIndex */
    SDOp->bdata[3] = 1 + 2 + 4; /* get access rights, object category, PDO */
    /* send get object entry description request to slave */
-   wkc = nexx_mbxsend(context, Slave, &MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, Slave, MbxOut, NEX_TIMEOUTTXM);
    /* mailbox placed in slave ? */
    if (wkc > 0)
    {
-      nex_clearmbx(&MbxIn);
+      nexx_mbxclear(context, Slave, MbxIn, FALSE);
       /* read slave response */
-      wkc = nexx_mbxreceive(context, Slave, &MbxIn, NEX_TIMEOUTRXM);
+      wkc = nexx_mbxreceive(context, Slave, MbxIn, NEX_TIMEOUTRXM);
       /* got response ? */
       if (wkc > 0)
       {
@@ -1248,20 +2451,20 @@ int nexx_readOEsingle(nexx_contextt *context, uint16 Item, uint8 SubI, nex_ODlis
          {
             pOElist->Entries++;
             n = (etohs(aSDOp->MbxHeader.length) - 16); /* length of string(name of object) */
-            if (n > NEX_MAXNAME)
-            {
-               n = NEX_MAXNAME; /* max string length */
-            }
             if (n < 0 )
             {
                n = 0;
             }
+            if (n >= (int16)sizeof(pOElist->Name[SubI]))
+            {
+               n = (int16)sizeof(pOElist->Name[SubI]) - 1; /* max string length */
+            }
             pOElist->ValueInfo[SubI] = aSDOp->bdata[3];
             pOElist->DataType[SubI] = etohs(aSDOp->wdata[2]);
             pOElist->BitLength[SubI] = etohs(aSDOp->wdata[3]);
             pOElist->ObjAccess[SubI] = etohs(aSDOp->wdata[4]);
 
-            strncpy(pOElist->Name[SubI] , (char *)&aSDOp->wdata[5], n);
+            memcpy(pOElist->Name[SubI], &aSDOp->wdata[5], n);
             pOElist->Name[SubI][n] = 0x00; /* string terminator */
          }
          /* got unexpected response from slave */
@@ -1280,6 +2483,8 @@ int nexx_readOEsingle(nexx_contextt *context, uint16 Item, uint8 SubI, nex_ODlis
       }
    }
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -1370,6 +2575,57 @@ int nex_SDOwrite(uint16 Slave, uint16 Index, uint8 SubIndex,
    return nexx_SDOwrite(&nexx_context, Slave, Index, SubIndex, CA, psize, p, Timeout);
 }
 
+/** CoE SDO read streaming, blocking.
+ *
+ * @param[in]  slave      = Slave number
+ * @param[in]  index      = Index to read
+ * @param[in]  subindex   = Subindex to read, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes read.
+ * @param[in]  chunk      = called with each piece of data
+ * @param[in]  arg        = argument of chunk
+ * @param[out] psize      = bytes read from SDO
+ * @param[in]  timeout    = Timeout per segment in us, standard is NEX_TIMEOUTRXM
+ * @return Workcounter from last slave response
+ * @see nexx_SDOread_stream
+ */
+int nex_SDOread_stream(uint16 slave, uint16 index, uint8 subindex,
+                       boolean CA, nex_SDOchunkt chunk, void *arg, int32 *psize, int timeout)
+{
+   return nexx_SDOread_stream(&nexx_context, slave, index, subindex, CA, chunk, arg, psize, timeout);
+}
+
+/** CoE SDO write streaming, blocking.
+ *
+ * @param[in]  Slave      = Slave number
+ * @param[in]  Index      = Index to write
+ * @param[in]  SubIndex   = Subindex to write, must be 0 or 1 if CA is used.
+ * @param[in]  CA         = FALSE = single subindex. TRUE = Complete Access, all subindexes written.
+ * @param[in]  size       = Total size in bytes
+ * @param[in]  chunk      = called to fill each piece of data
+ * @param[in]  arg        = argument of chunk
+ * @param[in]  Timeout    = Timeout per segment in us, standard is NEX_TIMEOUTRXM
+ * @return Workcounter from last slave response
+ * @see nexx_SDOwrite_stream
+ */
+int nex_SDOwrite_stream(uint16 Slave, uint16 Index, uint8 SubIndex,
+                        boolean CA, int32 size, nex_SDOchunkt chunk, void *arg, int Timeout)
+{
+   return nexx_SDOwrite_stream(&nexx_context, Slave, Index, SubIndex, CA, size, chunk, arg, Timeout);
+}
+
+/** CoE SDO transfers of many slaves, blocking.
+ *
+ * @param[in,out] op      = operations, the results are set per operation
+ * @param[in]  n          = number of operations
+ * @param[in]  timeout    = Timeout per operation in us, standard is NEX_TIMEOUTRXM
+ * @return number of successful operations
+ * @see nexx_SDObatch
+ */
+int nex_SDObatch(nex_SDOopt *op, int n, int timeout)
+{
+   return nexx_SDObatch(&nexx_context, op, n, timeout);
+}
+
 /** CoE RxPDO write, blocking.
  *
  * A RxPDO download request is issued.
@@ -1461,6 +2717,32 @@ int nex_readPDOmapCA(uint16 Slave, int Thread_n, int *Osize, int *Isize)
    return nexx_readPDOmapCA(&nexx_context, Slave, Thread_n, Osize, Isize);
 }
 
+/** Find the PDO profile of a slave by its identity.
+ *
+ * @param[in]  slave      = Slave number
+ * @param[in]  profile    = profile table, the first match is used
+ * @param[in]  n          = number of profiles
+ * @return profile or NULL if none matches
+ * @see nexx_PDOprofile_find
+ */
+const nex_PDOprofilet *nex_PDOprofile_find(uint16 slave, const nex_PDOprofilet *profile, int n)
+{
+   return nexx_PDOprofile_find(&nexx_context, slave, profile, n);
+}
+
+/** Apply a PDO profile to a slave in PRE-OP.
+ *
+ * @param[in]  slave      = Slave number
+ * @param[in]  profile    = profile, objects in write order
+ * @param[in]  timeout    = Timeout per transfer in us, standard is NEX_TIMEOUTRXM
+ * @return number of objects written, 0 if all unchanged, -1 if a write failed
+ * @see nexx_PDOprofile_apply
+ */
+int nex_PDOprofile_apply(uint16 slave, const nex_PDOprofilet *profile, int timeout)
+{
+   return nexx_PDOprofile_apply(&nexx_context, slave, profile, timeout);
+}
+
 /** CoE read Object Description List.
  *
  * @param[in] Slave      = Slave number.
@@ -1473,6 +2755,11 @@ int nex_readODlist(uint16 Slave, nex_ODlistt *pODlist)
    return nexx_readODlist(&nexx_context, Slave, pODlist);
 }
 
+int nex_readODlist_stream(uint16 Slave, nex_ODindext cb, void *arg)
+{
+   return nexx_readODlist_stream(&nexx_context, Slave, cb, arg);
+}
+
 /** CoE read Object Description. Adds textual description to object indexes.
  *
  * @param[in] Item           = Item number in ODlist.
@@ -22,6 +22,30 @@ extern "C"
 /** max entries in Object Entry list */
 #define NEX_MAXOELIST   256
 
+/** max entries of a PDO object in a PDO profile */
+#ifndef NEX_MAXPDOOBJENTRY
+#define NEX_MAXPDOOBJENTRY 32
+#endif
+
+/** delay in us between steps of a mailbox engine run without a finished
+ * request, see nexx_SDObatch() */
+#ifndef NEX_SDOBATCHDELAY
+#define NEX_SDOBATCHDELAY  200
+#endif
+
+/** SDO abort code sent when the application stops a streaming transfer */
+#define NEX_SDO_ABORT_STOPPED 0x08000020
+/** SDO abort code sent when a streaming response is malformed */
+#define NEX_SDO_ABORT_GENERAL 0x08000000
+
+/** chunk callback of a streaming SDO transfer. Upload: data of size bytes
+ * received, <0 stops. Download: fill up to size bytes of data, returns the
+ * bytes filled, <=0 stops. */
+typedef int (*nex_SDOchunkt)(void *arg, uint8 *data, int size);
+
+/** index callback of a streaming Object Description List read, <0 stops */
+typedef int (*nex_ODindext)(void *arg, uint16 index);
+
 /* Storage for object description list */
 typedef struct
 {
@@ -58,17 +82,71 @@ typedef struct
    char   Name[NEX_MAXOELIST][NEX_MAXNAME+1];
 } nex_OElistt;
 
+/** one SDO transfer of a batch, see nexx_SDObatch() */
+typedef struct nex_SDOop
+{
+   /** slave number */
+   uint16           slave;
+   /** index and subindex, subindex must be 0 or 1 if CA is used */
+   uint16           index;
+   uint8            subindex;
+   /** TRUE = Complete Access */
+   boolean          CA;
+   /** TRUE = SDO download, FALSE = SDO upload */
+   boolean          write;
+   /** download: data size, upload: buffer size, bytes read when done */
+   int              size;
+   /** data buffer */
+   void             *p;
+   /** result, >0 if successful */
+   int              wkc;
+   /** SDO abort code if aborted by the slave */
+   int32            abortcode;
+} nex_SDOopt;
+
+/** one PDO mapping or assignment object of a PDO profile */
+typedef struct nex_PDOobj
+{
+   /** object index, f.e. 0x1600 mapping or 0x1C12 assignment */
+   uint16           index;
+   /** number of entries */
+   uint8            n;
+   /** mapping entries 0xIIIISSLL or assigned PDO indexes */
+   uint32           entry[NEX_MAXPDOOBJENTRY];
+} nex_PDOobjt;
+
+/** PDO mapping of a device type, see nexx_PDOprofile_apply() */
+typedef struct nex_PDOprofile
+{
+   /** identity the profile applies to, 0 = any */
+   uint32           eep_man;
+   uint32           eep_id;
+   uint32           eep_rev;
+   /** number of objects */
+   int              nobj;
+   /** objects in write order, mapping objects before their assignment */
+   const nex_PDOobjt *obj;
+} nex_PDOprofilet;
+
 #ifdef NEX_VER1
 void nex_SDOerror(uint16 Slave, uint16 Index, uint8 SubIdx, int32 AbortCode);
 int nex_SDOread(uint16 slave, uint16 index, uint8 subindex,
                       boolean CA, int *psize, void *p, int timeout);
 int nex_SDOwrite(uint16 Slave, uint16 Index, uint8 SubIndex,
     boolean CA, int psize, void *p, int Timeout);
+int nex_SDOread_stream(uint16 slave, uint16 index, uint8 subindex,
+                       boolean CA, nex_SDOchunkt chunk, void *arg, int32 *psize, int timeout);
+int nex_SDOwrite_stream(uint16 Slave, uint16 Index, uint8 SubIndex,
+                        boolean CA, int32 size, nex_SDOchunkt chunk, void *arg, int Timeout);
+int nex_SDObatch(nex_SDOopt *op, int n, int timeout);
 int nex_RxPDO(uint16 Slave, uint16 RxPDOnumber , int psize, void *p);
 int nex_TxPDO(uint16 slave, uint16 TxPDOnumber , int *psize, void *p, int timeout);
 int nex_readPDOmap(uint16 Slave, int *Osize, int *Isize);
 int nex_readPDOmapCA(uint16 Slave, int Thread_n, int *Osize, int *Isize);
+const nex_PDOprofilet *nex_PDOprofile_find(uint16 slave, const nex_PDOprofilet *profile, int n);
+int nex_PDOprofile_apply(uint16 slave, const nex_PDOprofilet *profile, int timeout);
 int nex_readODlist(uint16 Slave, nex_ODlistt *pODlist);
+int nex_readODlist_stream(uint16 Slave, nex_ODindext cb, void *arg);
 int nex_readODdescription(uint16 Item, nex_ODlistt *pODlist);
 int nex_readOEsingle(uint16 Item, uint8 SubI, nex_ODlistt *pODlist, nex_OElistt *pOElist);
 int nex_readOE(uint16 Item, nex_ODlistt *pODlist, nex_OElistt *pOElist);
@@ -79,11 +157,27 @@ int nexx_SDOread(nexx_contextt *context, uint16 slave, uint16 index, uint8 subin
                       boolean CA, int *psize, void *p, int timeout);
 int nexx_SDOwrite(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubIndex,
     boolean CA, int psize, void *p, int Timeout);
+int nexx_SDOread_stream(nexx_contextt *context, uint16 slave, uint16 index, uint8 subindex,
+                        boolean CA, nex_SDOchunkt chunk, void *arg, int32 *psize, int timeout);
+int nexx_SDOwrite_stream(nexx_contextt *context, uint16 Slave, uint16 Index, uint8 SubIndex,
+                         boolean CA, int32 size, nex_SDOchunkt chunk, void *arg, int Timeout);
+int nexx_SDOread_async(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 slave, uint16 index, uint8 subindex,
+                       boolean CA, int size, void *p, int timeout,
+                       void (*callback)(nex_mbxreqt *req, void *arg), void *arg);
+int nexx_SDOwrite_async(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 Slave, uint16 Index, uint8 SubIndex,
+                        boolean CA, int psize, const void *p, int Timeout,
+                        void (*callback)(nex_mbxreqt *req, void *arg), void *arg);
+boolean nexx_SDOread_segmented(nex_mbxreqt *req);
+int nexx_SDObatch(nexx_contextt *context, nex_SDOopt *op, int n, int timeout);
 int nexx_RxPDO(nexx_contextt *context, uint16 Slave, uint16 RxPDOnumber , int psize, void *p);
 int nexx_TxPDO(nexx_contextt *context, uint16 slave, uint16 TxPDOnumber , int *psize, void *p, int timeout);
 int nexx_readPDOmap(nexx_contextt *context, uint16 Slave, int *Osize, int *Isize);
 int nexx_readPDOmapCA(nexx_contextt *context, uint16 Slave, int Thread_n, int *Osize, int *Isize);
+const nex_PDOprofilet *nexx_PDOprofile_find(nexx_contextt *context, uint16 slave,
+                                            const nex_PDOprofilet *profile, int n);
+int nexx_PDOprofile_apply(nexx_contextt *context, uint16 slave, const nex_PDOprofilet *profile, int timeout);
 int nexx_readODlist(nexx_contextt *context, uint16 Slave, nex_ODlistt *pODlist);
+int nexx_readODlist_stream(nexx_contextt *context, uint16 Slave, nex_ODindext cb, void *arg);
 int nexx_readODdescription(nexx_contextt *context, uint16 Item, nex_ODlistt *pODlist);
 int nexx_readOEsingle(nexx_contextt *context, uint16 Item, uint8 SubI, nex_ODlistt *pODlist, nex_OElistt *pOElist);
 int nexx_readOE(nexx_contextt *context, uint16 Item, nex_ODlistt *pODlist, nex_OElistt *pOElist);
@@ -0,0 +1,375 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Signal conditioning of analog, encoder and digital inputs.
+ *
+ * The channels of a group are converted to engineering units once per
+ * cycle, right after the inputs are received. At compile time the channels
+ * are sorted by kind and raw type and all parameters are stored as separate
+ * arrays, so every step of the run is one straight loop over a range of
+ * slots without per channel branches: gather and sign extension per raw
+ * type, encoder unwrap, digital debounce, then scale, offset and filter for
+ * all slots together. The loops are kept simple so the compiler can
+ * vectorise them.
+ */
+
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatcond.h"
+
+/** Processing class of a channel, 0 for digital, then encoder and analog
+ * per raw type: unsigned 8, signed 8, unsigned 16 ... signed 32.
+ *
+ * @param[in]  chan           = channel
+ * @return class
+ */
+static int nexx_cond_class(const nex_condchant *chan)
+{
+   int type;
+
+   if (chan->kind == NEX_COND_DIGITAL)
+   {
+      return 0;
+   }
+   type = (chan->bitlen / 8 - 1) * 2 + (chan->sign ? 1 : 0);
+   return (chan->kind == NEX_COND_ENCODER) ? (1 + type) : (9 + type);
+}
+
+/** Initialise the conditioning of a group. The channels are compiled now if
+ * the group is mapped, and again every time the group is mapped.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] cond           = cond struct
+ * @param[in]  group          = group number
+ * @param[in]  table          = channel table, must stay valid
+ * @param[in]  nchan          = number of channels in table
+ * @return number of channels, 0 if a channel does not fit the mapping
+ */
+int nexx_cond_init(nexx_contextt *context, nex_condt *cond, uint8 group,
+   const nex_condchant *table, int nchan)
+{
+   nex_groupt *grp;
+
+   memset(cond, 0x00, sizeof(nex_condt));
+   cond->context = context;
+   cond->group = group;
+   cond->table = table;
+   cond->nchan = nchan;
+   grp = &(context->grouplist[group]);
+   grp->cond = cond;
+   if (grp->nsegments && (grp->outputs || grp->inputs))
+   {
+      return nexx_cond_compile(cond);
+   }
+
+   return nchan;
+}
+
+/** Compile the channel table to arrays with the current IOmap pointers.
+ * The filter, debounce and encoder state start over.
+ *
+ * @param[in]  cond           = cond struct
+ * @return number of channels, 0 if a channel does not fit the mapping
+ */
+int nexx_cond_compile(nex_condt *cond)
+{
+   nexx_contextt *context;
+   const nex_condchant *c;
+   nex_slavet *sl;
+   uint32 bit;
+   int i, s, n, cls, nalloc;
+   int next[NEX_COND_NCLASS];
+   uint32 memsize;
+   uint8 *p;
+
+   context = cond->context;
+   if (cond->mem)
+   {
+      osal_free(cond->mem);
+      cond->mem = NULL;
+   }
+   memset(cond->first, 0x00, sizeof(cond->first));
+   cond->primed = FALSE;
+   n = cond->nchan;
+   if (n <= 0)
+   {
+      return 0;
+   }
+   /* check the channels and count the slots per class */
+   for (i = 0; i < n; i++)
+   {
+      c = &(cond->table[i]);
+      if (!c->slave || (c->slave > *(context->slavecount)))
+      {
+         return 0;
+      }
+      sl = &(context->slavelist[c->slave]);
+      if (!sl->inputs || ((c->bitoffset + c->bitlen) > sl->Ibits))
+      {
+         return 0;
+      }
+      if (c->kind == NEX_COND_DIGITAL)
+      {
+         if (c->bitlen != 1)
+         {
+            return 0;
+         }
+      }
+      else if ((c->kind > NEX_COND_DIGITAL) || ((sl->Istartbit + c->bitoffset) % 8) ||
+               !c->bitlen || (c->bitlen % 8) || (c->bitlen > 32))
+      {
+         return 0;
+      }
+      cond->first[nexx_cond_class(c) + 1]++;
+   }
+   for (cls = 0; cls < NEX_COND_NCLASS; cls++)
+   {
+      cond->first[cls + 1] += cond->first[cls];
+      next[cls] = cond->first[cls];
+   }
+   /* 8 byte arrays first, each a multiple of 32 bytes */
+   nalloc = (n + 3) & ~3;
+   memsize = nalloc * (4 * sizeof(int64) + 4 * sizeof(float64)) +
+             nalloc * (sizeof(uint8 *) + sizeof(int32) + 2 * sizeof(uint16) + 2 * sizeof(uint8));
+   cond->mem = osal_malloc(memsize);
+   if (!cond->mem)
+   {
+      return 0;
+   }
+   memset(cond->mem, 0x00, memsize);
+   p = cond->mem;
+   cond->raw = (int64 *)p;
+   p += nalloc * sizeof(int64);
+   cond->prev = (int64 *)p;
+   p += nalloc * sizeof(int64);
+   cond->pos = (int64 *)p;
+   p += nalloc * sizeof(int64);
+   cond->value = (float64 *)p;
+   p += nalloc * sizeof(float64);
+   cond->scale = (float64 *)p;
+   p += nalloc * sizeof(float64);
+   cond->offset = (float64 *)p;
+   p += nalloc * sizeof(float64);
+   cond->alpha = (float64 *)p;
+   p += nalloc * sizeof(float64);
+   cond->state = (float64 *)p;
+   p += nalloc * sizeof(float64);
+   cond->src = (const uint8 **)p;
+   p += nalloc * sizeof(uint8 *);
+   cond->order = (int32 *)p;
+   p += nalloc * sizeof(int32);
+   cond->count = (uint16 *)p;
+   p += nalloc * sizeof(uint16);
+   cond->limit = (uint16 *)p;
+   p += nalloc * sizeof(uint16);
+   cond->shift = p;
+   p += nalloc;
+   cond->bit = p;
+   /* fill the slots in class order */
+   for (i = 0; i < n; i++)
+   {
+      c = &(cond->table[i]);
+      sl = &(context->slavelist[c->slave]);
+      s = next[nexx_cond_class(c)]++;
+      bit = sl->Istartbit + c->bitoffset;
+      cond->order[s] = i;
+      cond->src[s] = sl->inputs + (bit / 8);
+      cond->bit[s] = (uint8)(bit % 8);
+      cond->shift[s] = (uint8)(64 - c->bitlen);
+      cond->limit[s] = c->debounce;
+      cond->scale[s] = c->scale;
+      cond->offset[s] = c->offset;
+      cond->alpha[s] = ((c->alpha > 0.0) && (c->alpha < 1.0)) ? c->alpha : 1.0;
+   }
+
+   return n;
+}
+
+/** Start the filter, debounce and encoder state over at the next run, f.e.
+ * after a slave was recovered.
+ *
+ * @param[in]  cond           = cond struct
+ */
+void nexx_cond_reset(nex_condt *cond)
+{
+   cond->primed = FALSE;
+}
+
+/** Read the raw values of one class, the sign is extended from the raw length. */
+static void nexx_cond_gather(nex_condt *cond, int cls)
+{
+   const uint8 **src = cond->src;
+   int64 *raw = cond->raw;
+   int i, lo, hi;
+
+   lo = cond->first[cls];
+   hi = cond->first[cls + 1];
+   switch ((cls - 1) % 8)
+   {
+      case 0:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = src[i][0];
+         }
+         break;
+      case 1:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (int8)src[i][0];
+         }
+         break;
+      case 2:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (uint16)(src[i][0] | (src[i][1] << 8));
+         }
+         break;
+      case 3:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (int16)(src[i][0] | (src[i][1] << 8));
+         }
+         break;
+      case 4:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (int32)(src[i][0] | (src[i][1] << 8) | ((uint32)src[i][2] << 16));
+         }
+         break;
+      case 5:
+         for (i = lo; i < hi; i++)
+         {
+            /* 24 bit sign extension */
+            raw[i] = (int32)(((uint32)src[i][0] << 8) | ((uint32)src[i][1] << 16) |
+                             ((uint32)src[i][2] << 24)) >> 8;
+         }
+         break;
+      case 6:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (uint32)(src[i][0] | (src[i][1] << 8) | ((uint32)src[i][2] << 16) |
+                              ((uint32)src[i][3] << 24));
+         }
+         break;
+      default:
+         for (i = lo; i < hi; i++)
+         {
+            raw[i] = (int32)(src[i][0] | (src[i][1] << 8) | ((uint32)src[i][2] << 16) |
+                             ((uint32)src[i][3] << 24));
+         }
+         break;
+   }
+}
+
+/** Run the conditioning. Called by the receive processdata function after
+ * the inputs are copied to the IOmap, the results are in cond->value.
+ *
+ * @param[in]  cond           = cond struct
+ */
+void nexx_cond_run(nex_condt *cond)
+{
+   int64 *raw = cond->raw;
+   int64 *prev = cond->prev;
+   int64 *pos = cond->pos;
+   float64 *state = cond->state;
+   const float64 *scale = cond->scale;
+   const float64 *offset = cond->offset;
+   const float64 *alpha = cond->alpha;
+   int64 d;
+   float64 v;
+   int i, cls, n;
+   uint16 cnt;
+   uint8 b, flip;
+
+   n = cond->first[NEX_COND_NCLASS];
+   if (!n || !cond->mem)
+   {
+      return;
+   }
+   /* digital with debounce, the stable state is kept in prev */
+   for (i = 0; i < cond->first[1]; i++)
+   {
+      b = (uint8)((cond->src[i][0] >> cond->bit[i]) & 1);
+      if (!cond->primed)
+      {
+         prev[i] = b;
+      }
+      cnt = (uint16)((b != prev[i]) ? (cond->count[i] + 1) : 0);
+      flip = (uint8)(cnt && (cnt >= cond->limit[i]));
+      prev[i] ^= flip;
+      cond->count[i] = flip ? 0 : cnt;
+      raw[i] = prev[i];
+   }
+   for (cls = 1; cls < NEX_COND_NCLASS; cls++)
+   {
+      nexx_cond_gather(cond, cls);
+   }
+   /* encoders, the difference is taken modulo the raw length */
+   if (!cond->primed)
+   {
+      for (i = cond->first[1]; i < cond->first[9]; i++)
+      {
+         prev[i] = raw[i];
+         pos[i] = raw[i];
+      }
+   }
+   for (i = cond->first[1]; i < cond->first[9]; i++)
+   {
+      d = (int64)((uint64)(raw[i] - prev[i]) << cond->shift[i]) >> cond->shift[i];
+      prev[i] = raw[i];
+      pos[i] += d;
+      raw[i] = pos[i];
+   }
+   /* scale, offset and filter for all slots */
+   if (!cond->primed)
+   {
+      for (i = 0; i < n; i++)
+      {
+         state[i] = (float64)raw[i] * scale[i] + offset[i];
+      }
+      cond->primed = TRUE;
+   }
+   for (i = 0; i < n; i++)
+   {
+      v = (float64)raw[i] * scale[i] + offset[i];
+      state[i] += alpha[i] * (v - state[i]);
+   }
+   for (i = 0; i < n; i++)
+   {
+      cond->value[cond->order[i]] = state[i];
+   }
+}
+
+/** Remove the conditioning from the group and release the arrays.
+ *
+ * @param[in]  cond           = cond struct
+ */
+void nexx_cond_close(nex_condt *cond)
+{
+   if (cond->context && (cond->context->grouplist[cond->group].cond == cond))
+   {
+      cond->context->grouplist[cond->group].cond = NULL;
+   }
+   if (cond->mem)
+   {
+      osal_free(cond->mem);
+   }
+   cond->mem = NULL;
+   cond->value = NULL;
+   memset(cond->first, 0x00, sizeof(cond->first));
+}
+
+#ifdef NEX_VER1
+int nex_cond_init(nex_condt *cond, uint8 group, const nex_condchant *table, int nchan)
+{
+   return nexx_cond_init(&nexx_context, cond, group, table, nchan);
+}
+#endif
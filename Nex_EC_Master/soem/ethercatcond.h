@@ -0,0 +1,110 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatcond.c
+ */
+
+#ifndef _NEX_ECATCOND_H
+#define _NEX_ECATCOND_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** channel kind, value = raw * scale + offset */
+#define NEX_COND_ANALOG    0
+/** channel kind, counter unwrapped to a continuous position before scaling */
+#define NEX_COND_ENCODER   1
+/** channel kind, single input bit with debounce */
+#define NEX_COND_DIGITAL   2
+
+/** number of processing classes, digital + encoder and analog per raw type */
+#define NEX_COND_NCLASS    17
+
+/** one input channel to condition */
+typedef struct nex_condchan
+{
+   /** slave that provides the input */
+   uint16           slave;
+   /** first bit in the inputs of slave, byte aligned for analog and encoder */
+   uint32           bitoffset;
+   /** raw length in bits, 8, 16, 24 or 32, 1 for digital */
+   uint8            bitlen;
+   /** TRUE if the raw value is signed, the sign is extended from bitlen */
+   boolean          sign;
+   /** NEX_COND_ANALOG, NEX_COND_ENCODER or NEX_COND_DIGITAL */
+   uint8            kind;
+   /** value = raw * scale + offset, use 1.0 and 0.0 for the raw value */
+   float64          scale;
+   float64          offset;
+   /** first order IIR filter, value += alpha * (new - value), 0 or 1 = no filter */
+   float64          alpha;
+   /** digital, cycles a changed input must be stable before the value follows,
+    * 0 or 1 = no debounce */
+   uint16           debounce;
+} nex_condchant;
+
+/** signal conditioning of a group, all channels processed as structure of arrays */
+typedef struct nex_cond
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** channel table, kept by the application */
+   const nex_condchant *table;
+   /** number of channels in table */
+   int              nchan;
+   /** conditioned values in engineering units, same index as table */
+   float64          *value;
+   /** internal, first slot of each class, slots are sorted by class */
+   int              first[NEX_COND_NCLASS + 1];
+   /** internal, table index of each slot */
+   int32            *order;
+   /** internal, raw value of each slot, debounced for digital, unwrapped for encoder */
+   int64            *raw;
+   /** internal, last raw counter for encoder, last stable state for digital */
+   int64            *prev;
+   /** internal, unwrapped encoder position */
+   int64            *pos;
+   float64          *scale;
+   float64          *offset;
+   float64          *alpha;
+   /** internal, filter state and output before reorder */
+   float64          *state;
+   /** internal, IOmap address of each slot */
+   const uint8      **src;
+   /** internal, shift to extend the sign of an encoder difference */
+   uint8            *shift;
+   /** internal, bit in byte for digital */
+   uint8            *bit;
+   /** internal, debounce counter and limit for digital */
+   uint16           *count;
+   uint16           *limit;
+   /** FALSE until the first run after compile or reset */
+   boolean          primed;
+   /** internal, memory of all arrays */
+   uint8            *mem;
+} nex_condt;
+
+#ifdef NEX_VER1
+int nex_cond_init(nex_condt *cond, uint8 group, const nex_condchant *table, int nchan);
+#endif
+
+int nexx_cond_init(nexx_contextt *context, nex_condt *cond, uint8 group,
+   const nex_condchant *table, int nchan);
+int nexx_cond_compile(nex_condt *cond);
+void nexx_cond_reset(nex_condt *cond);
+void nexx_cond_run(nex_condt *cond);
+void nexx_cond_close(nex_condt *cond);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATCOND_H */
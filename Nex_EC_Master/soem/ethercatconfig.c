@@ -18,9 +18,14 @@
 #include "ethercattype.h"
 #include "ethercatbase.h"
 #include "ethercatmain.h"
+#include "ethercatmbxq.h"
 #include "ethercatcoe.h"
 #include "ethercatsoe.h"
 #include "ethercatconfig.h"
+#include "ethercatroute.h"
+#include "ethercatcond.h"
+#include "ethercatovs.h"
+#include "ethercatrec.h"
 
 // define if debug printf is needed
 //#define NEX_DEBUG
@@ -877,6 +882,55 @@ static void nexx_config_find_mappings(nexx_contextt *context, uint8 group)
    }
 }
 
+/** Align the logical start of a byte oriented slave.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  LogAddr        = next free logical address
+ * @param[in]  bytes          = size of slave processdata
+ * @return aligned logical address
+ */
+static uint32 nexx_config_align(nexx_contextt *context, uint8 group, uint32 LogAddr, uint32 bytes)
+{
+   uint32 align;
+
+   align = context->grouplist[group].IOalign;
+   if (align == NEX_IOALIGN_NATURAL)
+   {
+      align = 1;
+      while ((align < 8) && ((align << 1) <= bytes))
+      {
+         align <<= 1;
+      }
+   }
+   if (align > 1)
+   {
+      LogAddr += (align - (LogAddr % align)) % align;
+   }
+
+   return LogAddr;
+}
+
+/** Free the FMMUs of the slaves in a group before it is mapped. FMMUs of
+ * crosslinks have to be added again after the mapping.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number, 0 = all groups
+ */
+static void nexx_config_reset_fmmu(nexx_contextt *context, uint8 group)
+{
+   uint16 slave;
+
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      if (!group || (group == context->slavelist[slave].group))
+      {
+         context->slavelist[slave].FMMUunused = 0;
+         memset(context->slavelist[slave].FMMU, 0x00, sizeof(context->slavelist[slave].FMMU));
+      }
+   }
+}
+
 static void nexx_config_create_input_mappings(nexx_contextt *context, void *pIOmap, 
    uint8 group, int16 slave, uint32 * LogAddr, uint8 * BitPos)
 {
@@ -964,6 +1018,10 @@ static void nexx_config_create_input_mappings(nexx_contextt *context, void *pIOm
             *LogAddr += 1;
             *BitPos = 0;
          }
+         if (!FMMUdone)
+         {
+            *LogAddr = nexx_config_align(context, group, *LogAddr, context->slavelist[slave].Ibytes);
+         }
          context->slavelist[slave].FMMU[FMMUc].LogStart = htoel(*LogAddr);
          context->slavelist[slave].FMMU[FMMUc].LogStartbit = *BitPos;
          *BitPos = 7;
@@ -992,7 +1050,8 @@ static void nexx_config_create_input_mappings(nexx_contextt *context, void *pIOm
       if (!context->slavelist[slave].inputs)
       {
          context->slavelist[slave].inputs =
-            (uint8 *)(pIOmap)+etohl(context->slavelist[slave].FMMU[FMMUc].LogStart);
+            (uint8 *)(pIOmap) + etohl(context->slavelist[slave].FMMU[FMMUc].LogStart) -
+            context->grouplist[group].logstartaddr;
          context->slavelist[slave].Istartbit =
             context->slavelist[slave].FMMU[FMMUc].LogStartbit;
          NEX_PRINT("    Inputs %p startbit %d\n",
@@ -1085,6 +1144,10 @@ static void nexx_config_create_output_mappings(nexx_contextt *context, void *pIO
             *LogAddr += 1;
             *BitPos = 0;
          }
+         if (!FMMUdone)
+         {
+            *LogAddr = nexx_config_align(context, group, *LogAddr, context->slavelist[slave].Obytes);
+         }
          context->slavelist[slave].FMMU[FMMUc].LogStart = htoel(*LogAddr);
          context->slavelist[slave].FMMU[FMMUc].LogStartbit = *BitPos;
          *BitPos = 7;
@@ -1109,7 +1172,8 @@ static void nexx_config_create_output_mappings(nexx_contextt *context, void *pIO
       if (!context->slavelist[slave].outputs)
       {
          context->slavelist[slave].outputs =
-            (uint8 *)(pIOmap)+etohl(context->slavelist[slave].FMMU[FMMUc].LogStart);
+            (uint8 *)(pIOmap) + etohl(context->slavelist[slave].FMMU[FMMUc].LogStart) -
+            context->grouplist[group].logstartaddr;
          context->slavelist[slave].Ostartbit =
             context->slavelist[slave].FMMU[FMMUc].LogStartbit;
          NEX_PRINT("    slave %d Outputs %p startbit %d\n",
@@ -1122,14 +1186,234 @@ static void nexx_config_create_output_mappings(nexx_contextt *context, void *pIO
    context->slavelist[slave].FMMUunused = FMMUc;
 }
 
+/** Add mapped bytes to the IO segment list of a group.
+ * A new segment is started when the bytes do not fit in the current one.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in,out] currentsegment = segment being filled
+ * @param[in,out] segmentsize    = bytes in segment being filled
+ * @param[in]  diff           = bytes to add
+ * @param[in]  maxsegment     = max bytes per segment
+ * @return 1 if added, 0 if the segment list is full or diff is too large
+ */
+static int nexx_config_add_segment(nexx_contextt *context, uint8 group,
+   uint16 *currentsegment, uint32 *segmentsize, uint32 diff, uint32 maxsegment)
+{
+   if (diff > maxsegment)
+   {
+      return 0;
+   }
+   if ((*segmentsize + diff) > maxsegment)
+   {
+      if (*currentsegment >= (NEX_MAXIOSEGMENTS - 1))
+      {
+         return 0;
+      }
+      context->grouplist[group].IOsegment[*currentsegment] = *segmentsize;
+      (*currentsegment)++;
+      *segmentsize = diff;
+   }
+   else
+   {
+      *segmentsize += diff;
+   }
+
+   return 1;
+}
+
+/** Check if a slave has an FMMU left for extra mappings.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  slave          = slave number
+ * @return TRUE if the ESC has an unused FMMU
+ */
+static boolean nexx_config_freefmmu(nexx_contextt *context, uint16 slave)
+{
+   uint8 nFMMU = 0;
+
+   if (context->slavelist[slave].FMMUunused >= NEX_MAXFMMU)
+   {
+      return FALSE;
+   }
+   nexx_FPRD(context->port, context->slavelist[slave].configadr, ECT_REG_FMMUCNT,
+      sizeof(nFMMU), &nFMMU, NEX_TIMEOUTRET3);
+
+   return (boolean)(context->slavelist[slave].FMMUunused < nFMMU);
+}
+
+/** Map the ESC registers of the group register list after the inputs.
+ * Every register gets a read FMMU of its slave, registers of slaves without
+ * a free FMMU are not mapped.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  pIOmap         = pointer to IOmap
+ * @param[in]  group          = group number
+ * @param[in,out] LogAddr     = next free logical address
+ * @param[in,out] currentsegment = segment being filled
+ * @param[in,out] segmentsize    = bytes in segment being filled
+ * @param[in]  maxsegment     = max bytes per segment
+ * @return 1 if successful, 0 if the segment list is full
+ */
+static int nexx_config_create_regmap(nexx_contextt *context, void *pIOmap, uint8 group,
+   uint32 *LogAddr, uint16 *currentsegment, uint32 *segmentsize, uint32 maxsegment)
+{
+   nex_regmapt *reg;
+   nex_slavet *sl;
+   nex_fmmut *fmmu;
+   uint32 segstart;
+   uint16 i;
+   uint8 FMMUc, n;
+   boolean counted;
+
+   for (i = 0; i < context->grouplist[group].nregmap; i++)
+   {
+      reg = &(context->grouplist[group].regmap[i]);
+      reg->data = NULL;
+      reg->FMMUc = NEX_MAXFMMU;
+      if (!reg->slave || (reg->slave > *(context->slavecount)) || !reg->length)
+      {
+         continue;
+      }
+      sl = &(context->slavelist[reg->slave]);
+      if ((group && (group != sl->group)) || !nexx_config_freefmmu(context, reg->slave))
+      {
+         continue;
+      }
+      if (!nexx_config_add_segment(context, group, currentsegment, segmentsize, reg->length, maxsegment))
+      {
+         return 0;
+      }
+      FMMUc = sl->FMMUunused;
+      fmmu = &(sl->FMMU[FMMUc]);
+      memset(fmmu, 0x00, sizeof(nex_fmmut));
+      fmmu->LogStart = htoel(*LogAddr);
+      fmmu->LogLength = htoes(reg->length);
+      fmmu->LogEndbit = 7;
+      fmmu->PhysStart = htoes(reg->ADO);
+      fmmu->FMMUtype = 1;
+      fmmu->FMMUactive = 1;
+      nexx_FPWR(context->port, sl->configadr, ECT_REG_FMMU0 + (sizeof(nex_fmmut) * FMMUc),
+         sizeof(nex_fmmut), fmmu, NEX_TIMEOUTRET3);
+      sl->FMMUunused++;
+      /* a slave counts a read once per datagram */
+      segstart = *LogAddr + reg->length - *segmentsize;
+      counted = FALSE;
+      for (n = 0; n < FMMUc; n++)
+      {
+         if ((sl->FMMU[n].FMMUtype == 1) && (etohl(sl->FMMU[n].LogStart) >= segstart))
+         {
+            counted = TRUE;
+         }
+      }
+      if (!counted)
+      {
+         context->grouplist[group].inputsWKC++;
+         context->grouplist[group].IOsegmentIWKC[*currentsegment]++;
+         sl->expectedWKC++;
+      }
+      reg->data = (uint8 *)(pIOmap) + *LogAddr - context->grouplist[group].logstartaddr;
+      reg->FMMUc = FMMUc;
+      *LogAddr += reg->length;
+   }
+
+   return 1;
+}
+
+/** Map the SM1 mailbox full bit of every mailbox slave of the group after
+ * the inputs. Each slave gets a bitwise read FMMU on its SM1 status register,
+ * eight slaves share one byte, so one LRD shows all slaves with a response
+ * waiting. Slaves without a free FMMU are not mapped and poll as before.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  pIOmap         = pointer to IOmap
+ * @param[in]  group          = group number
+ * @param[in,out] LogAddr     = next free logical address
+ * @param[in,out] currentsegment = segment being filled
+ * @param[in,out] segmentsize    = bytes in segment being filled
+ * @param[in]  maxsegment     = max bytes per segment
+ * @return 1 if successful, 0 if the segment list is full
+ */
+static int nexx_config_create_mbxstatus(nexx_contextt *context, void *pIOmap, uint8 group,
+   uint32 *LogAddr, uint16 *currentsegment, uint32 *segmentsize, uint32 maxsegment)
+{
+   nex_slavet *sl;
+   nex_fmmut *fmmu;
+   uint32 segstart;
+   uint16 slave;
+   uint8 FMMUc, n, bit = 0;
+   boolean counted;
+
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if ((group && (group != sl->group)) || !sl->mbx_rl || !nexx_config_freefmmu(context, slave))
+      {
+         continue;
+      }
+      if (!bit && !nexx_config_add_segment(context, group, currentsegment, segmentsize, 1, maxsegment))
+      {
+         return 0;
+      }
+      FMMUc = sl->FMMUunused;
+      fmmu = &(sl->FMMU[FMMUc]);
+      memset(fmmu, 0x00, sizeof(nex_fmmut));
+      fmmu->LogStart = htoel(*LogAddr);
+      fmmu->LogLength = htoes(1);
+      fmmu->LogStartbit = bit;
+      fmmu->LogEndbit = bit;
+      fmmu->PhysStart = htoes(ECT_REG_SM1STAT);
+      fmmu->PhysStartBit = 3; /* mailbox full */
+      fmmu->FMMUtype = 1;
+      fmmu->FMMUactive = 1;
+      nexx_FPWR(context->port, sl->configadr, ECT_REG_FMMU0 + (sizeof(nex_fmmut) * FMMUc),
+         sizeof(nex_fmmut), fmmu, NEX_TIMEOUTRET3);
+      sl->FMMUunused++;
+      /* a slave counts a read once per datagram */
+      segstart = *LogAddr + 1 - *segmentsize;
+      counted = FALSE;
+      for (n = 0; n < FMMUc; n++)
+      {
+         if ((sl->FMMU[n].FMMUtype == 1) && (etohl(sl->FMMU[n].LogStart) >= segstart))
+         {
+            counted = TRUE;
+         }
+      }
+      if (!counted)
+      {
+         context->grouplist[group].inputsWKC++;
+         context->grouplist[group].IOsegmentIWKC[*currentsegment]++;
+         sl->expectedWKC++;
+      }
+      sl->mbxstatus = (uint8 *)(pIOmap) + *LogAddr - context->grouplist[group].logstartaddr;
+      sl->mbxstatusbit = bit;
+      sl->mbxstatusgroup = group;
+      sl->mbxstatusFMMU = FMMUc;
+      if (++bit == 8)
+      {
+         bit = 0;
+         (*LogAddr)++;
+      }
+   }
+   if (bit)
+   {
+      (*LogAddr)++;
+   }
+
+   return 1;
+}
+
 /** Map all PDOs in one group of slaves to IOmap with Outputs/Inputs
 * in sequential order (legacy SOEM way).
 *
  *
  * @param[in]  context    = context struct
- * @param[out] pIOmap     = pointer to IOmap
+ * @param[out] pIOmap     = pointer to IOmap, NULL to get the size. The mapping is done
+ *                          in full, FMMUs and SMs are programmed and SAFE_OP is requested,
+ *                          set the IOmap with nexx_config_iomap_group() afterwards.
+ *                          Mapping again starts over with the first FMMU of each slave.
  * @param[in]  group      = group to map, 0 = all groups
- * @return IOmap size
+ * @return IOmap size, NEX_ERROR if the IOmap does not fit in NEX_MAXIOSEGMENTS
  */
 int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
 {
@@ -1140,6 +1424,9 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
    uint32 diff;
    uint16 currentsegment = 0;
    uint32 segmentsize = 0;
+   uint32 maxsegment;
+   boolean overflow = FALSE;
+   uint16 startWKC;
 
    if ((*(context->slavecount) > 0) && (group < context->maxgroup))
    {
@@ -1148,8 +1435,20 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
       oLogAddr = LogAddr;
       BitPos = 0;
       context->grouplist[group].nsegments = 0;
+      /* leave room for the datagrams added to the first frame */
+      maxsegment = NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM;
+      if (context->grouplist[group].ALcheck)
+      {
+         maxsegment -= NEX_FIRSTALDATAGRAM;
+      }
       context->grouplist[group].outputsWKC = 0;
       context->grouplist[group].inputsWKC = 0;
+      memset(context->grouplist[group].IOsegmentOWKC, 0x00, sizeof(context->grouplist[group].IOsegmentOWKC));
+      memset(context->grouplist[group].IOsegmentIWKC, 0x00, sizeof(context->grouplist[group].IOsegmentIWKC));
+      context->grouplist[group].wkcfault = FALSE;
+      context->grouplist[group].overlap = FALSE;
+      /* a mapping again, f.e. after sizing with a NULL IOmap, starts with the first FMMU */
+      nexx_config_reset_fmmu(context, group);
 
       /* Find mappings and program syncmanagers */
       nexx_config_find_mappings(context, group);
@@ -1161,25 +1460,26 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
 
          if (!group || (group == context->slavelist[slave].group))
          {
+            context->slavelist[slave].expectedWKC = 0;
+            context->slavelist[slave].mbxstatus = NULL;
+            context->slavelist[slave].mbxstatusFMMU = NEX_MAXFMMU;
             /* create output mapping */
             if (context->slavelist[slave].Obits)
             {
+               startWKC = context->grouplist[group].outputsWKC;
                nexx_config_create_output_mappings (context, pIOmap, group, slave, &LogAddr, &BitPos);
                diff = LogAddr - oLogAddr;
                oLogAddr = LogAddr;
-               if ((segmentsize + diff) > (NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM))
-               {
-                  context->grouplist[group].IOsegment[currentsegment] = segmentsize;
-                  if (currentsegment < (NEX_MAXIOSEGMENTS - 1))
-                  {
-                     currentsegment++;
-                     segmentsize = diff;
-                  }
-               }
-               else
+               if (!nexx_config_add_segment(context, group, &currentsegment, &segmentsize, diff, maxsegment))
                {
-                  segmentsize += diff;
+                  nexx_packeterror(context, slave, 0, 0, 11); /* IO segment list full */
+                  overflow = TRUE;
                }
+               /* keep track of the segment workcounter for fault localization */
+               startWKC = context->grouplist[group].outputsWKC - startWKC;
+               context->slavelist[slave].Osegment = currentsegment;
+               context->slavelist[slave].expectedWKC += startWKC * 2;
+               context->grouplist[group].IOsegmentOWKC[currentsegment] += startWKC;
             }
          }
       }
@@ -1188,22 +1488,14 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
          LogAddr++;
          oLogAddr = LogAddr;
          BitPos = 0;
-         if ((segmentsize + 1) > (NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM))
-         {
-            context->grouplist[group].IOsegment[currentsegment] = segmentsize;
-            if (currentsegment < (NEX_MAXIOSEGMENTS - 1))
-            {
-               currentsegment++;
-               segmentsize = 1;
-            }
-         }
-         else
+         if (!nexx_config_add_segment(context, group, &currentsegment, &segmentsize, 1, maxsegment))
          {
-            segmentsize += 1;
+            nexx_packeterror(context, 0, 0, 0, 11); /* IO segment list full */
+            overflow = TRUE;
          }
       }
       context->grouplist[group].outputs = pIOmap;
-      context->grouplist[group].Obytes = LogAddr;
+      context->grouplist[group].Obytes = LogAddr - context->grouplist[group].logstartaddr;
       context->grouplist[group].nsegments = currentsegment + 1;
       context->grouplist[group].Isegment = currentsegment;
       context->grouplist[group].Ioffset = segmentsize;
@@ -1222,23 +1514,19 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
             /* create input mapping */
             if (context->slavelist[slave].Ibits)
             {
- 
+               startWKC = context->grouplist[group].inputsWKC;
                nexx_config_create_input_mappings(context, pIOmap, group, slave, &LogAddr, &BitPos);
                diff = LogAddr - oLogAddr;
                oLogAddr = LogAddr;
-               if ((segmentsize + diff) > (NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM))
-               {
-                  context->grouplist[group].IOsegment[currentsegment] = segmentsize;
-                  if (currentsegment < (NEX_MAXIOSEGMENTS - 1))
-                  {
-                     currentsegment++;
-                     segmentsize = diff;
-                  }
-               }
-               else
+               if (!nexx_config_add_segment(context, group, &currentsegment, &segmentsize, diff, maxsegment))
                {
-                  segmentsize += diff;
+                  nexx_packeterror(context, slave, 0, 0, 11); /* IO segment list full */
+                  overflow = TRUE;
                }
+               startWKC = context->grouplist[group].inputsWKC - startWKC;
+               context->slavelist[slave].Isegment = currentsegment;
+               context->slavelist[slave].expectedWKC += startWKC;
+               context->grouplist[group].IOsegmentIWKC[currentsegment] += startWKC;
             }
 
             nexx_eeprom2pdi(context, slave); /* set Eeprom control to PDI */
@@ -1256,24 +1544,31 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
          LogAddr++;
          oLogAddr = LogAddr;
          BitPos = 0;
-         if ((segmentsize + 1) > (NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM))
+         if (!nexx_config_add_segment(context, group, &currentsegment, &segmentsize, 1, maxsegment))
          {
-            context->grouplist[group].IOsegment[currentsegment] = segmentsize;
-            if (currentsegment < (NEX_MAXIOSEGMENTS - 1))
-            {
-               currentsegment++;
-               segmentsize = 1;
-            }
-         }
-         else
-         {
-            segmentsize += 1;
+            nexx_packeterror(context, 0, 0, 0, 11); /* IO segment list full */
+            overflow = TRUE;
          }
       }
+      /* ESC registers read with the inputs */
+      if (context->grouplist[group].nregmap &&
+          !nexx_config_create_regmap(context, pIOmap, group, &LogAddr, &currentsegment, &segmentsize, maxsegment))
+      {
+         nexx_packeterror(context, 0, 0, 0, 11); /* IO segment list full */
+         overflow = TRUE;
+      }
+      /* mailbox full bits read with the inputs */
+      if (context->grouplist[group].mbxstatus &&
+          !nexx_config_create_mbxstatus(context, pIOmap, group, &LogAddr, &currentsegment, &segmentsize, maxsegment))
+      {
+         nexx_packeterror(context, 0, 0, 0, 11); /* IO segment list full */
+         overflow = TRUE;
+      }
       context->grouplist[group].IOsegment[currentsegment] = segmentsize;
       context->grouplist[group].nsegments = currentsegment + 1;
       context->grouplist[group].inputs = (uint8 *)(pIOmap) + context->grouplist[group].Obytes;
-      context->grouplist[group].Ibytes = LogAddr - context->grouplist[group].Obytes;
+      context->grouplist[group].Ibytes = LogAddr - context->grouplist[group].logstartaddr -
+                                         context->grouplist[group].Obytes;
       if (!group)
       {
          context->slavelist[0].inputs = (uint8 *)(pIOmap) + context->slavelist[0].Obytes;
@@ -1282,6 +1577,26 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
 
       NEX_PRINT("IOmapSize %d\n", LogAddr - context->grouplist[group].logstartaddr);
 
+      if (overflow)
+      {
+         return NEX_ERROR;
+      }
+      if (pIOmap && context->grouplist[group].route)
+      {
+         nexx_route_compile(context->grouplist[group].route);
+      }
+      if (pIOmap && context->grouplist[group].cond)
+      {
+         nexx_cond_compile(context->grouplist[group].cond);
+      }
+      if (pIOmap && context->grouplist[group].ovs)
+      {
+         nexx_ovs_compile(context->grouplist[group].ovs);
+      }
+      if (pIOmap && context->grouplist[group].rec)
+      {
+         nexx_rec_compile(context->grouplist[group].rec);
+      }
       return (LogAddr - context->grouplist[group].logstartaddr);
    }
 
@@ -1292,9 +1607,12 @@ int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
  * overlapping. NOTE: Must use this for TI ESC when using LRW.
  *
  * @param[in]  context    = context struct
- * @param[out] pIOmap     = pointer to IOmap
+ * @param[out] pIOmap     = pointer to IOmap, NULL to get the size. The mapping is done
+ *                          in full, FMMUs and SMs are programmed and SAFE_OP is requested,
+ *                          set the IOmap with nexx_config_iomap_group() afterwards.
+ *                          Mapping again starts over with the first FMMU of each slave.
  * @param[in]  group      = group to map, 0 = all groups
- * @return IOmap size
+ * @return IOmap size, NEX_ERROR if the IOmap does not fit in NEX_MAXIOSEGMENTS
  */
 int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 group)
 {
@@ -1307,6 +1625,9 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
    uint32 diff;
    uint16 currentsegment = 0;
    uint32 segmentsize = 0;
+   uint32 maxsegment;
+   boolean overflow = FALSE;
+   uint16 startOWKC, startIWKC;
 
    if ((*(context->slavecount) > 0) && (group < context->maxgroup))
    {
@@ -1316,8 +1637,20 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
       soLogAddr = mLogAddr;
       BitPos = 0;
       context->grouplist[group].nsegments = 0;
+      /* leave room for the datagrams added to the first frame */
+      maxsegment = NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM;
+      if (context->grouplist[group].ALcheck)
+      {
+         maxsegment -= NEX_FIRSTALDATAGRAM;
+      }
       context->grouplist[group].outputsWKC = 0;
       context->grouplist[group].inputsWKC = 0;
+      memset(context->grouplist[group].IOsegmentOWKC, 0x00, sizeof(context->grouplist[group].IOsegmentOWKC));
+      memset(context->grouplist[group].IOsegmentIWKC, 0x00, sizeof(context->grouplist[group].IOsegmentIWKC));
+      context->grouplist[group].wkcfault = FALSE;
+      context->grouplist[group].overlap = TRUE;
+      /* a mapping again, f.e. after sizing with a NULL IOmap, starts with the first FMMU */
+      nexx_config_reset_fmmu(context, group);
 
       /* Find mappings and program syncmanagers */
       nexx_config_find_mappings(context, group);
@@ -1330,10 +1663,13 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
 
          if (!group || (group == context->slavelist[slave].group))
          {
+            context->slavelist[slave].mbxstatus = NULL;
+            context->slavelist[slave].mbxstatusFMMU = NEX_MAXFMMU;
+            startOWKC = context->grouplist[group].outputsWKC;
+            startIWKC = context->grouplist[group].inputsWKC;
             /* create output mapping */
             if (context->slavelist[slave].Obits)
             {
-               
                nexx_config_create_output_mappings(context, pIOmap, group, 
                   slave, &soLogAddr, &BitPos);
                if (BitPos)
@@ -1359,19 +1695,19 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
             diff = tempLogAddr - mLogAddr;
             mLogAddr = tempLogAddr;
 
-            if ((segmentsize + diff) > (NEX_MAXLRWDATA - NEX_FIRSTDCDATAGRAM))
-            {
-               context->grouplist[group].IOsegment[currentsegment] = segmentsize;
-               if (currentsegment < (NEX_MAXIOSEGMENTS - 1))
-               {
-                  currentsegment++;
-                  segmentsize = diff;
-               }
-            }
-            else
+            if (!nexx_config_add_segment(context, group, &currentsegment, &segmentsize, diff, maxsegment))
             {
-               segmentsize += diff;
+               nexx_packeterror(context, slave, 0, 0, 11); /* IO segment list full */
+               overflow = TRUE;
             }
+            /* keep track of the segment workcounter for fault localization */
+            startOWKC = context->grouplist[group].outputsWKC - startOWKC;
+            startIWKC = context->grouplist[group].inputsWKC - startIWKC;
+            context->slavelist[slave].Osegment = currentsegment;
+            context->slavelist[slave].Isegment = currentsegment;
+            context->slavelist[slave].expectedWKC = (startOWKC * 2) + startIWKC;
+            context->grouplist[group].IOsegmentOWKC[currentsegment] += startOWKC;
+            context->grouplist[group].IOsegmentIWKC[currentsegment] += startIWKC;
 
             nexx_eeprom2pdi(context, slave); /* set Eeprom control to PDI */
             nexx_FPWRw(context->port, configadr, ECT_REG_ALCTL, htoes(NEX_STATE_SAFE_OP), NEX_TIMEOUTRET3); /* set safeop status */
@@ -1390,8 +1726,10 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
       context->grouplist[group].Isegment = 0;
       context->grouplist[group].Ioffset = 0;
 
-      context->grouplist[group].Obytes = soLogAddr;
-      context->grouplist[group].Ibytes = siLogAddr;
+      /* inputs are moved by Obytes, keep them aligned */
+      soLogAddr = nexx_config_align(context, group, soLogAddr, 8);
+      context->grouplist[group].Obytes = soLogAddr - context->grouplist[group].logstartaddr;
+      context->grouplist[group].Ibytes = siLogAddr - context->grouplist[group].logstartaddr;
       context->grouplist[group].outputs = pIOmap;
       context->grouplist[group].inputs = (uint8 *)pIOmap + context->grouplist[group].Obytes;
 
@@ -1411,6 +1749,26 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
 
       NEX_PRINT("IOmapSize %d\n", context->grouplist[group].Obytes + context->grouplist[group].Ibytes);
 
+      if (overflow)
+      {
+         return NEX_ERROR;
+      }
+      if (pIOmap && context->grouplist[group].route)
+      {
+         nexx_route_compile(context->grouplist[group].route);
+      }
+      if (pIOmap && context->grouplist[group].cond)
+      {
+         nexx_cond_compile(context->grouplist[group].cond);
+      }
+      if (pIOmap && context->grouplist[group].ovs)
+      {
+         nexx_ovs_compile(context->grouplist[group].ovs);
+      }
+      if (pIOmap && context->grouplist[group].rec)
+      {
+         nexx_rec_compile(context->grouplist[group].rec);
+      }
       return (context->grouplist[group].Obytes + context->grouplist[group].Ibytes);
    }
 
@@ -1418,6 +1776,344 @@ int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 gr
 }
 
 
+/** Set the IOmap pointers of a mapped group.
+ * The logical layout is kept in the FMMU records, so the processdata can be
+ * placed in any buffer after mapping, f.e. one allocated with the exact size
+ * returned by a mapping with a NULL IOmap. The IOmap starts at the logical
+ * start address of the group.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  pIOmap     = pointer to IOmap
+ * @param[in]  group      = group that is mapped, 0 = all groups
+ * @param[in]  overlap    = TRUE if mapped with nexx_config_overlap_map_group
+ */
+void nexx_config_iomap_group(nexx_contextt *context, void *pIOmap, uint8 group, boolean overlap)
+{
+   uint16 slave, i;
+   uint8 FMMUc;
+   uint8 *base;
+   nex_slavet *sl;
+   nex_groupt *grp;
+
+   grp = &(context->grouplist[group]);
+   /* the IOmap starts at the logical start address of the group */
+   base = (uint8 *)(pIOmap) - grp->logstartaddr;
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if (!group || (group == sl->group))
+      {
+         sl->outputs = NULL;
+         sl->inputs = NULL;
+         if (!overlap && (sl->mbxstatusFMMU < sl->FMMUunused))
+         {
+            sl->mbxstatus = base + etohl(sl->FMMU[sl->mbxstatusFMMU].LogStart);
+         }
+         for (FMMUc = 0; FMMUc < sl->FMMUunused; FMMUc++)
+         {
+            if ((sl->FMMU[FMMUc].FMMUtype == 2) && sl->Obits && !sl->outputs)
+            {
+               sl->outputs = base + etohl(sl->FMMU[FMMUc].LogStart);
+               sl->Ostartbit = sl->FMMU[FMMUc].LogStartbit;
+            }
+            if ((sl->FMMU[FMMUc].FMMUtype == 1) && sl->Ibits && !sl->inputs)
+            {
+               sl->inputs = base + etohl(sl->FMMU[FMMUc].LogStart);
+               sl->Istartbit = sl->FMMU[FMMUc].LogStartbit;
+               if (overlap)
+               {
+                  sl->inputs += grp->Obytes;
+               }
+            }
+         }
+      }
+   }
+   grp->outputs = pIOmap;
+   grp->inputs = (uint8 *)(pIOmap) + grp->Obytes;
+   if (!group)
+   {
+      context->slavelist[0].outputs = pIOmap;
+      context->slavelist[0].inputs = (uint8 *)(pIOmap) + context->slavelist[0].Obytes;
+   }
+   for (i = 0; i < grp->nregmap; i++)
+   {
+      if (grp->regmap[i].FMMUc < NEX_MAXFMMU)
+      {
+         sl = &(context->slavelist[grp->regmap[i].slave]);
+         grp->regmap[i].data = base + etohl(sl->FMMU[grp->regmap[i].FMMUc].LogStart);
+      }
+   }
+   if (grp->route)
+   {
+      nexx_route_compile(grp->route);
+   }
+   if (grp->cond)
+   {
+      nexx_cond_compile(grp->cond);
+   }
+   if (grp->ovs)
+   {
+      nexx_ovs_compile(grp->ovs);
+   }
+   if (grp->rec)
+   {
+      nexx_rec_compile(grp->rec);
+   }
+}
+
+/** Map a group and allocate an IOmap of the exact size.
+ * The IOmap comes from osal_iomap_alloc(), it is page aligned and locked
+ * in memory where the OS supports it. Combine with IOalign of the group for
+ * aligned slave processdata. Release with osal_iomap_free().
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  group      = group to map, 0 = all groups
+ * @param[in]  overlap    = TRUE to map with overlapping Outputs/Inputs
+ * @param[out] size       = IOmap size, NEX_ERROR if mapping failed
+ * @return pointer to IOmap, NULL if mapping or allocation failed
+ */
+void *nexx_config_map_alloc_group(nexx_contextt *context, uint8 group, boolean overlap, int *size)
+{
+   void *pIOmap = NULL;
+
+   if (overlap)
+   {
+      *size = nexx_config_overlap_map_group(context, NULL, group);
+   }
+   else
+   {
+      *size = nexx_config_map_group(context, NULL, group);
+   }
+   if (*size > 0)
+   {
+      pIOmap = osal_iomap_alloc(*size);
+      if (pIOmap)
+      {
+         memset(pIOmap, 0x00, *size);
+         nexx_config_iomap_group(context, pIOmap, group, overlap);
+      }
+   }
+
+   return pIOmap;
+}
+
+/** Enable change-driven output transmission for a mapped group.
+ * IO segments that only carry outputs are not transmitted when the outputs
+ * did not change since they were last sent. All outputs are sent at least once
+ * per watchdog time, it has to be shorter than the SM watchdog of the slaves
+ * (default 100ms). The workcounter of a skipped segment is reported as if it
+ * was transmitted. A segment is only skipped while its last transmission
+ * returned the full workcounter, a short segment is sent every cycle until
+ * it is complete again. A slave lost while its segment is skipped is seen at
+ * the next transmission.
+ * Call again after remapping the group.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  group      = group that is mapped
+ * @param[in]  watchdog   = max. time between transmissions in us, 0 = send every cycle
+ * @return 1 if successful, 0 if out of memory
+ */
+int nexx_config_changedriven_group(nexx_contextt *context, uint8 group, uint32 watchdog)
+{
+   nex_groupt *grp;
+
+   grp = &(context->grouplist[group]);
+   if (grp->Oshadow)
+   {
+      osal_free(grp->Oshadow);
+      grp->Oshadow = NULL;
+   }
+   grp->Owatchdog = watchdog;
+   if (!watchdog || !grp->Obytes)
+   {
+      return 1;
+   }
+   grp->Oshadow = osal_malloc(grp->Obytes);
+   if (!grp->Oshadow)
+   {
+      grp->Owatchdog = 0;
+      return 0;
+   }
+   memset(grp->Oshadow, 0x00, grp->Obytes);
+   memset(grp->IOsegmentOgood, 0x00, sizeof(grp->IOsegmentOgood));
+   /* first cycle transmits everything */
+   osal_timer_start(&(grp->Orefresh), 0);
+
+   return 1;
+}
+
+/** Set the ESC registers to map into the processdata of a group.
+ * At mapping every register gets a spare read FMMU of its slave and is placed
+ * after the inputs, it is read with every processdata cycle without extra
+ * datagrams. Entries of slaves without a free FMMU get data NULL. Only for
+ * groups mapped with nexx_config_map_group. Call before mapping.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  group      = group number
+ * @param[in]  list       = register list, must stay valid
+ * @param[in]  n          = number of entries in list
+ */
+void nexx_config_regmap_group(nexx_contextt *context, uint8 group, nex_regmapt *list, uint16 n)
+{
+   uint16 i;
+
+   for (i = 0; i < n; i++)
+   {
+      list[i].data = NULL;
+      list[i].FMMUc = NEX_MAXFMMU;
+   }
+   context->grouplist[group].regmap = list;
+   context->grouplist[group].nregmap = n;
+}
+
+/** Find the IO segment that carries a logical address of a group.
+ *
+ * @param[in]  grp        = group struct
+ * @param[in]  LogAddr    = logical address
+ * @return IO segment
+ */
+static uint16 nexx_config_segment_of(nex_groupt *grp, uint32 LogAddr)
+{
+   uint32 end;
+   uint16 seg;
+
+   end = grp->logstartaddr;
+   for (seg = 0; seg < (grp->nsegments - 1); seg++)
+   {
+      end += grp->IOsegment[seg];
+      if (LogAddr < end)
+      {
+         break;
+      }
+   }
+
+   return seg;
+}
+
+/** Map inputs of one slave directly to outputs of another slave.
+ * An extra read FMMU of the source slave puts its input bits in the frame at
+ * the logical address of the destination outputs. In the same LRW pass the
+ * destination slave takes them with its write FMMU, the data does not pass the
+ * master. The source has to come before the destination in the frame path
+ * and both have to be mapped in the same group that uses LRW. The master
+ * outputs at the destination bits are overwritten by the source, the
+ * application should not write them. Call after mapping, before OP.
+ *
+ * @param[in]  context    = context struct
+ * @param[in]  srcslave   = slave that provides the inputs
+ * @param[in]  srcbit     = first bit in the inputs of srcslave
+ * @param[in]  dstslave   = slave that receives them as outputs
+ * @param[in]  dstbit     = first bit in the outputs of dstslave
+ * @param[in]  bitlen     = number of bits
+ * @return 1 if successful, 0 if the link is not possible
+ */
+int nexx_config_crosslink(nexx_contextt *context, uint16 srcslave, uint16 srcbit,
+   uint16 dstslave, uint16 dstbit, uint16 bitlen)
+{
+   nex_slavet *src, *dst;
+   nex_groupt *grp;
+   nex_fmmut *fmmu;
+   uint32 lbit, lend, pbit, flen;
+   uint16 seg;
+   uint8 FMMUc, group;
+   int i;
+   boolean counted = FALSE;
+
+   if ((srcslave >= dstslave) || (dstslave > *(context->slavecount)) || !srcslave || !bitlen)
+   {
+      return 0;
+   }
+   src = &(context->slavelist[srcslave]);
+   dst = &(context->slavelist[dstslave]);
+   group = src->group;
+   grp = &(context->grouplist[group]);
+   if ((dst->group != group) || grp->blockLRW || !grp->nsegments || !dst->Obits ||
+       ((srcbit + bitlen) > src->Ibits) || ((dstbit + bitlen) > dst->Obits) ||
+       !nexx_config_freefmmu(context, srcslave))
+   {
+      return 0;
+   }
+   /* physical address of source bits, within one input FMMU */
+   pbit = srcbit;
+   fmmu = NULL;
+   for (i = 0; i < src->FMMUunused; i++)
+   {
+      if (src->FMMU[i].FMMUtype == 1)
+      {
+         if (!src->Ibytes)
+         {
+            fmmu = &(src->FMMU[i]);
+            break;
+         }
+         flen = etohs(src->FMMU[i].LogLength) * 8;
+         if (pbit < flen)
+         {
+            if ((pbit + bitlen) <= flen)
+            {
+               fmmu = &(src->FMMU[i]);
+            }
+            break;
+         }
+         pbit -= flen;
+      }
+   }
+   if (!fmmu)
+   {
+      return 0;
+   }
+   pbit += (etohs(fmmu->PhysStart) * 8) + fmmu->PhysStartBit;
+   /* logical address of destination bits, output FMMUs of a slave are consecutive */
+   i = 0;
+   while ((i < dst->FMMUunused) && (dst->FMMU[i].FMMUtype != 2))
+   {
+      i++;
+   }
+   if (i >= dst->FMMUunused)
+   {
+      return 0;
+   }
+   lbit = (etohl(dst->FMMU[i].LogStart) * 8) + dst->FMMU[i].LogStartbit + dstbit;
+   lend = lbit + bitlen - 1;
+   seg = nexx_config_segment_of(grp, lbit / 8);
+   if (nexx_config_segment_of(grp, lend / 8) != seg)
+   {
+      return 0;
+   }
+
+   FMMUc = src->FMMUunused;
+   fmmu = &(src->FMMU[FMMUc]);
+   memset(fmmu, 0x00, sizeof(nex_fmmut));
+   fmmu->LogStart = htoel(lbit / 8);
+   fmmu->LogLength = htoes((uint16)((lend / 8) - (lbit / 8) + 1));
+   fmmu->LogStartbit = (uint8)(lbit % 8);
+   fmmu->LogEndbit = (uint8)(lend % 8);
+   fmmu->PhysStart = htoes((uint16)(pbit / 8));
+   fmmu->PhysStartBit = (uint8)(pbit % 8);
+   fmmu->FMMUtype = 1;
+   fmmu->FMMUactive = 1;
+   nexx_FPWR(context->port, src->configadr, ECT_REG_FMMU0 + (sizeof(nex_fmmut) * FMMUc),
+      sizeof(nex_fmmut), fmmu, NEX_TIMEOUTRET3);
+   src->FMMUunused++;
+   /* a slave counts a read once per datagram, add one if the source does not
+      read in this segment yet */
+   for (i = 0; i < FMMUc; i++)
+   {
+      if ((src->FMMU[i].FMMUtype == 1) &&
+          (nexx_config_segment_of(grp, etohl(src->FMMU[i].LogStart)) == seg))
+      {
+         counted = TRUE;
+      }
+   }
+   if (!counted)
+   {
+      grp->inputsWKC++;
+      grp->IOsegmentIWKC[seg]++;
+      src->expectedWKC++;
+   }
+
+   return 1;
+}
+
 /** Recover slave.
  *
  * @param[in] context = context struct
@@ -1585,6 +2281,68 @@ int nex_config_map(void *pIOmap)
    return nex_config_map_group(pIOmap, 0);
 }
 
+/** Map all PDOs from slaves and allocate an IOmap of the exact size.
+ *
+ * @param[out] size       = IOmap size, NEX_ERROR if mapping failed
+ * @return pointer to IOmap, NULL if mapping or allocation failed
+ * @see nexx_config_map_alloc_group
+ */
+void *nex_config_map_alloc(int *size)
+{
+   return nexx_config_map_alloc_group(&nexx_context, 0, FALSE, size);
+}
+
+/** Set the IOmap pointers of a mapped group.
+ *
+ * @param[in]  pIOmap     = pointer to IOmap
+ * @param[in]  group      = group that is mapped, 0 = all groups
+ * @param[in]  overlap    = TRUE if mapped with overlapping Outputs/Inputs
+ * @see nexx_config_iomap_group
+ */
+void nex_config_iomap_group(void *pIOmap, uint8 group, boolean overlap)
+{
+   nexx_config_iomap_group(&nexx_context, pIOmap, group, overlap);
+}
+
+/** Enable change-driven output transmission for a mapped group.
+ *
+ * @param[in]  group      = group that is mapped
+ * @param[in]  watchdog   = max. time between transmissions in us, 0 = send every cycle
+ * @return 1 if successful, 0 if out of memory
+ * @see nexx_config_changedriven_group
+ */
+int nex_config_changedriven_group(uint8 group, uint32 watchdog)
+{
+   return nexx_config_changedriven_group(&nexx_context, group, watchdog);
+}
+
+/** Map inputs of one slave directly to outputs of another slave.
+ *
+ * @param[in]  srcslave   = slave that provides the inputs
+ * @param[in]  srcbit     = first bit in the inputs of srcslave
+ * @param[in]  dstslave   = slave that receives them as outputs
+ * @param[in]  dstbit     = first bit in the outputs of dstslave
+ * @param[in]  bitlen     = number of bits
+ * @return 1 if successful, 0 if the link is not possible
+ * @see nexx_config_crosslink
+ */
+int nex_config_crosslink(uint16 srcslave, uint16 srcbit, uint16 dstslave, uint16 dstbit, uint16 bitlen)
+{
+   return nexx_config_crosslink(&nexx_context, srcslave, srcbit, dstslave, dstbit, bitlen);
+}
+
+/** Set the ESC registers to map into the processdata of a group.
+ *
+ * @param[in]  group      = group number
+ * @param[in]  list       = register list, must stay valid
+ * @param[in]  n          = number of entries in list
+ * @see nexx_config_regmap_group
+ */
+void nex_config_regmap_group(uint8 group, nex_regmapt *list, uint16 n)
+{
+   nexx_config_regmap_group(&nexx_context, group, list, n);
+}
+
 /** Map all PDOs from slaves to IOmap with Outputs/Inputs
 * overlapping. NOTE: Must use this for TI ESC when using LRW.
 *
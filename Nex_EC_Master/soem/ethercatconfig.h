@@ -25,6 +25,11 @@ int nex_config_map(void *pIOmap);
 int nex_config_overlap_map(void *pIOmap);
 int nex_config_map_group(void *pIOmap, uint8 group);
 int nex_config_overlap_map_group(void *pIOmap, uint8 group);
+void *nex_config_map_alloc(int *size);
+void nex_config_iomap_group(void *pIOmap, uint8 group, boolean overlap);
+int nex_config_changedriven_group(uint8 group, uint32 watchdog);
+void nex_config_regmap_group(uint8 group, nex_regmapt *list, uint16 n);
+int nex_config_crosslink(uint16 srcslave, uint16 srcbit, uint16 dstslave, uint16 dstbit, uint16 bitlen);
 int nex_config(void *pIOmap);
 int nex_config_overlap(void *pIOmap);
 int nex_recover_slave(uint16 slave, int timeout);
@@ -34,6 +39,12 @@ int nex_reconfig_slave(uint16 slave, int timeout);
 int nexx_config_init(nexx_contextt *context);
 int nexx_config_map_group(nexx_contextt *context, void *pIOmap, uint8 group);
 int nexx_config_overlap_map_group(nexx_contextt *context, void *pIOmap, uint8 group);
+void nexx_config_iomap_group(nexx_contextt *context, void *pIOmap, uint8 group, boolean overlap);
+void *nexx_config_map_alloc_group(nexx_contextt *context, uint8 group, boolean overlap, int *size);
+int nexx_config_changedriven_group(nexx_contextt *context, uint8 group, uint32 watchdog);
+void nexx_config_regmap_group(nexx_contextt *context, uint8 group, nex_regmapt *list, uint16 n);
+int nexx_config_crosslink(nexx_contextt *context, uint16 srcslave, uint16 srcbit,
+   uint16 dstslave, uint16 dstbit, uint16 bitlen);
 int nexx_recover_slave(nexx_contextt *context, uint16 slave, int timeout);
 int nexx_reconfig_slave(nexx_contextt *context, uint16 slave, int timeout);
 
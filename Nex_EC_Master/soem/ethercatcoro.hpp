@@ -0,0 +1,538 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * C++20 coroutine facade for the mailbox services.
+ *
+ * Mailbox transfers are awaited instead of blocking. All coroutines run on the
+ * thread calling nex::master::run(), the mailbox engine of ethercatmbxq.c
+ * multiplexes the outstanding requests of all slaves in shared frames. A
+ * configuration script is written as one coroutine per slave and spawned for
+ * every slave:
+ *
+ *    nex::task<> setup(nex::master &m, uint16 slave)
+ *    {
+ *       auto pos = co_await m.sdo_read<int32>(slave, 0x6064, 0);
+ *       co_await m.sdo_write<uint8>(slave, 0x1c12, 0, 0);
+ *       ...
+ *    }
+ *
+ *    nex::master m(&nexx_context);
+ *    for (slave = 1; slave <= nexx_slavecount; slave++) m.spawn(setup(m, slave));
+ *    m.run();
+ *
+ * Header only, no part of the C library depends on it.
+ */
+
+#ifndef _NEX_ECATCORO_HPP
+#define _NEX_ECATCORO_HPP
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "ethercat.h"
+
+namespace nex
+{
+
+class master;
+
+/** result of a mailbox transfer */
+struct result
+{
+   /** bytes read or written, 0 if failed */
+   int     size;
+   /** SDO abort code if failed by abort */
+   int32   abortcode;
+
+   explicit operator bool() const { return size > 0; }
+};
+
+/** result of a typed SDO read */
+template <typename T>
+struct sdo_value
+{
+   T       value;
+   /** SDO abort code if failed by abort */
+   int32   abortcode;
+   bool    ok;
+
+   explicit operator bool() const { return ok; }
+};
+
+template <typename T = void>
+class task;
+
+namespace detail
+{
+
+struct promise_base
+{
+   /** coroutine awaiting this task, none for spawned tasks */
+   std::coroutine_handle<> continuation;
+   std::exception_ptr      error;
+
+   struct final_awaiter
+   {
+      bool await_ready() noexcept { return false; }
+      template <typename P>
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+      {
+         std::coroutine_handle<> c = h.promise().continuation;
+         return c ? c : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+   };
+
+   std::suspend_always initial_suspend() noexcept { return {}; }
+   final_awaiter final_suspend() noexcept { return {}; }
+   void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base
+{
+   std::optional<T> value;
+
+   task<T> get_return_object();
+   void return_value(T v) { value.emplace(std::move(v)); }
+};
+
+template <>
+struct promise<void> : promise_base
+{
+   task<void> get_return_object();
+   void return_void() {}
+};
+
+/** common part of task<T> and task<void>, lazily started, single owner */
+template <typename P>
+class task_base
+{
+public:
+   using handle = std::coroutine_handle<P>;
+
+   task_base(task_base &&o) noexcept : h_(std::exchange(o.h_, {})) {}
+   task_base &operator=(task_base &&o) noexcept
+   {
+      if (this != &o)
+      {
+         if (h_)
+         {
+            h_.destroy();
+         }
+         h_ = std::exchange(o.h_, {});
+      }
+      return *this;
+   }
+   ~task_base()
+   {
+      if (h_)
+      {
+         h_.destroy();
+      }
+   }
+
+   bool await_ready() const noexcept { return !h_ || h_.done(); }
+   std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept
+   {
+      h_.promise().continuation = c;
+      return h_;
+   }
+
+protected:
+   explicit task_base(handle h) : h_(h) {}
+   void rethrow() const
+   {
+      if (h_.promise().error)
+      {
+         std::rethrow_exception(h_.promise().error);
+      }
+   }
+
+   handle h_;
+
+   friend class nex::master;
+};
+
+/** awaiting one mailbox request, resumed by the executor of the master */
+class mbx_awaiter
+{
+public:
+   bool await_ready() noexcept { return false; }
+
+protected:
+   explicit mbx_awaiter(master &m) : m_(m), req_(&own_) {}
+   mbx_awaiter(const mbx_awaiter &) = delete;
+   mbx_awaiter &operator=(const mbx_awaiter &) = delete;
+
+   static void done(nex_mbxreqt *req, void *arg);
+
+   master                  &m_;
+   nex_mbxreqt             *req_;
+   /** cleared by the async call, a full clear would touch both mailbox buffers */
+   nex_mbxreqt             own_;
+   std::coroutine_handle<> h_;
+};
+
+} /* namespace detail */
+
+template <typename T>
+class task : public detail::task_base<detail::promise<T>>
+{
+public:
+   using promise_type = detail::promise<T>;
+
+   T await_resume()
+   {
+      this->rethrow();
+      return std::move(*(this->h_.promise().value));
+   }
+
+private:
+   explicit task(std::coroutine_handle<promise_type> h) : detail::task_base<promise_type>(h) {}
+
+   friend promise_type;
+};
+
+template <>
+class task<void> : public detail::task_base<detail::promise<void>>
+{
+public:
+   using promise_type = detail::promise<void>;
+
+   void await_resume() { rethrow(); }
+
+private:
+   explicit task(std::coroutine_handle<promise_type> h) : detail::task_base<promise_type>(h) {}
+
+   friend promise_type;
+};
+
+template <typename T>
+task<T> detail::promise<T>::get_return_object()
+{
+   return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> detail::promise<void>::get_return_object()
+{
+   return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+/** SDO upload or download, awaitable */
+class sdo_awaiter : public detail::mbx_awaiter
+{
+public:
+   sdo_awaiter(master &m, bool write, uint16 slave, uint16 index, uint8 subindex,
+               boolean CA, int size, void *p, int timeout)
+      : detail::mbx_awaiter(m), write_(write), slave_(slave), index_(index), subindex_(subindex),
+        CA_(CA), size_(size), p_(p), timeout_(timeout), blocking_(false) {}
+
+   bool await_suspend(std::coroutine_handle<> h);
+   result await_resume();
+
+private:
+   bool     write_;
+   uint16   slave_;
+   uint16   index_;
+   uint8    subindex_;
+   boolean  CA_;
+   int      size_;
+   void     *p_;
+   int      timeout_;
+   /** segmented transfer, done by the blocking call on the executor thread */
+   bool     blocking_;
+};
+
+/** prepared mailbox request of any protocol, awaitable */
+class mbx_request : public detail::mbx_awaiter
+{
+public:
+   mbx_request(master &m, nex_mbxreqt &req) : detail::mbx_awaiter(m) { req_ = &req; }
+
+   bool await_suspend(std::coroutine_handle<> h);
+   /** @return NEX_MBXREQ_DONE or NEX_MBXREQ_ERROR */
+   uint32 await_resume() { return req_->state; }
+};
+
+/** Executor of the mailbox coroutines of one context.
+ *
+ * A master opened on a context alone sends its own frames from run(), f.e.
+ * in PRE-OP. A master opened on a group rides on the processdata cycle of
+ * that group, the callbacks of the processdata thread wake run().
+ */
+class master
+{
+public:
+   explicit master(nexx_contextt *context) : context_(context), group_(false)
+   {
+      nexx_mbxq_open(context, &mbxq_);
+   }
+   master(nexx_contextt *context, uint8 group) : context_(context), group_(true)
+   {
+      nexx_mbxq_init(context, &mbxq_, group);
+   }
+   master(const master &) = delete;
+   master &operator=(const master &) = delete;
+   /** Closes the engine. A group engine is detached from the processdata
+    * cycle first, nexx_mbxq_close() waits for a send or receive processdata
+    * in progress, the processdata thread may keep running. */
+   ~master()
+   {
+      nexx_mbxq_close(&mbxq_);
+   }
+
+   nexx_contextt *context() const { return context_; }
+   nex_mbxqt *mbxq() { return &mbxq_; }
+
+   /** Start a task on the executor, it runs until done in run(). */
+   void spawn(task<> t)
+   {
+      wake(t.h_);
+      tasks_.push_back(std::move(t));
+   }
+
+   /** Run the spawned tasks until all are done or wait on nothing.
+    * The first exception of a task is rethrown. */
+   void run()
+   {
+      std::coroutine_handle<> h;
+
+      for (;;)
+      {
+         while ((h = next()))
+         {
+            h.resume();
+         }
+         if (idle())
+         {
+            break;
+         }
+         if (group_)
+         {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return !ready_.empty() || !outstanding_; });
+         }
+         else if (nexx_mbxq_run(&mbxq_) && !woken())
+         {
+            /* no request finished, give the slaves time to answer */
+            osal_usleep(NEX_SDOBATCHDELAY);
+         }
+      }
+      for (auto &t : tasks_)
+      {
+         if (t.h_.done())
+         {
+            t.rethrow();
+         }
+      }
+      tasks_.clear();
+   }
+
+   /** SDO read into a buffer, see nexx_SDOread() */
+   sdo_awaiter sdo_read(uint16 slave, uint16 index, uint8 subindex, boolean CA, int size, void *p,
+                        int timeout = NEX_TIMEOUTRXM)
+   {
+      return sdo_awaiter(*this, false, slave, index, subindex, CA, size, p, timeout);
+   }
+
+   /** SDO write from a buffer, see nexx_SDOwrite() */
+   sdo_awaiter sdo_write(uint16 slave, uint16 index, uint8 subindex, boolean CA, int size, const void *p,
+                         int timeout = NEX_TIMEOUTRXM)
+   {
+      return sdo_awaiter(*this, true, slave, index, subindex, CA, size, const_cast<void *>(p), timeout);
+   }
+
+   /** SDO read of a single value */
+   template <typename T = int32>
+   task<sdo_value<T>> sdo_read(uint16 slave, uint16 index, uint8 subindex, int timeout = NEX_TIMEOUTRXM)
+   {
+      sdo_value<T> v = {};
+      result r = co_await sdo_read(slave, index, subindex, FALSE, (int)sizeof(T), &v.value, timeout);
+      v.abortcode = r.abortcode;
+      v.ok = (r.size == (int)sizeof(T));
+      co_return v;
+   }
+
+   /** SDO write of a single value */
+   template <typename T>
+   task<result> sdo_write(uint16 slave, uint16 index, uint8 subindex, T value, int timeout = NEX_TIMEOUTRXM)
+   {
+      co_return co_await sdo_write(slave, index, subindex, FALSE, (int)sizeof(T), &value, timeout);
+   }
+
+   /** Submit a prepared request of any protocol, f.e. with a parse function
+    * of the application. */
+   mbx_request transfer(nex_mbxreqt &req)
+   {
+      return mbx_request(*this, req);
+   }
+
+private:
+   friend class detail::mbx_awaiter;
+   friend class sdo_awaiter;
+   friend class mbx_request;
+
+   void wake(std::coroutine_handle<> h)
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready_.push_back(h);
+      cond_.notify_one();
+   }
+
+   /** called by the engine when a request is done or failed */
+   void finished(std::coroutine_handle<> h)
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      outstanding_--;
+      ready_.push_back(h);
+      cond_.notify_one();
+   }
+
+   void started()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      outstanding_++;
+   }
+
+   void unstarted()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      outstanding_--;
+   }
+
+   /** a coroutine is ready to resume */
+   bool woken()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return !ready_.empty();
+   }
+
+   /** nothing ready and nothing in the engine, tested together under the lock */
+   bool idle()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return ready_.empty() && (outstanding_ == 0);
+   }
+
+   std::coroutine_handle<> next()
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::coroutine_handle<> h;
+      if (!ready_.empty())
+      {
+         h = ready_.front();
+         ready_.pop_front();
+      }
+      return h;
+   }
+
+   nexx_contextt                        *context_;
+   bool                                 group_;
+   nex_mbxqt                            mbxq_ = {};
+   std::mutex                           mutex_;
+   std::condition_variable              cond_;
+   std::deque<std::coroutine_handle<>>  ready_;
+   int                                  outstanding_ = 0;
+   std::vector<task<>>                  tasks_;
+};
+
+inline void detail::mbx_awaiter::done(nex_mbxreqt *, void *arg)
+{
+   mbx_awaiter *a = static_cast<mbx_awaiter *>(arg);
+   a->m_.finished(a->h_);
+}
+
+inline bool sdo_awaiter::await_suspend(std::coroutine_handle<> h)
+{
+   int ok;
+
+   h_ = h;
+   /* counted before submit, the processdata thread may finish it at once */
+   m_.started();
+   if (write_)
+   {
+      ok = nexx_SDOwrite_async(&m_.mbxq_, req_, slave_, index_, subindex_, CA_, size_, p_, timeout_,
+                               &detail::mbx_awaiter::done, static_cast<detail::mbx_awaiter *>(this));
+   }
+   else
+   {
+      ok = nexx_SDOread_async(&m_.mbxq_, req_, slave_, index_, subindex_, CA_, size_, p_, timeout_,
+                              &detail::mbx_awaiter::done, static_cast<detail::mbx_awaiter *>(this));
+   }
+   if (!ok)
+   {
+      /* segmented download, do not suspend */
+      m_.unstarted();
+      blocking_ = true;
+      return false;
+   }
+   return true;
+}
+
+inline result sdo_awaiter::await_resume()
+{
+   result r = { 0, 0 };
+   int size;
+
+   if (!blocking_ && (req_->state == NEX_MBXREQ_DONE))
+   {
+      r.size = req_->size;
+      return r;
+   }
+   if (!blocking_ && !write_ && nexx_SDOread_segmented(req_))
+   {
+      /* segmented upload */
+      blocking_ = true;
+   }
+   if (!blocking_)
+   {
+      r.abortcode = req_->abortcode;
+      return r;
+   }
+   if (write_)
+   {
+      if (nexx_SDOwrite(m_.context_, slave_, index_, subindex_, CA_, size_, p_, timeout_) > 0)
+      {
+         r.size = size_;
+      }
+   }
+   else
+   {
+      size = size_;
+      if (nexx_SDOread(m_.context_, slave_, index_, subindex_, CA_, &size, p_, timeout_) > 0)
+      {
+         r.size = size;
+      }
+   }
+   return r;
+}
+
+inline bool mbx_request::await_suspend(std::coroutine_handle<> h)
+{
+   h_ = h;
+   req_->callback = &detail::mbx_awaiter::done;
+   req_->arg = static_cast<detail::mbx_awaiter *>(this);
+   m_.started();
+   if (!nexx_mbxq_submit(&m_.mbxq_, req_))
+   {
+      m_.unstarted();
+      osal_atomic_store(&(req_->state), NEX_MBXREQ_ERROR);
+      return false;
+   }
+   return true;
+}
+
+} /* namespace nex */
+
+#endif /* _NEX_ECATCORO_HPP */
@@ -77,6 +77,7 @@ void nexx_dcsync0(nexx_contextt *context, uint16 slave, boolean act, uint32 Cycl
     context->slavelist[slave].DCactive = (uint8)act;
     context->slavelist[slave].DCshift = CyclShift;
     context->slavelist[slave].DCcycle = CyclTime;
+    context->slavelist[slave].DCcycle1 = 0;
 }
 
 /**
@@ -142,6 +143,7 @@ void nexx_dcsync01(nexx_contextt *context, uint16 slave, boolean act, uint32 Cyc
     context->slavelist[slave].DCactive = (uint8)act;
     context->slavelist[slave].DCshift = CyclShift;
     context->slavelist[slave].DCcycle = CyclTime0;
+    context->slavelist[slave].DCcycle1 = (int32)CyclTime1;
 }
 
 /* latched port time of slave */
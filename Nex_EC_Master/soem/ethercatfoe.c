@@ -75,17 +75,25 @@ int nexx_FOEread(nexx_contextt *context, uint16 slave, char *filename, uint32 pa
    int32 dataread = 0;
    int32 buffersize, packetnumber, prevpacket = 0;
    uint16 fnsize, maxdata, segmentdata;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    boolean worktodo;
 
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
    buffersize = *psize;
-   nex_clearmbx(&MbxIn);
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aFOEp = (nex_FOEt *)&MbxIn;
-   FOEp = (nex_FOEt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aFOEp = (nex_FOEt *)MbxIn;
+   FOEp = (nex_FOEt *)MbxOut;
    fnsize = (uint16)strlen(filename);
    maxdata = context->slavelist[slave].mbx_l - 12;
    if (fnsize > maxdata)
@@ -104,16 +112,16 @@ int nexx_FOEread(nexx_contextt *context, uint16 slave, char *filename, uint32 pa
    /* copy filename in mailbox */
    memcpy(&FOEp->FileName[0], filename, fnsize);
    /* send FoE request to slave */
-   wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
    if (wkc > 0) /* succeeded to place mailbox in slave ? */
    {
       do
       {
          worktodo = FALSE;
          /* clean mailboxbuffer */
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+         wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
          if (wkc > 0) /* succeeded to read slave response ? */
          {
             /* slave response should be FoE */
@@ -142,7 +150,7 @@ int nexx_FOEread(nexx_contextt *context, uint16 slave, char *filename, uint32 pa
                      FOEp->OpCode = ECT_FOE_ACK;
                      FOEp->PacketNumber = htoel(packetnumber);
                      /* send FoE ack to slave */
-                     wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+                     wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
                      if (wkc <= 0)
                      {
                         worktodo = FALSE;
@@ -182,6 +190,8 @@ int nexx_FOEread(nexx_contextt *context, uint16 slave, char *filename, uint32 pa
       } while (worktodo);
    }
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -203,17 +213,25 @@ int nexx_FOEwrite(nexx_contextt *context, uint16 slave, char *filename, uint32 p
    int32 packetnumber, sendpacket = 0;
    uint16 fnsize, maxdata;
    int segmentdata;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    boolean worktodo, dofinalzero;
    int tsize;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aFOEp = (nex_FOEt *)&MbxIn;
-   FOEp = (nex_FOEt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aFOEp = (nex_FOEt *)MbxIn;
+   FOEp = (nex_FOEt *)MbxOut;
    dofinalzero = FALSE;
    fnsize = (uint16)strlen(filename);
    maxdata = context->slavelist[slave].mbx_l - 12;
@@ -233,16 +251,16 @@ int nexx_FOEwrite(nexx_contextt *context, uint16 slave, char *filename, uint32 p
    /* copy filename in mailbox */
    memcpy(&FOEp->FileName[0], filename, fnsize);
    /* send FoE request to slave */
-   wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
    if (wkc > 0) /* succeeded to place mailbox in slave ? */
    {
       do
       {
          worktodo = FALSE;
          /* clean mailboxbuffer */
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+         wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
          if (wkc > 0) /* succeeded to read slave response ? */
          {
             /* slave response should be FoE */
@@ -289,7 +307,7 @@ int nexx_FOEwrite(nexx_contextt *context, uint16 slave, char *filename, uint32 p
                            memcpy(&FOEp->Data[0], p, segmentdata);
                            p = (uint8 *)p + segmentdata;
                            /* send FoE data to slave */
-                           wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+                           wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
                            if (wkc <= 0)
                            {
                               worktodo = FALSE;
@@ -349,6 +367,8 @@ int nexx_FOEwrite(nexx_contextt *context, uint16 slave, char *filename, uint32 p
       } while (worktodo);
    }
 
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
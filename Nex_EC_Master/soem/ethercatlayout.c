@@ -0,0 +1,509 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Processdata layout of the mapped slaves.
+ *
+ * The PDO entries of every slave are read from the CoE PDO assignment or the
+ * SII PDO categories, in the same order the mapping places them in the IOmap.
+ * From this a C header can be generated with the offset of every object as
+ * compile-time constant and typed accessors, and a hash of the layout that
+ * the application compares at runtime with the hash in the header.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatmbxq.h"
+#include "ethercatcoe.h"
+#include "ethercatlayout.h"
+
+/** Add an entry to the list.
+ * @return 1 if added, 0 if list is full
+ */
+static int nexx_layout_add(nex_pdoentryt *list, int *n, int maxlist, uint16 pdo, uint32 map,
+   uint8 datatype, boolean output, uint32 *bitoffset)
+{
+   nex_pdoentryt *e;
+
+   if (*n >= maxlist)
+   {
+      return 0;
+   }
+   e = &(list[(*n)++]);
+   e->pdo = pdo;
+   e->index = (uint16)(map >> 16);
+   e->subindex = (uint8)(map >> 8);
+   e->bitlen = (uint8)map;
+   e->datatype = datatype;
+   e->output = output;
+   e->bitoffset = *bitoffset;
+   *bitoffset += e->bitlen;
+
+   return 1;
+}
+
+/** Read the PDO entries of a slave from the CoE PDO assignment. */
+static int nexx_layout_coe(nexx_contextt *context, uint16 slave, nex_pdoentryt *list, int maxlist)
+{
+   nex_slavet *sl;
+   uint32 bitoffset[2] = {0, 0}, map;
+   uint16 pdo;
+   uint8 iSM, npdo, ipdo, nentry, ientry;
+   boolean output;
+   int n = 0, rdl, wkc;
+
+   sl = &(context->slavelist[slave]);
+   for (iSM = 2; iSM < NEX_MAXSM; iSM++)
+   {
+      if ((sl->SMtype[iSM] != 3) && (sl->SMtype[iSM] != 4))
+      {
+         continue;
+      }
+      output = (boolean)(sl->SMtype[iSM] == 3);
+      rdl = sizeof(npdo); npdo = 0;
+      wkc = nexx_SDOread(context, slave, ECT_SDO_PDOASSIGN + iSM, 0x00, FALSE, &rdl, &npdo, NEX_TIMEOUTRXM);
+      for (ipdo = 1; (wkc > 0) && (ipdo <= npdo); ipdo++)
+      {
+         rdl = sizeof(pdo); pdo = 0;
+         wkc = nexx_SDOread(context, slave, ECT_SDO_PDOASSIGN + iSM, ipdo, FALSE, &rdl, &pdo, NEX_TIMEOUTRXM);
+         pdo = etohs(pdo);
+         if ((wkc <= 0) || !pdo)
+         {
+            continue;
+         }
+         rdl = sizeof(nentry); nentry = 0;
+         wkc = nexx_SDOread(context, slave, pdo, 0x00, FALSE, &rdl, &nentry, NEX_TIMEOUTRXM);
+         for (ientry = 1; (wkc > 0) && (ientry <= nentry); ientry++)
+         {
+            rdl = sizeof(map); map = 0;
+            wkc = nexx_SDOread(context, slave, pdo, ientry, FALSE, &rdl, &map, NEX_TIMEOUTRXM);
+            if ((wkc > 0) && !nexx_layout_add(list, &n, maxlist, pdo, etohl(map), 0, output, &bitoffset[output]))
+            {
+               return n;
+            }
+         }
+      }
+      /* the next SM of a byte oriented slave starts at a byte */
+      if ((output && sl->Obytes) || (!output && sl->Ibytes))
+      {
+         bitoffset[output] = (bitoffset[output] + 7) & ~7U;
+      }
+   }
+
+   return n;
+}
+
+/** Read the PDO entries of a slave from the SII PDO categories. */
+static int nexx_layout_sii(nexx_contextt *context, uint16 slave, nex_pdoentryt *list, int maxlist)
+{
+   nex_slavet *sl;
+   uint32 bitoffset, map;
+   uint16 a, length, c, pdo;
+   int16 start;
+   uint8 t, iSM, e, er, sm, datatype;
+   boolean output;
+   int n = 0;
+
+   sl = &(context->slavelist[slave]);
+   for (t = 0; t < 2; t++)
+   {
+      /* category 50 holds TxPDO (inputs), 51 RxPDO (outputs) */
+      output = (boolean)(t == 1);
+      start = nexx_siifind(context, slave, ECT_SII_PDO + t);
+      if (start <= 0)
+      {
+         continue;
+      }
+      length = nexx_siigetbyte(context, slave, start);
+      length += (nexx_siigetbyte(context, slave, start + 1) << 8);
+      bitoffset = 0;
+      for (iSM = 0; iSM < NEX_MAXSM; iSM++)
+      {
+         if (sl->SMtype[iSM] != (output ? 3 : 4))
+         {
+            continue;
+         }
+         a = start + 2;
+         c = 1;
+         while (c < length)
+         {
+            pdo = nexx_siigetbyte(context, slave, a++);
+            pdo += (nexx_siigetbyte(context, slave, a++) << 8);
+            e = nexx_siigetbyte(context, slave, a++);
+            sm = nexx_siigetbyte(context, slave, a++);
+            a += 4;
+            for (er = 1; er <= e; er++)
+            {
+               if (sm == iSM)
+               {
+                  map = (uint32)nexx_siigetbyte(context, slave, a) << 16;
+                  map |= (uint32)nexx_siigetbyte(context, slave, a + 1) << 24;
+                  map |= (uint32)nexx_siigetbyte(context, slave, a + 2) << 8;
+                  datatype = nexx_siigetbyte(context, slave, a + 4);
+                  map |= nexx_siigetbyte(context, slave, a + 5);
+                  if (!nexx_layout_add(list, &n, maxlist, pdo, map, datatype, output, &bitoffset))
+                  {
+                     return n;
+                  }
+               }
+               a += 8;
+            }
+            c += 4 + (4 * e);
+         }
+         if ((output && sl->Obytes) || (!output && sl->Ibytes))
+         {
+            bitoffset = (bitoffset + 7) & ~7U;
+         }
+      }
+   }
+   if (sl->eep_pdi)
+   {
+      nexx_eeprom2pdi(context, slave); /* if eeprom control was previously pdi then restore */
+   }
+
+   return n;
+}
+
+/** Read the objects mapped in the processdata of a slave, in IOmap order.
+ * Uses the CoE PDO assignment if the slave has CoE, otherwise the SII.
+ * Slaves configured from the configlist have no entries.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  slave          = slave number
+ * @param[out] list           = PDO entries
+ * @param[in]  maxlist        = size of list
+ * @return number of entries
+ */
+int nexx_readPDOentries(nexx_contextt *context, uint16 slave, nex_pdoentryt *list, int maxlist)
+{
+   int n = 0;
+
+   if (context->slavelist[slave].configindex)
+   {
+      return 0;
+   }
+   if (context->slavelist[slave].mbx_proto & ECT_MBXPROT_COE)
+   {
+      n = nexx_layout_coe(context, slave, list, maxlist);
+   }
+   if (!n)
+   {
+      n = nexx_layout_sii(context, slave, list, maxlist);
+   }
+
+   return n;
+}
+
+/** Bit position of an entry from the start of the IOmap. */
+static uint32 nexx_layout_bitpos(nexx_contextt *context, uint8 group, uint16 slave, const nex_pdoentryt *e)
+{
+   nex_slavet *sl = &(context->slavelist[slave]);
+   uint8 *base = context->grouplist[group].outputs;
+
+   if (e->output)
+   {
+      return (uint32)((sl->outputs - base) * 8) + sl->Ostartbit + e->bitoffset;
+   }
+   return (uint32)((sl->inputs - base) * 8) + sl->Istartbit + e->bitoffset;
+}
+
+/** FNV-1a hash step over a value. */
+static uint32 nexx_layout_fnv(uint32 hash, uint32 value)
+{
+   int i;
+
+   for (i = 0; i < 4; i++)
+   {
+      hash ^= (value >> (i * 8)) & 0xff;
+      hash *= 16777619UL;
+   }
+   return hash;
+}
+
+/** Hash step over the identity of one slave and the position of its PDO entries. */
+static uint32 nexx_layout_hashslave(nexx_contextt *context, uint8 group, uint16 slave,
+   const nex_pdoentryt *list, int n, uint32 hash)
+{
+   int i;
+
+   hash = nexx_layout_fnv(hash, slave);
+   hash = nexx_layout_fnv(hash, context->slavelist[slave].eep_man);
+   hash = nexx_layout_fnv(hash, context->slavelist[slave].eep_id);
+   for (i = 0; i < n; i++)
+   {
+      hash = nexx_layout_fnv(hash, ((uint32)list[i].index << 16) | ((uint32)list[i].subindex << 8) | list[i].bitlen);
+      hash = nexx_layout_fnv(hash, nexx_layout_bitpos(context, group, slave, &list[i]) | ((uint32)list[i].output << 31));
+   }
+
+   return hash;
+}
+
+/** Hash of the processdata layout of a mapped group. It covers the identity
+ * of every slave and position and size of every mapped object, so it changes
+ * whenever the mapping changes. Compare with the hash in a generated header.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @return layout hash
+ */
+uint32 nexx_pdo_layouthash(nexx_contextt *context, uint8 group)
+{
+   nex_pdoentryt list[NEX_MAXPDOENTRY];
+   uint32 hash = 2166136261UL;
+   uint16 slave;
+   int n;
+
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      if (group && (group != context->slavelist[slave].group))
+      {
+         continue;
+      }
+      n = nexx_readPDOentries(context, slave, list, NEX_MAXPDOENTRY);
+      hash = nexx_layout_hashslave(context, group, slave, list, n, hash);
+   }
+
+   return hash;
+}
+
+/** Data types of the entries read from the CoE PDO assignment. Taken from
+ * the SDO Info entry descriptions, else from the SII PDO categories.
+ * Entries without a known type stay 0 and are accessed unsigned.
+ */
+static void nexx_layout_types(nexx_contextt *context, uint16 slave, nex_pdoentryt *list, int n)
+{
+   nex_ODlistt *od = NULL;
+   nex_OElistt *oe = NULL;
+   nex_pdoentryt *sii = NULL;
+   int i, j, nsii = -1;
+
+   if (context->slavelist[slave].CoEdetails & ECT_COEDET_SDOINFO)
+   {
+      od = (nex_ODlistt *)osal_malloc(sizeof(nex_ODlistt));
+      oe = (nex_OElistt *)osal_malloc(sizeof(nex_OElistt));
+   }
+   for (i = 0; i < n; i++)
+   {
+      if (list[i].datatype || !list[i].index || !list[i].bitlen)
+      {
+         continue;
+      }
+      if (od && oe)
+      {
+         od->Slave = slave;
+         od->Entries = 1;
+         od->Index[0] = list[i].index;
+         memset(oe, 0x00, sizeof(nex_OElistt));
+         if ((nexx_readOEsingle(context, 0, list[i].subindex, od, oe) > 0) &&
+             (oe->DataType[list[i].subindex] <= 0xff))
+         {
+            list[i].datatype = (uint8)oe->DataType[list[i].subindex];
+            continue;
+         }
+      }
+      if (nsii < 0)
+      {
+         sii = (nex_pdoentryt *)osal_malloc(NEX_MAXPDOENTRY * sizeof(nex_pdoentryt));
+         nsii = sii ? nexx_layout_sii(context, slave, sii, NEX_MAXPDOENTRY) : 0;
+      }
+      for (j = 0; j < nsii; j++)
+      {
+         if ((sii[j].index == list[i].index) && (sii[j].subindex == list[i].subindex) &&
+             (sii[j].output == list[i].output))
+         {
+            list[i].datatype = sii[j].datatype;
+            break;
+         }
+      }
+   }
+   osal_free(sii);
+   osal_free(oe);
+   osal_free(od);
+}
+
+/** Write the accessors of one entry to the header. */
+static void nexx_layout_emit(FILE *fp, const char *name, const nex_pdoentryt *e, uint32 bitpos)
+{
+   const char *type = NULL, *conv = "", *hconv = "";
+   const char *raw = "uint8";
+   uint32 byte = bitpos / 8, bit = bitpos % 8;
+   boolean sign;
+
+   sign = (boolean)((e->datatype == ECT_INTEGER8) || (e->datatype == ECT_INTEGER16) ||
+                    (e->datatype == ECT_INTEGER32) || (e->datatype == ECT_INTEGER64));
+   if (!bit)
+   {
+      switch (e->bitlen)
+      {
+         case 8:
+            type = sign ? "int8" : "uint8";
+            break;
+         case 16:
+            type = sign ? "int16" : "uint16";
+            raw = "uint16"; conv = "etohs"; hconv = "htoes";
+            break;
+         case 32:
+            type = (e->datatype == ECT_REAL32) ? "float32" : (sign ? "int32" : "uint32");
+            raw = "uint32"; conv = "etohl"; hconv = "htoel";
+            break;
+         case 64:
+            type = (e->datatype == ECT_REAL64) ? "float64" : (sign ? "int64" : "uint64");
+            raw = "uint64"; conv = "etohll"; hconv = "htoell";
+            break;
+      }
+   }
+   if (type && ((e->datatype == ECT_REAL32) || (e->datatype == ECT_REAL64)))
+   {
+      fprintf(fp, "static __inline %s %s(const uint8 *IOmap)\n{\n   %s r;\n   %s v;\n"
+                  "   memcpy(&r, IOmap + %u, sizeof(r));\n   r = %s(r);\n   memcpy(&v, &r, sizeof(v));\n   return v;\n}\n",
+              type, name, raw, type, byte, conv);
+      if (e->output)
+      {
+         fprintf(fp, "static __inline void %s_set(uint8 *IOmap, %s v)\n{\n   %s r;\n"
+                     "   memcpy(&r, &v, sizeof(r));\n   r = %s(r);\n   memcpy(IOmap + %u, &r, sizeof(r));\n}\n",
+                 name, type, raw, hconv, byte);
+      }
+   }
+   else if (type)
+   {
+      fprintf(fp, "static __inline %s %s(const uint8 *IOmap)\n{\n   %s r;\n"
+                  "   memcpy(&r, IOmap + %u, sizeof(r));\n   return (%s)%s(r);\n}\n",
+              type, name, raw, byte, type, conv);
+      if (e->output)
+      {
+         fprintf(fp, "static __inline void %s_set(uint8 *IOmap, %s v)\n{\n   %s r = %s((%s)v);\n"
+                     "   memcpy(IOmap + %u, &r, sizeof(r));\n}\n",
+                 name, type, raw, hconv, raw, byte);
+      }
+   }
+   else if (e->bitlen == 1)
+   {
+      fprintf(fp, "static __inline boolean %s(const uint8 *IOmap)\n{\n   return (boolean)((IOmap[%u] >> %u) & 1);\n}\n",
+              name, byte, bit);
+      if (e->output)
+      {
+         fprintf(fp, "static __inline void %s_set(uint8 *IOmap, boolean v)\n{\n"
+                     "   IOmap[%u] = (uint8)(v ? (IOmap[%u] | 0x%02x) : (IOmap[%u] & ~0x%02x));\n}\n",
+                 name, byte, byte, 1 << bit, byte, 1 << bit);
+      }
+   }
+   else if (e->bitlen <= 32)
+   {
+      fprintf(fp, "static __inline uint32 %s(const uint8 *IOmap)\n{\n   uint64 v = 0;\n   int i;\n"
+                  "   for (i = 0; i < %u; i++) v |= (uint64)IOmap[%u + i] << (8 * i);\n"
+                  "   return (uint32)((v >> %u) & 0x%lxUL);\n}\n",
+              name, (bit + e->bitlen + 7) / 8, byte, bit, (unsigned long)(((uint64)1 << e->bitlen) - 1));
+      if (e->output)
+      {
+         fprintf(fp, "static __inline void %s_set(uint8 *IOmap, uint32 x)\n{\n   uint64 m = (uint64)0x%lxUL << %u;\n"
+                     "   uint64 v = (uint64)x << %u;\n   int i;\n"
+                     "   for (i = 0; i < %u; i++) IOmap[%u + i] = (uint8)((IOmap[%u + i] & ~(m >> (8 * i))) | ((v & m) >> (8 * i)));\n}\n",
+                 name, (unsigned long)(((uint64)1 << e->bitlen) - 1), bit, bit,
+                 (bit + e->bitlen + 7) / 8, byte, byte);
+      }
+   }
+   else
+   {
+      /* strings and arrays, byte access */
+      fprintf(fp, "static __inline uint8 *%s(uint8 *IOmap)\n{\n   return IOmap + %u;\n}\n", name, byte);
+   }
+}
+
+/** Generate a C header with the processdata layout of a mapped group.
+ * For every mapped object there are offset defines and typed accessors
+ * that take the IOmap, and the layout hash to check the live mapping with
+ * nexx_pdo_layouthash() before going to OP. Objects are named
+ * prefix_s<slave>_<in|out>_<index>_<subindex>, prefix max. 63 characters.
+ * The PDO entries of every slave are read once, for the accessors and the hash.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  fname          = file name of header
+ * @param[in]  prefix         = prefix of all names
+ * @return number of objects written, NEX_ERROR if the file can not be written
+ */
+int nexx_pdo_header(nexx_contextt *context, uint8 group, const char *fname, const char *prefix)
+{
+   nex_pdoentryt list[NEX_MAXPDOENTRY];
+   char upper[64], name[128];
+   uint32 bitpos, hash = 2166136261UL;
+   uint16 slave;
+   int i, n, cnt = 0;
+   FILE *fp;
+
+   fp = fopen(fname, "w");
+   if (!fp)
+   {
+      return NEX_ERROR;
+   }
+   for (i = 0; prefix[i] && (i < (int)sizeof(upper) - 1); i++)
+   {
+      upper[i] = (char)toupper((unsigned char)prefix[i]);
+   }
+   upper[i] = '\0';
+   fprintf(fp, "/* processdata layout, generated by nexx_pdo_header(), do not edit */\n\n");
+   fprintf(fp, "#ifndef _%s_LAYOUT_H\n#define _%s_LAYOUT_H\n\n#include <string.h>\n#include \"ethercat.h\"\n\n", upper, upper);
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      if (group && (group != context->slavelist[slave].group))
+      {
+         continue;
+      }
+      fprintf(fp, "/* slave %d %s, man 0x%08lx id 0x%08lx */\n", slave, context->slavelist[slave].name,
+              (unsigned long)context->slavelist[slave].eep_man, (unsigned long)context->slavelist[slave].eep_id);
+      n = nexx_readPDOentries(context, slave, list, NEX_MAXPDOENTRY);
+      hash = nexx_layout_hashslave(context, group, slave, list, n, hash);
+      nexx_layout_types(context, slave, list, n);
+      for (i = 0; i < n; i++)
+      {
+         if (!list[i].index || !list[i].bitlen)
+         {
+            continue; /* gap */
+         }
+         bitpos = nexx_layout_bitpos(context, group, slave, &list[i]);
+         sprintf(name, "%.63s_S%d_%s_%04X_%02X", upper, slave, list[i].output ? "OUT" : "IN",
+                 list[i].index, list[i].subindex);
+         fprintf(fp, "#define %s_BYTE %lu\n#define %s_BIT %lu\n#define %s_BITLEN %d\n",
+                 name, (unsigned long)(bitpos / 8), name, (unsigned long)(bitpos % 8), name, list[i].bitlen);
+         sprintf(name, "%.63s_s%d_%s_%04x_%02x", prefix, slave, list[i].output ? "out" : "in",
+                 list[i].index, list[i].subindex);
+         nexx_layout_emit(fp, name, &list[i], bitpos);
+         cnt++;
+      }
+      fprintf(fp, "\n");
+   }
+   fprintf(fp, "#define %s_LAYOUTHASH 0x%08lxUL\n\n", upper, (unsigned long)hash);
+   fprintf(fp, "/** check the live mapping against this header */\n");
+   fprintf(fp, "static __inline boolean %s_layout_ok(nexx_contextt *context, uint8 group)\n{\n"
+               "   return (boolean)(nexx_pdo_layouthash(context, group) == %s_LAYOUTHASH);\n}\n\n", prefix, upper);
+   fprintf(fp, "#endif\n");
+   fclose(fp);
+
+   return cnt;
+}
+
+#ifdef NEX_VER1
+int nex_readPDOentries(uint16 slave, nex_pdoentryt *list, int maxlist)
+{
+   return nexx_readPDOentries(&nexx_context, slave, list, maxlist);
+}
+
+uint32 nex_pdo_layouthash(uint8 group)
+{
+   return nexx_pdo_layouthash(&nexx_context, group);
+}
+
+int nex_pdo_header(uint8 group, const char *fname, const char *prefix)
+{
+   return nexx_pdo_header(&nexx_context, group, fname, prefix);
+}
+#endif
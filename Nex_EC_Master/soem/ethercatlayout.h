@@ -0,0 +1,58 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatlayout.c
+ */
+
+#ifndef _NEX_ECATLAYOUT_H
+#define _NEX_ECATLAYOUT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. PDO entries per slave read for the layout */
+#ifndef NEX_MAXPDOENTRY
+#define NEX_MAXPDOENTRY    256
+#endif
+
+/** one object mapped in the processdata of a slave */
+typedef struct nex_pdoentry
+{
+   /** object index, 0 for a gap */
+   uint16           index;
+   /** object subindex */
+   uint8            subindex;
+   /** length in bits */
+   uint8            bitlen;
+   /** data type from SII, 0 if not known. nexx_pdo_header() resolves the
+    * types of CoE entries from the SDO Info entry descriptions. */
+   uint8            datatype;
+   /** TRUE for outputs (RxPDO), FALSE for inputs (TxPDO) */
+   boolean          output;
+   /** PDO the object is mapped in */
+   uint16           pdo;
+   /** bit offset from start of slave outputs or inputs, startbit not included */
+   uint32           bitoffset;
+} nex_pdoentryt;
+
+#ifdef NEX_VER1
+int nex_readPDOentries(uint16 slave, nex_pdoentryt *list, int maxlist);
+uint32 nex_pdo_layouthash(uint8 group);
+int nex_pdo_header(uint8 group, const char *fname, const char *prefix);
+#endif
+
+int nexx_readPDOentries(nexx_contextt *context, uint16 slave, nex_pdoentryt *list, int maxlist);
+uint32 nexx_pdo_layouthash(nexx_contextt *context, uint8 group);
+int nexx_pdo_header(nexx_contextt *context, uint8 group, const char *fname, const char *prefix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATLAYOUT_H */
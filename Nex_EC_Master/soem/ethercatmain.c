@@ -17,15 +17,33 @@
 
 #include <stdio.h>
 #include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NEX_CMP_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define NEX_CMP_NEON
+#endif
 #include "osal.h"
 #include "oshw.h"
 #include "ethercattype.h"
 #include "ethercatbase.h"
 #include "ethercatmain.h"
+#include "ethercatroute.h"
+#include "ethercatcond.h"
+#include "ethercatovs.h"
+#include "ethercatrec.h"
+#include "ethercatmbxq.h"
 
 
 /** delay in us for eeprom ready loop */
 #define NEX_LOCALDELAY  200
+/** DC cycles without a new processdata cycle before the mapped mailbox full bit
+ * is taken as stale and SM1 status is read directly */
+#define NEX_MBXSTATUSCYCLES  4
+/** without a DC cycle time the mapped mailbox full bit is stale after this
+ * part of the mailbox timeout */
+#define NEX_MBXSTATUSDIV     4
 
 /** record for ethercat eeprom communications */
 PACKED_BEGIN
@@ -91,6 +109,8 @@ static nex_PDOdesct      nex_PDOdesc[NEX_MAX_MAPT];
 static nex_eepromSMt     nex_SM;
 /** buffer for EEPROM FMMU data */
 static nex_eepromFMMUt   nex_FMMU;
+/** mailbox buffers of the mailbox services */
+static nex_mbxpoolt      nex_mbxpool;
 /** Global variable TRUE if error available in error stack */
 boolean                 EcatError = FALSE;
 
@@ -120,7 +140,10 @@ nexx_contextt  nexx_context = {
     &nex_PDOdesc[0],     // .PDOdesc       =
     &nex_SM,             // .eepSM         =
     &nex_FMMU,           // .eepFMMU       =
-    NULL                // .FOEhook()
+    NULL,               // .FOEhook()
+    0,                  // .ALtO          =
+    0,                  // .ALeO          =
+    &nex_mbxpool         // .mbxpool       =
 };
 #endif
 
@@ -921,6 +944,96 @@ void nex_clearmbx(nex_mbxbuft *Mbx)
     memset(Mbx, 0x00, NEX_MAXMBX);
 }
 
+/** Take a mailbox buffer from the pool of the context. Lock free, may be
+ * called from any thread. If the pool is used up or the context has none
+ * the buffer is allocated. Return it with nexx_mbxput().
+ * @param[in] context  = context struct
+ * @return mailbox buffer, NULL if out of memory
+ */
+nex_mbxbuft *nexx_mbxget(nexx_contextt *context)
+{
+   nex_mbxpoolt *pool = context->mbxpool;
+   uint32 used;
+   int i;
+
+   if (pool)
+   {
+      used = osal_atomic_load(&(pool->used));
+      i = 0;
+      while (i < NEX_MBXPOOLSIZE)
+      {
+         if (used & (1U << i))
+         {
+            i++;
+         }
+         else if (osal_atomic_cas(&(pool->used), used, used | (1U << i)))
+         {
+            return &(pool->buf[i]);
+         }
+         else
+         {
+            /* taken or returned by another thread, search again */
+            used = osal_atomic_load(&(pool->used));
+            i = 0;
+         }
+      }
+   }
+
+   return (nex_mbxbuft *)osal_malloc(sizeof(nex_mbxbuft));
+}
+
+/** Return a mailbox buffer of nexx_mbxget().
+ * @param[in] context  = context struct
+ * @param[in] mbx      = mailbox buffer, NULL is ignored
+ */
+void nexx_mbxput(nexx_contextt *context, nex_mbxbuft *mbx)
+{
+   nex_mbxpoolt *pool = context->mbxpool;
+   uint32 used, bit;
+
+   if (!mbx)
+   {
+      return;
+   }
+   if (pool && (mbx >= &(pool->buf[0])) && (mbx < &(pool->buf[NEX_MBXPOOLSIZE])))
+   {
+      bit = 1U << (mbx - &(pool->buf[0]));
+      do
+      {
+         used = osal_atomic_load(&(pool->used));
+      } while (!osal_atomic_cas(&(pool->used), used, used & ~bit));
+   }
+   else
+   {
+      osal_free(mbx);
+   }
+}
+
+/** Clear the part of a mailbox buffer that is used with a slave. A request
+ * is cleared for the length of the write mailbox of the slave, which is
+ * what goes on the wire. A response only for the headers, nexx_mbxreceive()
+ * overwrites the rest.
+ * @param[in]  context  = context struct
+ * @param[in]  slave    = Slave number
+ * @param[out] mbx      = mailbox buffer to clear
+ * @param[in]  request  = TRUE for a request, FALSE for a response
+ */
+void nexx_mbxclear(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, boolean request)
+{
+   int size;
+
+   size = NEX_MBXHEADCLEAR;
+   if (request)
+   {
+      size = context->slavelist[slave].mbx_l;
+      if ((size <= 0) || (size > NEX_MAXMBX))
+      {
+         size = NEX_MAXMBX;
+      }
+   }
+   memset(mbx, 0x00, size);
+}
+
 /** Check if IN mailbox of slave is empty.
  * @param[in] context  = context struct
  * @param[in] slave    = Slave number
@@ -988,6 +1101,40 @@ int nexx_mbxsend(nexx_contextt *context, uint16 slave,nex_mbxbuft *mbx, int time
    return wkc;
 }
 
+/** Check a mailbox read from a slave for a mailbox error or a CoE emergency.
+ * Both are reported in the error list.
+ * @param[in]  context    = context struct
+ * @param[in]  slave      = Slave number
+ * @param[in]  mbx        = Mailbox data
+ * @return 1 for a response, 0 for an emergency, -1 for a mailbox error
+ */
+int nexx_mbxcheck(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx)
+{
+   nex_mbxheadert *mbxh;
+   nex_emcyt *EMp;
+   nex_mbxerrort *MBXEp;
+
+   mbxh = (nex_mbxheadert *)mbx;
+   if ((mbxh->mbxtype & 0x0f) == 0x00) /* Mailbox error response? */
+   {
+      MBXEp = (nex_mbxerrort *)mbx;
+      nexx_mbxerror(context, slave, etohs(MBXEp->Detail));
+      return -1;
+   }
+   if ((mbxh->mbxtype & 0x0f) == 0x03) /* CoE response? */
+   {
+      EMp = (nex_emcyt *)mbx;
+      if ((etohs(EMp->CANOpen) >> 12) == 0x01) /* Emergency request? */
+      {
+         nexx_mbxemergencyerror(context, slave, etohs(EMp->ErrorCode), EMp->ErrorReg,
+                 EMp->bData, etohs(EMp->w1), etohs(EMp->w2));
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
 /** Read OUT mailbox from slave.
  * Supports Mailbox Link Layer with repeat requests.
  * @param[in]  context    = context struct
@@ -1003,12 +1150,34 @@ int nexx_mbxreceive(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, int
    int wkc2;
    uint16 SMstat;
    uint8 SMcontr;
-   nex_mbxheadert *mbxh;
-   nex_emcyt *EMp;
-   nex_mbxerrort *MBXEp;
-
-   configadr = context->slavelist[slave].configadr;
-   mbxl = context->slavelist[slave].mbx_rl;
+   nex_slavet *sl;
+   volatile uint32 *pdcnt = NULL;
+   uint32 cnt = 0, c;
+   int stalet = 0;
+   nex_groupt *grp;
+   osal_timert staletimer;
+
+   sl = &(context->slavelist[slave]);
+   configadr = sl->configadr;
+   mbxl = sl->mbx_rl;
+   /* mailbox full bit in the processdata, only if there is time to wait for a cycle */
+   if (sl->mbxstatus && (timeout > NEX_LOCALDELAY))
+   {
+      grp = &(context->grouplist[sl->mbxstatusgroup]);
+      pdcnt = &(grp->mbxstatuscnt);
+      cnt = osal_atomic_load(pdcnt);
+      /* stale after a few cycles of the group, or a part of the timeout */
+      stalet = timeout / NEX_MBXSTATUSDIV;
+      if (grp->hasdc && (context->slavelist[grp->DCnext].DCcycle > 0))
+      {
+         stalet = NEX_MBXSTATUSCYCLES * (context->slavelist[grp->DCnext].DCcycle / 1000);
+      }
+      if (stalet < NEX_LOCALDELAY)
+      {
+         stalet = NEX_LOCALDELAY;
+      }
+      osal_timer_start(&staletimer, stalet);
+   }
    if ((mbxl > 0) && (mbxl <= NEX_MAXMBX))
    {
       osal_timert timer;
@@ -1018,8 +1187,29 @@ int nexx_mbxreceive(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, int
       do /* wait for read mailbox available */
       {
          SMstat = 0;
-         wkc = nexx_FPRD(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
-         SMstat = etohs(SMstat);
+         if (pdcnt)
+         {
+            /* no frame, wait for a processdata cycle that shows the mailbox full */
+            wkc = 0;
+            c = osal_atomic_load(pdcnt);
+            if (c != cnt)
+            {
+               cnt = c;
+               osal_timer_start(&staletimer, stalet);
+               wkc = 1;
+               SMstat = (uint16)(((sl->mbxstatus[0] >> sl->mbxstatusbit) & 0x01) << 3);
+            }
+            else if (osal_timer_is_expired(&staletimer))
+            {
+               /* processdata not running, poll SM1 status */
+               pdcnt = NULL;
+            }
+         }
+         else
+         {
+            wkc = nexx_FPRD(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
+            SMstat = etohs(SMstat);
+         }
          if (((SMstat & 0x08) == 0) && (timeout > NEX_LOCALDELAY))
          {
             osal_usleep(NEX_LOCALDELAY);
@@ -1030,23 +1220,13 @@ int nexx_mbxreceive(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, int
       if ((wkc > 0) && ((SMstat & 0x08) > 0)) /* read mailbox available ? */
       {
          mbxro = context->slavelist[slave].mbx_ro;
-         mbxh = (nex_mbxheadert *)mbx;
          do
          {
             wkc = nexx_FPRD(context->port, configadr, mbxro, mbxl, mbx, NEX_TIMEOUTRET); /* get mailbox */
-            if ((wkc > 0) && ((mbxh->mbxtype & 0x0f) == 0x00)) /* Mailbox error response? */
+            if (wkc > 0)
             {
-               MBXEp = (nex_mbxerrort *)mbx;
-               nexx_mbxerror(context, slave, etohs(MBXEp->Detail));
-               wkc = 0; /* prevent emergency to cascade up, it is already handled. */
-            }
-            else if ((wkc > 0) && ((mbxh->mbxtype & 0x0f) == 0x03)) /* CoE response? */
-            {
-               EMp = (nex_emcyt *)mbx;
-               if ((etohs(EMp->CANOpen) >> 12) == 0x01) /* Emergency request? */
+               if (nexx_mbxcheck(context, slave, mbx) <= 0)
                {
-                  nexx_mbxemergencyerror(context, slave, etohs(EMp->ErrorCode), EMp->ErrorReg,
-                          EMp->bData, etohs(EMp->w1), etohs(EMp->w2));
                   wkc = 0; /* prevent emergency to cascade up, it is already handled. */
                }
             }
@@ -1054,14 +1234,26 @@ int nexx_mbxreceive(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, int
             {
                if (wkc <= 0) /* read mailbox lost */
                {
-                  SMstat ^= 0x0200; /* toggle repeat request */
-                  SMstat = htoes(SMstat);
-                  wkc2 = nexx_FPWR(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
-                  SMstat = etohs(SMstat);
-                  do /* wait for toggle ack */
+                  wkc2 = 1;
+                  if (pdcnt)
+                  {
+                     /* status from the processdata has no repeat request bit */
+                     wkc2 = nexx_FPRD(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
+                     SMstat = etohs(SMstat);
+                  }
+                  /* a full bit from an older processdata cycle may belong to a
+                     mailbox already read, then only wait for the next one */
+                  if ((wkc2 > 0) && ((SMstat & 0x08) > 0))
                   {
-                     wkc2 = nexx_FPRD(context->port, configadr, ECT_REG_SM1CONTR, sizeof(SMcontr), &SMcontr, NEX_TIMEOUTRET);
-                   } while (((wkc2 <= 0) || ((SMcontr & 0x02) != (HI_BYTE(SMstat) & 0x02))) && (osal_timer_is_expired(&timer) == FALSE));
+                     SMstat ^= 0x0200; /* toggle repeat request */
+                     SMstat = htoes(SMstat);
+                     wkc2 = nexx_FPWR(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
+                     SMstat = etohs(SMstat);
+                     do /* wait for toggle ack */
+                     {
+                        wkc2 = nexx_FPRD(context->port, configadr, ECT_REG_SM1CONTR, sizeof(SMcontr), &SMcontr, NEX_TIMEOUTRET);
+                     } while (((wkc2 <= 0) || ((SMcontr & 0x02) != (HI_BYTE(SMstat) & 0x02))) && (osal_timer_is_expired(&timer) == FALSE));
+                  }
                   do /* wait for read mailbox available */
                   {
                      wkc2 = nexx_FPRD(context->port, configadr, ECT_REG_SM1STAT, sizeof(SMstat), &SMstat, NEX_TIMEOUTRET);
@@ -1619,16 +1811,24 @@ uint32 nexx_readeeprom2(nexx_contextt *context, uint16 slave, int timeout)
  * @param[in] idx         = Used datagram index.
  * @param[in] data        = Pointer to process data segment.
  * @param[in] length      = Length of data segment in bytes.
+ * @param[in] segment     = IO segment carried by the datagram.
+ * @return 1 if pushed, 0 if the stack is full.
  */
-static void nexx_pushindex(nexx_contextt *context, uint8 idx, void *data, uint16 length)
+static int nexx_pushindex(nexx_contextt *context, uint8 idx, void *data, uint16 length, uint16 segment)
 {
    if(context->idxstack->pushed < NEX_MAXBUF)
    {
       context->idxstack->idx[context->idxstack->pushed] = idx;
       context->idxstack->data[context->idxstack->pushed] = data;
       context->idxstack->length[context->idxstack->pushed] = length;
+      context->idxstack->segment[context->idxstack->pushed] = segment;
       context->idxstack->pushed++;
+      return 1;
    }
+   /* more frames than NEX_MAXBUF, the segment can not be received */
+   nexx_packeterror(context, 0, 0, 0, 12); /* processdata stack full */
+
+   return 0;
 }
 
 /** Pull index of segmented LRD/LWR/LRW combination.
@@ -1656,7 +1856,188 @@ static void nexx_clearindex(nexx_contextt *context)  {
 
    context->idxstack->pushed = 0;
    context->idxstack->pulled = 0;
+   context->idxstack->first = FALSE;
+
+}
+
+/** Add the datagrams that travel with the first processdata frame.
+ * The DC datagram distributes the reference clock, the AL status and AL event
+ * broadcast reads give the state of all slaves without an extra frame.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  idx            = index of first processdata frame
+ * @param[in]  sublength      = length of processdata datagram in frame
+ */
+static void nexx_main_add_firstdatagrams(nexx_contextt *context, uint8 group, uint8 idx, int sublength)
+{
+   nex_groupt *grp;
+   boolean ALcheck;
+   uint32 ALdummy = 0;
+
+   grp = &(context->grouplist[group]);
+   context->DCl = sublength;
+   context->ALtO = 0;
+   /* only if it fits, the group could be mapped without room for it */
+   ALcheck = (grp->ALcheck &&
+      ((context->port->txbuflength[idx] + (grp->hasdc ? NEX_FIRSTDCDATAGRAM : 0) + NEX_FIRSTALDATAGRAM) <=
+       (int)(ETH_HEADERSIZE + NEX_HEADERSIZE + NEX_MAXLRWDATA + NEX_WKCSIZE)));
+   if(grp->hasdc)
+   {
+      /* FPRMW in second datagram */
+      context->DCtO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_FRMW, idx, ALcheck,
+                               context->slavelist[grp->DCnext].configadr,
+                               ECT_REG_DCSYSTIME, sizeof(int64), context->DCtime);
+   }
+   if(ALcheck)
+   {
+      context->ALtO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_BRD, idx, TRUE,
+                               0, ECT_REG_ALSTAT, sizeof(uint16), &ALdummy);
+      context->ALeO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_BRD, idx, FALSE,
+                               0, ECT_REG_ALEVENT, sizeof(uint32), &ALdummy);
+   }
+   if(grp->mbxq)
+   {
+      nexx_mbxq_fill(grp->mbxq, idx);
+   }
+}
+
+/** Evaluate the AL status and AL event datagrams of the first processdata frame.
+ * A slave that left the common state, raised the error flag or stopped
+ * responding triggers docheckstate of the group. Only a single state bit
+ * proves a common state, any other ORed value triggers it as well.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  idx            = index of first processdata frame
+ */
+static void nexx_main_check_alstatus(nexx_contextt *context, uint8 group, int idx)
+{
+   nex_groupt *grp;
+   uint16 le_w;
+   uint32 le_l;
+
+   grp = &(context->grouplist[group]);
+   memcpy(&le_w, &(context->port->rxbuf[idx][context->ALtO]), sizeof(le_w));
+   grp->ALstatus = etohs(le_w);
+   memcpy(&le_w, &(context->port->rxbuf[idx][context->ALtO + sizeof(uint16)]), NEX_WKCSIZE);
+   grp->ALstatuswkc = etohs(le_w);
+   memcpy(&le_l, &(context->port->rxbuf[idx][context->ALeO]), sizeof(le_l));
+   grp->ALevent = etohl(le_l);
+   if ((grp->ALstatus & NEX_STATE_ERROR) || (grp->ALstatuswkc < *(context->slavecount)))
+   {
+      grp->docheckstate = TRUE;
+   }
+   switch (grp->ALstatus & 0x0f)
+   {
+      case NEX_STATE_INIT:
+      case NEX_STATE_PRE_OP:
+      case NEX_STATE_SAFE_OP:
+      case NEX_STATE_OPERATIONAL:
+         break;
+      default:
+         /* slaves are not in the same state, or in BOOT that can not be told
+            apart from INIT and PRE_OP ORed together, read them one by one */
+         grp->docheckstate = TRUE;
+         break;
+   }
+}
+
+/** Expected workcounter of an IO segment for the processdata phase.
+ * @param[in]  grp            = group struct
+ * @param[in]  seg            = IO segment
+ * @param[in]  phase          = NEX_PD_INPUTS, NEX_PD_OUTPUTS or NEX_PD_ALL
+ * @return expected workcounter, outputs count 2 times
+ */
+static uint16 nexx_main_segmentwkc(nex_groupt *grp, uint16 seg, uint8 phase)
+{
+   uint16 wkc = 0;
 
+   if (phase & NEX_PD_OUTPUTS)
+   {
+      wkc += (uint16)(grp->IOsegmentOWKC[seg] * 2);
+   }
+   if (phase & NEX_PD_INPUTS)
+   {
+      wkc += grp->IOsegmentIWKC[seg];
+   }
+   return wkc;
+}
+
+/** Compare output data with the copy last transmitted, 16 bytes at a time.
+ * @param[in]  a              = outputs
+ * @param[in]  b              = copy of outputs
+ * @param[in]  length         = length in bytes
+ * @return TRUE if one or more bytes differ
+ */
+static boolean nexx_main_outputs_changed(const uint8 *a, const uint8 *b, int length)
+{
+   int i = 0;
+#if defined(NEX_CMP_SSE2)
+   __m128i va, vb;
+
+   for (; (i + 16) <= length; i += 16)
+   {
+      va = _mm_loadu_si128((const __m128i *)(a + i));
+      vb = _mm_loadu_si128((const __m128i *)(b + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+      {
+         return TRUE;
+      }
+   }
+#elif defined(NEX_CMP_NEON)
+   uint8x16_t vx;
+
+   for (; (i + 16) <= length; i += 16)
+   {
+      vx = veorq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+#if defined(__aarch64__)
+      if (vmaxvq_u8(vx))
+#else
+      /* ARMv7 has no across vector reduction, fold the halves to 64 bits */
+      if (vget_lane_u64(vreinterpret_u64_u8(vorr_u8(vget_low_u8(vx), vget_high_u8(vx))), 0))
+#endif
+      {
+         return TRUE;
+      }
+   }
+#endif
+   return (boolean)((i < length) && memcmp(a + i, b + i, length - i));
+}
+
+/** Check if the outputs in a segment can be skipped by change-driven output
+ * transmission, otherwise update the copy of the transmitted outputs.
+ * Segments that also carry inputs are always transmitted.
+ * @param[in]  grp            = group struct
+ * @param[in]  seg            = IO segment
+ * @param[in]  data           = start of segment in IOmap
+ * @param[in]  sublength      = length of segment
+ * @param[in]  inputs         = segment datagram also carries inputs (LRW)
+ * @param[in]  refresh        = forced transmission of all outputs
+ * @return TRUE if the segment is unchanged and is not transmitted
+ */
+static boolean nexx_main_skipoutputs(nex_groupt *grp, uint16 seg, uint8 *data, int sublength,
+                                     boolean inputs, boolean refresh)
+{
+   uint32 offset;
+
+   /* a segment short at its last transmission is sent until it is complete */
+   if (!grp->Oshadow || !grp->IOsegmentOgood[seg] || (data < grp->outputs) ||
+       (inputs && grp->IOsegmentIWKC[seg]))
+   {
+      return FALSE;
+   }
+   offset = (uint32)(data - grp->outputs);
+   if ((offset + sublength) > grp->Obytes)
+   {
+      return FALSE;
+   }
+   if (refresh || nexx_main_outputs_changed(data, grp->Oshadow + offset, sublength))
+   {
+      memcpy(grp->Oshadow + offset, data, sublength);
+      return FALSE;
+   }
+   grp->IOsegmentskip[seg] = TRUE;
+
+   return TRUE;
 }
 
 /** Transmit processdata to slaves.
@@ -1667,27 +2048,50 @@ static void nexx_clearindex(nexx_contextt *context)  {
  * In contrast to the base LRW function this function is non-blocking.
  * If the processdata does not fit in one datagram, multiple are used.
  * In order to recombine the slave response, a stack is used.
+ * With change-driven outputs (Oshadow set) segments with only unchanged
+ * outputs are not transmitted, at least every Owatchdog us all are.
+ * With phase NEX_PD_INPUTS or NEX_PD_OUTPUTS only the LRD or only the LWR
+ * part is transmitted. The DC and AL datagrams travel with the inputs, or with
+ * the outputs if the group has no inputs.
  * @param[in]  context        = context struct
  * @param[in]  group          = group number
- * @return >0 if processdata is transmitted.
+ * @param[in]  use_overlap_io = group is mapped with overlapping IOmap
+ * @param[in]  phase          = NEX_PD_INPUTS, NEX_PD_OUTPUTS or NEX_PD_ALL
+ * @return >0 if processdata is transmitted, NEX_ERROR if the frames do not fit in the stack.
  */
-static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boolean use_overlap_io)
+static int nexx_main_send_frames(nexx_contextt *context, uint8 group, boolean use_overlap_io, uint8 phase)
 {
    uint32 LogAdr;
    uint16 w1, w2;
    int length, sublength;
    uint8 idx;
-   int wkc;
+   int wkc, mbxidx;
    uint8* data;
    boolean first=FALSE;
+   boolean refresh=FALSE;
    uint16 currentsegment = 0;
    uint32 iomapinputoffset;
+   nex_groupt *grp;
 
    wkc = 0;
-   if(context->grouplist[group].hasdc)
+   if((context->grouplist[group].hasdc || context->grouplist[group].ALcheck) &&
+      ((phase & NEX_PD_INPUTS) || !context->grouplist[group].Ibytes))
+   {
+      first = TRUE;
+   }
+   context->idxstack->phase = phase;
+   grp = &(context->grouplist[group]);
+   /* mailbox datagrams of the asynchronous engine travel with the first frame */
+   if (grp->mbxq && ((phase & NEX_PD_INPUTS) || !grp->Ibytes) && (nexx_mbxq_prepare(grp->mbxq) > 0))
    {
       first = TRUE;
    }
+   memset(grp->IOsegmentskip, 0x00, sizeof(grp->IOsegmentskip));
+   if (grp->Oshadow && (phase & NEX_PD_OUTPUTS) && osal_timer_is_expired(&(grp->Orefresh)))
+   {
+      refresh = TRUE;
+      osal_timer_start(&(grp->Orefresh), grp->Owatchdog);
+   }
 
    /* For overlapping IO map use the biggest */
    if(use_overlap_io == TRUE)
@@ -1709,11 +2113,11 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
    {
 
       wkc = 1;
-      /* LRW blocked by one or more slaves ? */
-      if(context->grouplist[group].blockLRW)
+      /* LRW blocked by one or more slaves or only one phase ? */
+      if(context->grouplist[group].blockLRW || (phase != NEX_PD_ALL))
       {
          /* if inputs available generate LRD */
-         if(context->grouplist[group].Ibytes)
+         if((phase & NEX_PD_INPUTS) && context->grouplist[group].Ibytes)
          {
             currentsegment = context->grouplist[group].Isegment;
             data = context->grouplist[group].inputs;
@@ -1737,24 +2141,25 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
                nexx_setupdatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_LRD, idx, w1, w2, sublength, data);
                if(first)
                {
-                  context->DCl = sublength;
-                  /* FPRMW in second datagram */
-                  context->DCtO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_FRMW, idx, FALSE,
-                                           context->slavelist[context->grouplist[group].DCnext].configadr,
-                                           ECT_REG_DCSYSTIME, sizeof(int64), context->DCtime);
+                  nexx_main_add_firstdatagrams(context, group, idx, sublength);
+                  context->idxstack->first = TRUE;
                   first = FALSE;
                }
+               /* push index and data pointer on stack */
+               if(!nexx_pushindex(context, idx, data, sublength, currentsegment - 1))
+               {
+                  nexx_setbufstat(context->port, idx, NEX_BUF_EMPTY);
+                  return NEX_ERROR;
+               }
                /* send frame */
                nexx_outframe_red(context->port, idx);
-               /* push index and data pointer on stack */
-               nexx_pushindex(context, idx, data, sublength);
                length -= sublength;
                LogAdr += sublength;
                data += sublength;
             } while (length && (currentsegment < context->grouplist[group].nsegments));
          }
          /* if outputs available generate LWR */
-         if(context->grouplist[group].Obytes)
+         if((phase & NEX_PD_OUTPUTS) && context->grouplist[group].Obytes)
          {
             data = context->grouplist[group].outputs;
             length = context->grouplist[group].Obytes;
@@ -1768,6 +2173,13 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
                {
                   sublength = length;
                }
+               if(!first && nexx_main_skipoutputs(grp, currentsegment - 1, data, sublength, FALSE, refresh))
+               {
+                  length -= sublength;
+                  LogAdr += sublength;
+                  data += sublength;
+                  continue;
+               }
                /* get new index */
                idx = nexx_getindex(context->port);
                w1 = LO_WORD(LogAdr);
@@ -1775,17 +2187,18 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
                nexx_setupdatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_LWR, idx, w1, w2, sublength, data);
                if(first)
                {
-                  context->DCl = sublength;
-                  /* FPRMW in second datagram */
-                  context->DCtO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_FRMW, idx, FALSE,
-                                           context->slavelist[context->grouplist[group].DCnext].configadr,
-                                           ECT_REG_DCSYSTIME, sizeof(int64), context->DCtime);
+                  nexx_main_add_firstdatagrams(context, group, idx, sublength);
+                  context->idxstack->first = TRUE;
                   first = FALSE;
                }
+               /* push index and data pointer on stack */
+               if(!nexx_pushindex(context, idx, data, sublength, currentsegment - 1))
+               {
+                  nexx_setbufstat(context->port, idx, NEX_BUF_EMPTY);
+                  return NEX_ERROR;
+               }
                /* send frame */
                nexx_outframe_red(context->port, idx);
-               /* push index and data pointer on stack */
-               nexx_pushindex(context, idx, data, sublength);
                length -= sublength;
                LogAdr += sublength;
                data += sublength;
@@ -1809,6 +2222,13 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
          do
          {
             sublength = context->grouplist[group].IOsegment[currentsegment++];
+            if(!first && nexx_main_skipoutputs(grp, currentsegment - 1, data, sublength, TRUE, refresh))
+            {
+               length -= sublength;
+               LogAdr += sublength;
+               data += sublength;
+               continue;
+            }
             /* get new index */
             idx = nexx_getindex(context->port);
             w1 = LO_WORD(LogAdr);
@@ -1816,27 +2236,56 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
             nexx_setupdatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_LRW, idx, w1, w2, sublength, data);
             if(first)
             {
-               context->DCl = sublength;
-               /* FPRMW in second datagram */
-               context->DCtO = nexx_adddatagram(context->port, &(context->port->txbuf[idx]), NEX_CMD_FRMW, idx, FALSE,
-                                        context->slavelist[context->grouplist[group].DCnext].configadr,
-                                        ECT_REG_DCSYSTIME, sizeof(int64), context->DCtime);
+               nexx_main_add_firstdatagrams(context, group, idx, sublength);
+               context->idxstack->first = TRUE;
                first = FALSE;
             }
-            /* send frame */
-            nexx_outframe_red(context->port, idx);
             /* push index and data pointer on stack.
              * the iomapinputoffset compensate for where the inputs are stored 
              * in the IOmap if we use an overlapping IOmap. If a regular IOmap
              * is used it should always be 0.
              */
-            nexx_pushindex(context, idx, (data + iomapinputoffset), sublength);      
+            if(!nexx_pushindex(context, idx, (data + iomapinputoffset), sublength, currentsegment - 1))
+            {
+               nexx_setbufstat(context->port, idx, NEX_BUF_EMPTY);
+               return NEX_ERROR;
+            }
+            /* send frame */
+            nexx_outframe_red(context->port, idx);
             length -= sublength;
             LogAdr += sublength;
             data += sublength;
          } while (length && (currentsegment < context->grouplist[group].nsegments));
       }
    }
+   /* mailbox datagrams that did not fit go in one extra frame */
+   if (grp->mbxq && ((mbxidx = nexx_mbxq_frame(grp->mbxq)) >= 0))
+   {
+      idx = (uint8)mbxidx;
+      if (!nexx_pushindex(context, idx, NULL, 0, 0))
+      {
+         nexx_setbufstat(context->port, idx, NEX_BUF_EMPTY);
+         return NEX_ERROR;
+      }
+      nexx_outframe_red(context->port, idx);
+   }
+
+   return wkc;
+}
+
+/** Send processdata with the mailbox engine of the group held, see
+ * nexx_main_send_frames(). nexx_mbxq_close() waits until it is released.
+ */
+static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boolean use_overlap_io, uint8 phase)
+{
+   nex_groupt *grp = &(context->grouplist[group]);
+   int wkc;
+
+   osal_atomic_add(&(grp->mbxqbusy), 1);
+   /* counted before the engine is looked up */
+   osal_atomic_fence();
+   wkc = nexx_main_send_frames(context, group, use_overlap_io, phase);
+   osal_atomic_add(&(grp->mbxqbusy), (uint32)-1);
 
    return wkc;
 }
@@ -1855,7 +2304,7 @@ static int nexx_main_send_processdata(nexx_contextt *context, uint8 group, boole
 */
 int nexx_send_overlap_processdata_group(nexx_contextt *context, uint8 group)
 {
-   return nexx_main_send_processdata(context, group, TRUE);
+   return nexx_main_send_processdata(context, group, TRUE, NEX_PD_ALL);
 }
 
 /** Transmit processdata to slaves.
@@ -1872,58 +2321,102 @@ int nexx_send_overlap_processdata_group(nexx_contextt *context, uint8 group)
 */
 int nexx_send_processdata_group(nexx_contextt *context, uint8 group)
 {
-   return nexx_main_send_processdata(context, group, FALSE);
+   return nexx_main_send_processdata(context, group, FALSE, NEX_PD_ALL);
 }
 
-/** Receive processdata from slaves.
- * Second part from nex_send_processdata().
- * Received datagrams are recombined with the processdata with help from the stack.
- * If a datagram contains input processdata it copies it to the processdata structure.
+/** Transmit the input part of the processdata with LRD.
+ * First part of the two-phase cycle, the DC and AL datagrams travel with the
+ * inputs. The group has to be mapped without overlap.
+ * The inputs are gathered with the receive processdata function.
  * @param[in]  context        = context struct
  * @param[in]  group          = group number
- * @param[in]  timeout        = Timeout in us.
- * @return Work counter.
+ * @return >0 if processdata is transmitted, NEX_ERROR if the group is mapped
+ * with overlap.
  */
-int nexx_receive_processdata_group(nexx_contextt *context, uint8 group, int timeout)
+int nexx_send_inputs_processdata_group(nexx_contextt *context, uint8 group)
+{
+   if (context->grouplist[group].overlap)
+   {
+      return NEX_ERROR;
+   }
+   return nexx_main_send_processdata(context, group, FALSE, NEX_PD_INPUTS);
+}
+
+/** Transmit the output part of the processdata with LWR.
+ * Second part of the two-phase cycle. The workcounter returned by the receive
+ * processdata function counts the outputs 2 times, as with LRW. The group
+ * has to be mapped without overlap.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @return >0 if processdata is transmitted, NEX_ERROR if the group is mapped
+ * with overlap.
+ */
+int nexx_send_outputs_processdata_group(nexx_contextt *context, uint8 group)
+{
+   if (context->grouplist[group].overlap)
+   {
+      return NEX_ERROR;
+   }
+   return nexx_main_send_processdata(context, group, FALSE, NEX_PD_OUTPUTS);
+}
+
+/** Receive the frames of send processdata, see nexx_receive_processdata_group(). */
+static int nexx_main_receive_frames(nexx_contextt *context, uint8 group, int timeout)
 {
    int pos, idx;
    int wkc = 0, wkc2;
    uint16 le_wkc = 0;
    int valid_wkc = 0;
    int64 le_DCtime;
-   boolean first = FALSE;
-
-   if(context->grouplist[group].hasdc)
-   {
-      first = TRUE;
-   }
+   boolean first;
+   nex_groupt *grp;
+   uint16 seg;
+   uint8 phase;
+
+   grp = &(context->grouplist[group]);
+   first = context->idxstack->first;
+   phase = context->idxstack->phase;
+   memset(grp->IOsegmentwkc, 0x00, grp->nsegments * sizeof(uint16));
    /* get first index */
    pos = nexx_pullindex(context);
    /* read the same number of frames as send */
    while (pos >= 0)
    {
       idx = context->idxstack->idx[pos];
+      seg = context->idxstack->segment[pos];
       wkc2 = nexx_waitinframe(context->port, context->idxstack->idx[pos], timeout);
       /* check if there is input data in frame */
       if (wkc2 > NEX_NOFRAME)
       {
+         if(grp->mbxq)
+         {
+            nexx_mbxq_receive(grp->mbxq, (uint8)idx);
+         }
          if((context->port->rxbuf[idx][NEX_CMDOFFSET]==NEX_CMD_LRD) || (context->port->rxbuf[idx][NEX_CMDOFFSET]==NEX_CMD_LRW))
          {
             if(first)
             {
                memcpy(context->idxstack->data[pos], &(context->port->rxbuf[idx][NEX_HEADERSIZE]), context->DCl);
                memcpy(&le_wkc, &(context->port->rxbuf[idx][NEX_HEADERSIZE + context->DCl]), NEX_WKCSIZE);
-               wkc = etohs(le_wkc);
-               memcpy(&le_DCtime, &(context->port->rxbuf[idx][context->DCtO]), sizeof(le_DCtime));
-               *(context->DCtime) = etohll(le_DCtime);
+               wkc2 = etohs(le_wkc);
+               if(grp->hasdc)
+               {
+                  memcpy(&le_DCtime, &(context->port->rxbuf[idx][context->DCtO]), sizeof(le_DCtime));
+                  *(context->DCtime) = etohll(le_DCtime);
+               }
+               if(context->ALtO)
+               {
+                  nexx_main_check_alstatus(context, group, idx);
+               }
                first = FALSE;
             }
             else
             {
                /* copy input data back to process data buffer */
                memcpy(context->idxstack->data[pos], &(context->port->rxbuf[idx][NEX_HEADERSIZE]), context->idxstack->length[pos]);
-               wkc += wkc2;
             }
+            wkc += wkc2;
+            grp->IOsegmentwkc[seg] += (uint16)wkc2;
             valid_wkc = 1;
          }
          else if(context->port->rxbuf[idx][NEX_CMDOFFSET]==NEX_CMD_LWR)
@@ -1931,20 +2424,29 @@ int nexx_receive_processdata_group(nexx_contextt *context, uint8 group, int time
             if(first)
             {
                memcpy(&le_wkc, &(context->port->rxbuf[idx][NEX_HEADERSIZE + context->DCl]), NEX_WKCSIZE);
-               /* output WKC counts 2 times when using LRW, emulate the same for LWR */
-               wkc = etohs(le_wkc) * 2;
-               memcpy(&le_DCtime, &(context->port->rxbuf[idx][context->DCtO]), sizeof(le_DCtime));
-               *(context->DCtime) = etohll(le_DCtime);
+               wkc2 = etohs(le_wkc);
+               if(grp->hasdc)
+               {
+                  memcpy(&le_DCtime, &(context->port->rxbuf[idx][context->DCtO]), sizeof(le_DCtime));
+                  *(context->DCtime) = etohll(le_DCtime);
+               }
+               if(context->ALtO)
+               {
+                  nexx_main_check_alstatus(context, group, idx);
+               }
                first = FALSE;
             }
-            else
-            {
-               /* output WKC counts 2 times when using LRW, emulate the same for LWR */
-               wkc += wkc2 * 2;
-            }
+            /* output WKC counts 2 times when using LRW, emulate the same for LWR */
+            wkc += wkc2 * 2;
+            grp->IOsegmentwkc[seg] += (uint16)(wkc2 * 2);
             valid_wkc = 1;
          }
       }
+      else if(grp->mbxq)
+      {
+         /* the index may carry a frame of the other phase next */
+         nexx_mbxq_lost(grp->mbxq, (uint8)idx);
+      }
       /* release buffer */
       nexx_setbufstat(context->port, idx, NEX_BUF_EMPTY);
       /* get next index */
@@ -1953,14 +2455,213 @@ int nexx_receive_processdata_group(nexx_contextt *context, uint8 group, int time
 
    nexx_clearindex(context);
 
+   if (grp->mbxstatus && valid_wkc && (phase & NEX_PD_INPUTS))
+   {
+      /* mapped mailbox full bits are fresh */
+      osal_atomic_add(&(grp->mbxstatuscnt), 1);
+   }
+
+   /* segments skipped by change-driven outputs count as transmitted, they
+      were complete at their last transmission */
+   for (seg = 0; seg < grp->nsegments; seg++)
+   {
+      if (grp->Oshadow && (phase & NEX_PD_OUTPUTS) && !grp->IOsegmentskip[seg])
+      {
+         grp->IOsegmentOgood[seg] = (boolean)(grp->IOsegmentwkc[seg] >= nexx_main_segmentwkc(grp, seg, phase));
+      }
+      if (grp->IOsegmentskip[seg])
+      {
+         wkc += grp->IOsegmentOWKC[seg] * 2;
+         /* inputs of the segment read by LRD are already counted */
+         grp->IOsegmentwkc[seg] += (uint16)(grp->IOsegmentOWKC[seg] * 2);
+         grp->IOsegmentskip[seg] = FALSE;
+         valid_wkc = 1;
+      }
+   }
+
    /* if no frames has arrived */
    if (valid_wkc == 0)
    {
       return NEX_NOFRAME;
    }
+   /* latch segment workcounters if one or more segments are short */
+   for (seg = 0; seg < grp->nsegments; seg++)
+   {
+      if (grp->IOsegmentwkc[seg] < nexx_main_segmentwkc(grp, seg, phase))
+      {
+         /* latch as full cycle, the phase not transmitted counts as good */
+         for (seg = 0; seg < grp->nsegments; seg++)
+         {
+            grp->IOsegmentfault[seg] = (uint16)(grp->IOsegmentwkc[seg] +
+               nexx_main_segmentwkc(grp, seg, NEX_PD_ALL) - nexx_main_segmentwkc(grp, seg, phase));
+         }
+         grp->wkcfault = TRUE;
+         break;
+      }
+   }
+   /* routed outputs are ready for the next send */
+   if (grp->route && (phase & NEX_PD_INPUTS))
+   {
+      nexx_route_run(grp->route);
+   }
+   if (grp->cond && (phase & NEX_PD_INPUTS))
+   {
+      nexx_cond_run(grp->cond);
+   }
+   if (grp->ovs && (phase & NEX_PD_INPUTS))
+   {
+      nexx_ovs_run(grp->ovs);
+   }
+   if (grp->rec && (phase & NEX_PD_INPUTS))
+   {
+      nexx_rec_capture(grp->rec);
+   }
+   return wkc;
+}
+
+/** Receive processdata from slaves.
+ * Second part from nex_send_processdata().
+ * Received datagrams are recombined with the processdata with help from the stack.
+ * If a datagram contains input processdata it copies it to the processdata structure.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  timeout        = Timeout in us.
+ * @return Work counter.
+ */
+int nexx_receive_processdata_group(nexx_contextt *context, uint8 group, int timeout)
+{
+   nex_groupt *grp = &(context->grouplist[group]);
+   int wkc;
+
+   /* the mailbox engine is held like in send processdata */
+   osal_atomic_add(&(grp->mbxqbusy), 1);
+   osal_atomic_fence();
+   wkc = nexx_main_receive_frames(context, group, timeout);
+   osal_atomic_add(&(grp->mbxqbusy), (uint32)-1);
+
+   return wkc;
+}
+
+/** Processdata cycle in two phases for minimal IO latency.
+ * The inputs are read with LRD at the start of the cycle, the compute function
+ * calculates the outputs from these inputs and the outputs are written with
+ * LWR just before the next SYNC0 of the group. The outputs computed from the
+ * inputs of a cycle are applied at the next SYNC0 instead of one cycle later.
+ * The DC datagram travels with the inputs, the send point is derived from
+ * DCtime and the SYNC0 cycle and shift of the reference slave as set by
+ * nexx_dcsync0 or nexx_dcsync01. The group has to be mapped without overlap.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[in]  compute        = function calculating the outputs, NULL for none
+ * @param[in]  arg            = argument of compute function
+ * @param[in]  leadtime       = outputs are sent this many ns before SYNC0,
+ * 0 sends them directly after compute
+ * @param[in]  timeout        = receive timeout per phase in us
+ * @return Work counter of both phases, NEX_NOFRAME if no frame arrived,
+ * NEX_ERROR if the group is mapped with overlap.
+ */
+int nexx_twophase_processdata_group(nexx_contextt *context, uint8 group, void (*compute)(void *arg), void *arg, int32 leadtime, int timeout)
+{
+   nex_groupt *grp;
+   nex_slavet *dcslave;
+   nex_timet tstart, tnow, tdiff;
+   int64 sendpoint, elapsed;
+   int wkc, wkc2;
+
+   grp = &(context->grouplist[group]);
+   if (grp->overlap)
+   {
+      /* the LRD inputs would overwrite the outputs in the overlapping IOmap */
+      return NEX_ERROR;
+   }
+   tstart = osal_current_time();
+   nexx_send_inputs_processdata_group(context, group);
+   wkc = nexx_receive_processdata_group(context, group, timeout);
+   if (compute)
+   {
+      compute(arg);
+   }
+   dcslave = &(context->slavelist[grp->DCnext]);
+   if ((leadtime > 0) && grp->hasdc && (wkc > NEX_NOFRAME) && (dcslave->DCcycle > 0))
+   {
+      /* SYNC0 is at DCshift modulo DCcycle in system time, DCtime was sampled
+         when the input frame passed the reference slave */
+      sendpoint = dcslave->DCcycle - ((*(context->DCtime) - dcslave->DCshift) % dcslave->DCcycle);
+      sendpoint -= leadtime;
+      tnow = osal_current_time();
+      osal_time_diff(&tstart, &tnow, &tdiff);
+      elapsed = ((int64)tdiff.sec * 1000000000) + ((int64)tdiff.usec * 1000);
+      if ((sendpoint - elapsed) > ((int64)NEX_TWOPHASE_SPIN * 1000))
+      {
+         osal_usleep((uint32)((sendpoint - elapsed) / 1000) - NEX_TWOPHASE_SPIN);
+      }
+      while (elapsed < sendpoint)
+      {
+         tnow = osal_current_time();
+         osal_time_diff(&tstart, &tnow, &tdiff);
+         elapsed = ((int64)tdiff.sec * 1000000000) + ((int64)tdiff.usec * 1000);
+      }
+   }
+   nexx_send_outputs_processdata_group(context, group);
+   wkc2 = nexx_receive_processdata_group(context, group, timeout);
+   if (wkc2 > NEX_NOFRAME)
+   {
+      wkc = (wkc > NEX_NOFRAME) ? (wkc + wkc2) : wkc2;
+   }
+
    return wkc;
 }
 
+/** List the slaves that can cause a low workcounter.
+ * The receive function keeps the workcounter of every IO segment. When one or
+ * more segments return less than expected the segment workcounters are latched.
+ * Only the slaves mapped in the short segments are returned, so the supervisor
+ * can check these instead of the whole network. Reading the list clears the latch.
+ * @param[in]  context        = context struct
+ * @param[in]  group          = group number
+ * @param[out] list           = slave numbers of suspect slaves
+ * @param[in]  maxlist        = size of list
+ * @return number of suspect slaves, 0 if no segment was short since last call
+ */
+int nexx_suspectslaves(nexx_contextt *context, uint8 group, uint16 *list, int maxlist)
+{
+   nex_groupt *grp;
+   uint16 slave, seg;
+   boolean suspect;
+   int cnt = 0;
+
+   grp = &(context->grouplist[group]);
+   if (!grp->wkcfault)
+   {
+      return 0;
+   }
+   grp->wkcfault = FALSE;
+   for (slave = 1; (slave <= *(context->slavecount)) && (cnt < maxlist); slave++)
+   {
+      if ((!group || (group == context->slavelist[slave].group)) && context->slavelist[slave].expectedWKC)
+      {
+         suspect = FALSE;
+         seg = context->slavelist[slave].Osegment;
+         if (context->slavelist[slave].Obits && (seg < grp->nsegments) &&
+             (grp->IOsegmentfault[seg] < ((grp->IOsegmentOWKC[seg] * 2) + grp->IOsegmentIWKC[seg])))
+         {
+            suspect = TRUE;
+         }
+         seg = context->slavelist[slave].Isegment;
+         if (context->slavelist[slave].Ibits && (seg < grp->nsegments) &&
+             (grp->IOsegmentfault[seg] < ((grp->IOsegmentOWKC[seg] * 2) + grp->IOsegmentIWKC[seg])))
+         {
+            suspect = TRUE;
+         }
+         if (suspect)
+         {
+            list[cnt++] = slave;
+         }
+      }
+   }
+
+   return cnt;
+}
 
 int nexx_send_processdata(nexx_contextt *context)
 {
@@ -2372,4 +3073,24 @@ int nex_receive_processdata(int timeout)
 {
    return nex_receive_processdata_group(0, timeout);
 }
+
+int nex_send_inputs_processdata_group(uint8 group)
+{
+   return nexx_send_inputs_processdata_group(&nexx_context, group);
+}
+
+int nex_send_outputs_processdata_group(uint8 group)
+{
+   return nexx_send_outputs_processdata_group(&nexx_context, group);
+}
+
+int nex_twophase_processdata_group(uint8 group, void (*compute)(void *arg), void *arg, int32 leadtime, int timeout)
+{
+   return nexx_twophase_processdata_group(&nexx_context, group, compute, arg, leadtime, timeout);
+}
+
+int nex_suspectslaves(uint8 group, uint16 *list, int maxlist)
+{
+   return nexx_suspectslaves(&nexx_context, group, list, maxlist);
+}
 #endif
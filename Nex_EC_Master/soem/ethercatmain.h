@@ -25,8 +25,14 @@ extern "C"
 #define NEX_MAXSLAVE       200
 /** max. number of groups */
 #define NEX_MAXGROUP       2
-/** max. number of IO segments per group */
-#define NEX_MAXIOSEGMENTS  64
+/** max. number of IO segments per group, every segment is one frame and
+ * needs its own frame buffer */
+#ifndef NEX_MAXIOSEGMENTS
+#define NEX_MAXIOSEGMENTS  NEX_MAXBUF
+#endif
+#if NEX_MAXIOSEGMENTS > NEX_MAXBUF
+#error "NEX_MAXIOSEGMENTS must not exceed NEX_MAXBUF, every IO segment is one frame in flight"
+#endif
 /** max. mailbox size */
 #define NEX_MAXMBX         1486
 /** max. eeprom PDO entries */
@@ -37,8 +43,14 @@ extern "C"
 #define NEX_MAXFMMU        4
 /** max. Adapter */
 #define NEX_MAXLEN_ADAPTERNAME    128
+/** IOalign value to align slave processdata to its natural size, max. 8 bytes */
+#define NEX_IOALIGN_NATURAL    0xffff
 /** define maximum number of concurrent threads in mapping */
 #define NEX_MAX_MAPT           1
+/** two-phase cycle, sleep until this many us before the output send point, then spin */
+#ifndef NEX_TWOPHASE_SPIN
+#define NEX_TWOPHASE_SPIN      200
+#endif
 
 typedef struct nex_adapter nex_adaptert;
 struct nex_adapter
@@ -65,6 +77,21 @@ typedef struct PACKED nex_fmmu
 }  nex_fmmut;
 PACKED_END
 
+/** ESC register mapped into the processdata with a spare FMMU */
+typedef struct nex_regmap
+{
+   /** slave number */
+   uint16           slave;
+   /** ESC register address, f.e. ECT_REG_DCSYSTIME */
+   uint16           ADO;
+   /** number of bytes */
+   uint16           length;
+   /** copy of the register in IOmap, set by mapping, NULL if not mapped */
+   uint8            *data;
+   /** internal, FMMU used, NEX_MAXFMMU if not mapped */
+   uint8            FMMUc;
+} nex_regmapt;
+
 /** record for sync manager */
 PACKED_BEGIN
 typedef struct PACKED nex_sm
@@ -197,6 +224,8 @@ typedef struct nex_slave
    int32            DCcycle;
    /** DC shift from clock modulus boundary */
    int32            DCshift;
+   /** SYNC1 delay after SYNC0 in ns, 0 = with SYNC0 or SYNC1 not used */
+   int32            DCcycle1;
    /** DC sync activation, 0=off, 1=on */
    uint8            DCactive;
    /** link to config table */
@@ -223,6 +252,20 @@ typedef struct nex_slave
    uint8            group;
    /** first unused FMMU */
    uint8            FMMUunused;
+   /** IO segment holding the outputs of this slave */
+   uint16           Osegment;
+   /** IO segment holding the inputs of this slave */
+   uint16           Isegment;
+   /** expected workcounter contribution, outputs count 2 times as with LRW */
+   uint16           expectedWKC;
+   /** SM1 status byte in IOmap holding the mailbox full bit, NULL if not mapped */
+   uint8            *mbxstatus;
+   /** bit of the mailbox full flag in mbxstatus */
+   uint8            mbxstatusbit;
+   /** group whose processdata refreshes mbxstatus */
+   uint8            mbxstatusgroup;
+   /** internal, FMMU used for the mailbox full bit, NEX_MAXFMMU if not mapped */
+   uint8            mbxstatusFMMU;
    /** Boolean for tracking whether the slave is (not) responding, not used/set by the SOEM library */
    boolean          islost;
    /** registered configuration function PO->SO */
@@ -264,8 +307,67 @@ typedef struct nex_group
    uint16           inputsWKC;
    /** check slave states */
    boolean          docheckstate;
+   /** byte alignment of slave processdata in IOmap, 0 = packed,
+    * NEX_IOALIGN_NATURAL or f.e. 64 for cache lines. Set before mapping. */
+   uint16           IOalign;
+   /** read AL status and AL event of all slaves in first processdata frame,
+    * set before mapping so the first IO segment leaves room for it */
+   boolean          ALcheck;
+   /** mapped with Outputs/Inputs overlapping, set by the mapping. The inputs
+    * replace the outputs in the frame, two-phase processdata refuses the group */
+   boolean          overlap;
+   /** AL status of all slaves ORed together, from last processdata cycle.
+    * Only a single state bit is a common state, BOOT equals INIT | PRE_OP. */
+   uint16           ALstatus;
+   /** number of slaves that returned the AL status */
+   uint16           ALstatuswkc;
+   /** AL event request of all slaves ORed together */
+   uint32           ALevent;
    /** IO segmentation list. Datagrams must not break SM in two. */
    uint32           IOsegment[NEX_MAXIOSEGMENTS];
+   /** Expected workcounter outputs per IO segment */
+   uint16           IOsegmentOWKC[NEX_MAXIOSEGMENTS];
+   /** Expected workcounter inputs per IO segment */
+   uint16           IOsegmentIWKC[NEX_MAXIOSEGMENTS];
+   /** Received workcounter per IO segment of last cycle, outputs count 2 times */
+   uint16           IOsegmentwkc[NEX_MAXIOSEGMENTS];
+   /** set by receive when one or more IO segments returned a low workcounter */
+   boolean          wkcfault;
+   /** IO segment workcounters latched at the last cycle with wkcfault */
+   uint16           IOsegmentfault[NEX_MAXIOSEGMENTS];
+   /** change-driven outputs, max. time between transmissions of unchanged
+    * outputs in us, 0 = outputs are sent every cycle */
+   uint32           Owatchdog;
+   /** change-driven outputs, copy of the outputs as last transmitted */
+   uint8            *Oshadow;
+   /** change-driven outputs, forced transmission of all outputs when expired */
+   osal_timert      Orefresh;
+   /** IO segments skipped by the last send, receive counts them as good */
+   boolean          IOsegmentskip[NEX_MAXIOSEGMENTS];
+   /** outputs of the IO segment came back with the full workcounter when they
+    * were last transmitted, only then they may be skipped */
+   boolean          IOsegmentOgood[NEX_MAXIOSEGMENTS];
+   /** processdata routing run by receive after the inputs are in, NULL = none */
+   struct nex_route *route;
+   /** ESC registers mapped after the inputs, set before mapping */
+   nex_regmapt      *regmap;
+   /** number of entries in regmap */
+   uint16           nregmap;
+   /** signal conditioning run by receive after the inputs are in, NULL = none */
+   struct nex_cond  *cond;
+   /** oversampling demultiplexer run by receive after the inputs are in, NULL = none */
+   struct nex_ovs   *ovs;
+   /** processdata recorder, captures a row in receive after the inputs are in, NULL = none */
+   struct nex_rec   *rec;
+   /** asynchronous mailbox engine carried by the processdata frames, NULL = none */
+   struct nex_mbxq  *mbxq;
+   /** send and receive processdata in progress, nexx_mbxq_close() waits for 0 */
+   volatile uint32  mbxqbusy;
+   /** map the SM1 mailbox full bit of every mailbox slave after the inputs,
+    * set before mapping, one LRD shows which slaves have a response waiting */
+   boolean          mbxstatus;
+   /** processdata cycles received, the mapped mailbox full bits are fresh while it counts */
+   volatile uint32  mbxstatuscnt;
 } nex_groupt;
 
 /** SII FMMU structure */
@@ -307,6 +409,24 @@ typedef struct nex_eepromPDO
 /** mailbox buffer array */
 typedef uint8 nex_mbxbuft[NEX_MAXMBX + 1];
 
+/** max. mailbox buffers in the pool of a context, at most 32 */
+#ifndef NEX_MBXPOOLSIZE
+#define NEX_MBXPOOLSIZE    16
+#endif
+#if NEX_MBXPOOLSIZE > 32
+#error "NEX_MBXPOOLSIZE must fit in the 32 bit used mask of the pool"
+#endif
+/** bytes of a response buffer cleared before a read, mailbox and protocol header */
+#define NEX_MBXHEADCLEAR   16
+
+/** mailbox buffers shared by the mailbox services of a context */
+typedef struct nex_mbxpool
+{
+   /** one bit per buffer in use */
+   volatile uint32  used;
+   nex_mbxbuft      buf[NEX_MBXPOOLSIZE];
+} nex_mbxpoolt;
+
 /** standard ethercat mailbox header */
 PACKED_BEGIN
 typedef struct PACKED nex_mbxheader
@@ -328,6 +448,13 @@ typedef struct PACKED nex_alstatus
 } nex_alstatust;
 PACKED_END
 
+/** processdata phase, inputs only (LRD) */
+#define NEX_PD_INPUTS      0x01
+/** processdata phase, outputs only (LWR) */
+#define NEX_PD_OUTPUTS     0x02
+/** processdata phase, inputs and outputs */
+#define NEX_PD_ALL         (NEX_PD_INPUTS | NEX_PD_OUTPUTS)
+
 /** stack structure to store segmented LRD/LWR/LRW constructs */
 typedef struct nex_idxstack
 {
@@ -336,6 +463,9 @@ typedef struct nex_idxstack
    uint8   idx[NEX_MAXBUF];
    void    *data[NEX_MAXBUF];
    uint16  length[NEX_MAXBUF];
+   uint16  segment[NEX_MAXBUF];
+   uint8   phase;
+   boolean first;
 } nex_idxstackT;
 
 /** ringbuf for error storage */
@@ -421,6 +551,12 @@ typedef struct nexx_context
    nex_eepromFMMUt *eepFMMU;
    /** registered FoE hook */
    int            (*FOEhook)(uint16 slave, int packetnumber, int datasize);
+   /** internal, position of AL status datagram in process data packet, 0 = not sent */
+   uint16         ALtO;
+   /** internal, position of AL event datagram in process data packet */
+   uint16         ALeO;
+   /** mailbox buffer pool, NULL = buffers from the heap */
+   nex_mbxpoolt    *mbxpool;
 } nexx_contextt;
 
 #ifdef NEX_VER1
@@ -472,12 +608,19 @@ int nex_receive_processdata_group(uint8 group, int timeout);
 int nex_send_processdata(void);
 int nex_send_overlap_processdata(void);
 int nex_receive_processdata(int timeout);
+int nex_send_inputs_processdata_group(uint8 group);
+int nex_send_outputs_processdata_group(uint8 group);
+int nex_twophase_processdata_group(uint8 group, void (*compute)(void *arg), void *arg, int32 leadtime, int timeout);
+int nex_suspectslaves(uint8 group, uint16 *list, int maxlist);
 #endif
 
 nex_adaptert * nex_find_adapters(void);
 void nex_free_adapters(nex_adaptert * adapter);
 uint8 nex_nextmbxcnt(uint8 cnt);
 void nex_clearmbx(nex_mbxbuft *Mbx);
+nex_mbxbuft *nexx_mbxget(nexx_contextt *context);
+void nexx_mbxput(nexx_contextt *context, nex_mbxbuft *mbx);
+void nexx_mbxclear(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, boolean request);
 void nexx_pusherror(nexx_contextt *context, const nex_errort *Ec);
 boolean nexx_poperror(nexx_contextt *context, nex_errort *Ec);
 boolean nexx_iserror(nexx_contextt *context);
@@ -498,6 +641,7 @@ uint16 nexx_statecheck(nexx_contextt *context, uint16 slave, uint16 reqstate, in
 int nexx_mbxempty(nexx_contextt *context, uint16 slave, int timeout);
 int nexx_mbxsend(nexx_contextt *context, uint16 slave,nex_mbxbuft *mbx, int timeout);
 int nexx_mbxreceive(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx, int timeout);
+int nexx_mbxcheck(nexx_contextt *context, uint16 slave, nex_mbxbuft *mbx);
 void nexx_esidump(nexx_contextt *context, uint16 slave, uint8 *esibuf);
 uint32 nexx_readeeprom(nexx_contextt *context, uint16 slave, uint16 eeproma, int timeout);
 int nexx_writeeeprom(nexx_contextt *context, uint16 slave, uint16 eeproma, uint16 data, int timeout);
@@ -509,11 +653,16 @@ uint64 nexx_readeepromFP(nexx_contextt *context, uint16 configadr, uint16 eeprom
 int nexx_writeeepromFP(nexx_contextt *context, uint16 configadr, uint16 eeproma, uint16 data, int timeout);
 void nexx_readeeprom1(nexx_contextt *context, uint16 slave, uint16 eeproma);
 uint32 nexx_readeeprom2(nexx_contextt *context, uint16 slave, int timeout);
+int nexx_send_processdata_group(nexx_contextt *context, uint8 group);
 int nexx_send_overlap_processdata_group(nexx_contextt *context, uint8 group);
 int nexx_receive_processdata_group(nexx_contextt *context, uint8 group, int timeout);
 int nexx_send_processdata(nexx_contextt *context);
 int nexx_send_overlap_processdata(nexx_contextt *context);
 int nexx_receive_processdata(nexx_contextt *context, int timeout);
+int nexx_send_inputs_processdata_group(nexx_contextt *context, uint8 group);
+int nexx_send_outputs_processdata_group(nexx_contextt *context, uint8 group);
+int nexx_twophase_processdata_group(nexx_contextt *context, uint8 group, void (*compute)(void *arg), void *arg, int32 leadtime, int timeout);
+int nexx_suspectslaves(nexx_contextt *context, uint8 group, uint16 *list, int maxlist);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,591 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Asynchronous mailbox engine.
+ *
+ * Applications submit mailbox requests from any thread and poll the state
+ * of the request or get a callback. The mailbox traffic is carried by the
+ * processdata cycle of one group: per cycle every slave with an active
+ * request gets one datagram, a write of the request to the write mailbox, a
+ * read of the SM1 status or a read of the read mailbox. With the mailbox
+ * full bits mapped in the group (nex_groupt.mbxstatus) the status reads are
+ * left out and only slaves with a response waiting are read. The datagrams are
+ * added to the first processdata frame after the DC and AL datagrams as far
+ * as they fit, the rest goes in one extra frame of the same cycle. Only the
+ * processdata thread touches the socket, and mailbox traffic of many slaves
+ * progresses in parallel without polling delays.
+ *
+ * A slave has one active request at a time, further requests to the same
+ * slave are queued. Do not mix blocking mailbox calls and this engine on
+ * the same slave.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatmbxq.h"
+
+/** size limit of a frame, as used for the first processdata frame */
+#define NEX_MBXQ_FRAMELIMIT   (ETH_HEADERSIZE + NEX_HEADERSIZE + NEX_MAXLRWDATA + NEX_WKCSIZE)
+/** SM1 status, mailbox full */
+#define NEX_MBXQ_SMFULL       0x08
+
+/** Initialise the mailbox engine. The processdata cycle of group carries the
+ * mailbox traffic of all slaves.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] mbxq           = mbxq struct
+ * @param[in]  group          = group number
+ * @return 1
+ */
+int nexx_mbxq_init(nexx_contextt *context, nex_mbxqt *mbxq, uint8 group)
+{
+   memset(mbxq, 0x00, sizeof(nex_mbxqt));
+   mbxq->context = context;
+   mbxq->group = group;
+   mbxq->rr = 1;
+   context->grouplist[group].mbxq = mbxq;
+
+   return 1;
+}
+
+/** Initialise an engine that is not carried by the processdata of a group.
+ * The requests are advanced by nexx_mbxq_run().
+ *
+ * @param[in]  context        = context struct
+ * @param[out] mbxq           = mbxq struct
+ * @return 1
+ */
+int nexx_mbxq_open(nexx_contextt *context, nex_mbxqt *mbxq)
+{
+   memset(mbxq, 0x00, sizeof(nex_mbxqt));
+   mbxq->context = context;
+   mbxq->rr = 1;
+
+   return 1;
+}
+
+/** Clear a request before it is filled. The fields and the mailbox headers
+ * are cleared, the request mailbox for the write mailbox length of the
+ * slave. The rest of the mailbox buffers is left as it is.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @param[out] req            = request
+ * @param[in]  slave          = Slave number
+ */
+void nexx_mbxq_clear(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 slave)
+{
+   memset(req, 0x00, offsetof(nex_mbxreqt, out));
+   /* an invalid slave is refused by the submit */
+   nexx_mbxclear(mbxq->context, slave, &(req->out),
+                 (boolean)(slave && (slave <= *(mbxq->context->slavecount)) && (slave < NEX_MAXSLAVE)));
+   nexx_mbxclear(mbxq->context, slave, &(req->in), FALSE);
+   memset(&(req->response), 0x00, sizeof(nex_mbxreqt) - offsetof(nex_mbxreqt, response));
+}
+
+/** Submit a request. Set slave, out, response, timeout, parse and callback
+ * of req first. Thread safe, the request is started by the next cycle.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @param[in]  req            = request, must stay valid until done or error
+ * @return 1 if submitted, 0 if the slave has no mailbox
+ */
+int nexx_mbxq_submit(nex_mbxqt *mbxq, nex_mbxreqt *req)
+{
+   nex_slavet *sl;
+
+   if (!req->slave || (req->slave > *(mbxq->context->slavecount)) || (req->slave >= NEX_MAXSLAVE))
+   {
+      return 0;
+   }
+   sl = &(mbxq->context->slavelist[req->slave]);
+   if (!sl->mbx_l || (sl->mbx_l > NEX_MAXMBX) || (req->response && (!sl->mbx_rl || (sl->mbx_rl > NEX_MAXMBX))))
+   {
+      return 0;
+   }
+   req->abortcode = 0;
+   osal_atomic_store(&(req->state), NEX_MBXREQ_QUEUED);
+   /* lock free push, the engine takes the whole list at once */
+   do
+   {
+      req->next = (nex_mbxreqt *)mbxq->submitted;
+   } while (!osal_atomic_casptr(&(mbxq->submitted), req->next, req));
+
+   return 1;
+}
+
+/** Finish the active request of a slave. */
+static void nexx_mbxq_finish(nex_mbxqt *mbxq, nex_mbxreqt *req, uint32 state)
+{
+   mbxq->active[req->slave] = NULL;
+   mbxq->nactive--;
+   osal_atomic_store(&(req->state), state);
+   if (req->callback)
+   {
+      req->callback(req, req->arg);
+   }
+}
+
+/** Move the submitted requests to the queues of their slaves. */
+static void nexx_mbxq_take(nex_mbxqt *mbxq)
+{
+   nex_mbxreqt *list, *req, *fifo, **pp;
+
+   /* take the submitted requests, reverse to submit order */
+   list = (nex_mbxreqt *)osal_atomic_exchangeptr(&(mbxq->submitted), NULL);
+   fifo = NULL;
+   while (list)
+   {
+      req = list;
+      list = list->next;
+      req->next = fifo;
+      fifo = req;
+   }
+   while (fifo)
+   {
+      req = fifo;
+      fifo = fifo->next;
+      req->next = NULL;
+      pp = &(mbxq->queue[req->slave]);
+      while (*pp)
+      {
+         pp = &((*pp)->next);
+      }
+      *pp = req;
+   }
+}
+
+/** Take the submitted requests, start the next request of idle slaves, time
+ * out requests and plan the datagrams of this cycle. Called by send
+ * processdata of the group.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @return number of datagrams planned
+ */
+int nexx_mbxq_prepare(nex_mbxqt *mbxq)
+{
+   nexx_contextt *context = mbxq->context;
+   nex_mbxreqt *req;
+   nex_mbxheadert *mbxh;
+   nex_slavet *sl;
+   nex_mbxqdgramt *dg;
+   uint16 slave, k, n;
+   uint8 cnt;
+
+   mbxq->ndgram = 0;
+   mbxq->nplaced = 0;
+   mbxq->ready = FALSE;
+   nexx_mbxq_take(mbxq);
+   n = (uint16)*(context->slavecount);
+   if (n >= NEX_MAXSLAVE)
+   {
+      n = NEX_MAXSLAVE - 1;
+   }
+   for (slave = 1; slave <= n; slave++)
+   {
+      req = mbxq->active[slave];
+      if (req && osal_timer_is_expired(&(req->timer)))
+      {
+         nexx_mbxq_finish(mbxq, req, NEX_MBXREQ_ERROR);
+      }
+      if (!mbxq->active[slave] && mbxq->queue[slave])
+      {
+         req = mbxq->queue[slave];
+         mbxq->queue[slave] = req->next;
+         req->next = NULL;
+         sl = &(context->slavelist[slave]);
+         /* mailbox counter is the session handle */
+         cnt = nex_nextmbxcnt(sl->mbx_cnt);
+         sl->mbx_cnt = cnt;
+         mbxh = (nex_mbxheadert *)&(req->out);
+         mbxh->mbxtype = (uint8)((mbxh->mbxtype & 0x0f) | (cnt << 4));
+         osal_timer_start(&(req->timer), req->timeout);
+         osal_atomic_store(&(req->state), NEX_MBXREQ_WRITE);
+         mbxq->active[slave] = req;
+         mbxq->nactive++;
+      }
+   }
+   if (!mbxq->nactive || !n)
+   {
+      return 0;
+   }
+   /* one datagram per active slave, round robin if there are too many */
+   for (k = 0; (k < n) && (mbxq->ndgram < NEX_MBXQ_MAXDGRAM); k++)
+   {
+      slave = (uint16)(((mbxq->rr - 1 + k) % n) + 1);
+      req = mbxq->active[slave];
+      if (!req)
+      {
+         continue;
+      }
+      sl = &(context->slavelist[slave]);
+      if ((req->state == NEX_MBXREQ_STATUS) && sl->mbxstatus && (sl->mbxstatusgroup == mbxq->group) &&
+          (context->grouplist[mbxq->group].mbxq == mbxq))
+      {
+         /* mailbox full bit of the last cycle, read only slaves with a response waiting */
+         if (!((sl->mbxstatus[0] >> sl->mbxstatusbit) & 0x01))
+         {
+            continue;
+         }
+         osal_atomic_store(&(req->state), NEX_MBXREQ_READ);
+      }
+      dg = &(mbxq->dgram[mbxq->ndgram++]);
+      dg->req = req;
+      dg->offset = 0;
+      switch (req->state)
+      {
+         case NEX_MBXREQ_WRITE:
+            dg->cmd = NEX_CMD_FPWR;
+            dg->length = sl->mbx_l;
+            break;
+         case NEX_MBXREQ_STATUS:
+            dg->cmd = NEX_CMD_FPRD;
+            dg->length = sizeof(uint8);
+            break;
+         default:
+            dg->cmd = NEX_CMD_FPRD;
+            dg->length = sl->mbx_rl;
+            break;
+      }
+   }
+   mbxq->rr = (uint16)((mbxq->rr % n) + 1);
+   mbxq->ready = (boolean)(mbxq->ndgram > 0);
+
+   return mbxq->ndgram;
+}
+
+/** Register address of a planned datagram. */
+static uint16 nexx_mbxq_ado(nexx_contextt *context, const nex_mbxqdgramt *dg)
+{
+   nex_slavet *sl = &(context->slavelist[dg->req->slave]);
+
+   if (dg->cmd == NEX_CMD_FPWR)
+   {
+      return sl->mbx_wo;
+   }
+   if (dg->req->state == NEX_MBXREQ_STATUS)
+   {
+      return ECT_REG_SM1STAT;
+   }
+   return sl->mbx_ro;
+}
+
+/** Add the planned datagrams that fit to a frame with existing datagrams.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @param[in]  idx            = frame index
+ * @return number of datagrams added
+ */
+int nexx_mbxq_fill(nex_mbxqt *mbxq, uint8 idx)
+{
+   nexx_contextt *context = mbxq->context;
+   nex_mbxqdgramt *dg;
+   uint8 *frame;
+   uint16 pos, dlength;
+   int i, added = 0, last = -1;
+
+   if (!mbxq->ready || (mbxq->nplaced >= mbxq->ndgram))
+   {
+      return 0;
+   }
+   frame = (uint8 *)&(context->port->txbuf[idx]);
+   /* the last datagram in the frame gets the datagram follows flag */
+   pos = ETH_HEADERSIZE + NEX_ELENGTHSIZE;
+   for (;;)
+   {
+      memcpy(&dlength, &frame[pos + 6], sizeof(dlength));
+      dlength = etohs(dlength);
+      if (!(dlength & NEX_DATAGRAMFOLLOWS))
+      {
+         break;
+      }
+      pos += NEX_HEADERSIZE - NEX_ELENGTHSIZE + (dlength & 0x07ff) + NEX_WKCSIZE;
+   }
+   for (i = 0; i < mbxq->ndgram; i++)
+   {
+      dg = &(mbxq->dgram[i]);
+      if (dg->offset || ((context->port->txbuflength[idx] + NEX_HEADERSIZE + dg->length) > NEX_MBXQ_FRAMELIMIT))
+      {
+         continue;
+      }
+      if (last < 0)
+      {
+         dlength = htoes((uint16)(dlength | NEX_DATAGRAMFOLLOWS));
+         memcpy(&frame[pos + 6], &dlength, sizeof(dlength));
+      }
+      dg->idx = idx;
+      dg->offset = (uint16)nexx_adddatagram(context->port, frame, dg->cmd, idx, TRUE,
+         context->slavelist[dg->req->slave].configadr, nexx_mbxq_ado(context, dg), dg->length, &(dg->req->out));
+      last = i;
+      added++;
+   }
+   if (last >= 0)
+   {
+      /* clear the follows flag of the last added datagram */
+      pos = (uint16)(mbxq->dgram[last].offset + ETH_HEADERSIZE - 4);
+      memcpy(&dlength, &frame[pos], sizeof(dlength));
+      dlength = htoes((uint16)(etohs(dlength) & ~NEX_DATAGRAMFOLLOWS));
+      memcpy(&frame[pos], &dlength, sizeof(dlength));
+   }
+   mbxq->nplaced += added;
+
+   return added;
+}
+
+/** Build a frame for the planned datagrams that did not fit in the
+ * processdata frames. The caller sends the frame and pushes its index.
+ * Send processdata uses one extra frame per cycle, nexx_mbxq_run() calls
+ * it until all datagrams are placed.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @return frame index, -1 if no datagrams are left
+ */
+int nexx_mbxq_frame(nex_mbxqt *mbxq)
+{
+   nexx_contextt *context = mbxq->context;
+   nex_mbxqdgramt *dg;
+   uint8 idx;
+   int i;
+
+   if (!mbxq->ready)
+   {
+      return -1;
+   }
+   mbxq->ready = FALSE;
+   for (i = 0; i < mbxq->ndgram; i++)
+   {
+      if (!mbxq->dgram[i].offset)
+      {
+         break;
+      }
+   }
+   if (i >= mbxq->ndgram)
+   {
+      return -1;
+   }
+   dg = &(mbxq->dgram[i]);
+   idx = nexx_getindex(context->port);
+   nexx_setupdatagram(context->port, &(context->port->txbuf[idx]), dg->cmd, idx,
+      context->slavelist[dg->req->slave].configadr, nexx_mbxq_ado(context, dg), dg->length, &(dg->req->out));
+   dg->idx = idx;
+   dg->offset = NEX_HEADERSIZE;
+   mbxq->nplaced++;
+   mbxq->ready = TRUE;
+   nexx_mbxq_fill(mbxq, idx);
+   mbxq->ready = (boolean)(mbxq->nplaced < mbxq->ndgram);
+
+   return idx;
+}
+
+/** Evaluate the mailbox datagrams of a received frame. Called by receive
+ * processdata for every frame that came back.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @param[in]  idx            = frame index
+ */
+void nexx_mbxq_receive(nex_mbxqt *mbxq, uint8 idx)
+{
+   nexx_contextt *context = mbxq->context;
+   nex_mbxqdgramt *dg;
+   nex_mbxreqt *req;
+   uint8 *data;
+   uint16 wkc, offset;
+   int i, r;
+
+   for (i = 0; i < mbxq->ndgram; i++)
+   {
+      dg = &(mbxq->dgram[i]);
+      offset = dg->offset;
+      req = dg->req;
+      if (!req || !offset || (dg->idx != idx))
+      {
+         continue;
+      }
+      /* evaluated */
+      dg->req = NULL;
+      if (mbxq->active[req->slave] != req)
+      {
+         /* timed out meanwhile */
+         continue;
+      }
+      data = &(context->port->rxbuf[idx][offset]);
+      wkc = (uint16)(data[dg->length] | (data[dg->length + 1] << 8));
+      switch (req->state)
+      {
+         case NEX_MBXREQ_WRITE:
+            if (wkc == 1)
+            {
+               if (req->response)
+               {
+                  osal_atomic_store(&(req->state), NEX_MBXREQ_STATUS);
+               }
+               else
+               {
+                  nexx_mbxq_finish(mbxq, req, NEX_MBXREQ_DONE);
+               }
+            }
+            break;
+         case NEX_MBXREQ_STATUS:
+            if ((wkc == 1) && (data[0] & NEX_MBXQ_SMFULL))
+            {
+               osal_atomic_store(&(req->state), NEX_MBXREQ_READ);
+            }
+            break;
+         case NEX_MBXREQ_READ:
+            if (wkc != 1)
+            {
+               /* mailbox not read, check status again */
+               osal_atomic_store(&(req->state), NEX_MBXREQ_STATUS);
+               break;
+            }
+            memcpy(&(req->in), data, dg->length);
+            r = nexx_mbxcheck(context, req->slave, &(req->in));
+            if ((r > 0) && req->parse)
+            {
+               r = req->parse(context, req);
+            }
+            if (r > 0)
+            {
+               nexx_mbxq_finish(mbxq, req, NEX_MBXREQ_DONE);
+            }
+            else if (r < 0)
+            {
+               nexx_mbxq_finish(mbxq, req, NEX_MBXREQ_ERROR);
+            }
+            else
+            {
+               /* emergency or other response, wait for the next */
+               osal_atomic_store(&(req->state), NEX_MBXREQ_STATUS);
+            }
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+/** Disarm the mailbox datagrams of a frame that did not come back. Called
+ * by receive processdata for every frame lost, the index can be reused by a
+ * later frame of other content before the next nexx_mbxq_prepare(). The
+ * requests repeat their step in the next cycle.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @param[in]  idx            = frame index
+ */
+void nexx_mbxq_lost(nex_mbxqt *mbxq, uint8 idx)
+{
+   nex_mbxqdgramt *dg;
+   int i;
+
+   for (i = 0; i < mbxq->ndgram; i++)
+   {
+      dg = &(mbxq->dgram[i]);
+      if (dg->offset && (dg->idx == idx))
+      {
+         dg->req = NULL;
+      }
+   }
+}
+
+/** Advance the requests of an engine opened with nexx_mbxq_open() by one
+ * step. The datagrams of all slaves with an active request are packed in as
+ * few frames as possible, like nexx_FPRD_multi(), and the responses are
+ * evaluated. Call until it returns 0, f.e. during configuration without
+ * processdata.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ * @return number of requests active or queued
+ */
+int nexx_mbxq_run(nex_mbxqt *mbxq)
+{
+   nexx_portt *port = mbxq->context->port;
+   nex_mbxreqt *req;
+   uint16 slave;
+   int idx, n;
+
+   nexx_mbxq_prepare(mbxq);
+   while ((idx = nexx_mbxq_frame(mbxq)) >= 0)
+   {
+      if (nexx_srconfirm(port, idx, NEX_TIMEOUTRET) > NEX_NOFRAME)
+      {
+         nexx_mbxq_receive(mbxq, (uint8)idx);
+      }
+      else
+      {
+         nexx_mbxq_lost(mbxq, (uint8)idx);
+      }
+      nexx_setbufstat(port, idx, NEX_BUF_EMPTY);
+   }
+   n = mbxq->nactive + (mbxq->submitted ? 1 : 0);
+   for (slave = 1; slave < NEX_MAXSLAVE; slave++)
+   {
+      for (req = mbxq->queue[slave]; req; req = req->next)
+      {
+         n++;
+      }
+   }
+
+   return n;
+}
+
+/** Remove the engine from the group. Active and queued requests fail.
+ * The processdata thread may keep running, close waits until send or
+ * receive processdata in progress are done with the engine. Not to be
+ * called from a request callback.
+ *
+ * @param[in]  mbxq           = mbxq struct
+ */
+void nexx_mbxq_close(nex_mbxqt *mbxq)
+{
+   nex_groupt *grp;
+   nex_mbxreqt *req;
+   uint16 slave;
+
+   if (mbxq->context)
+   {
+      grp = &(mbxq->context->grouplist[mbxq->group]);
+      if (osal_atomic_casptr((void *volatile *)&(grp->mbxq), mbxq, NULL))
+      {
+         /* send or receive processdata that found the engine still use it */
+         while (osal_atomic_load(&(grp->mbxqbusy)))
+         {
+            osal_usleep(100);
+         }
+      }
+   }
+   nexx_mbxq_take(mbxq);
+   mbxq->ndgram = 0;
+   mbxq->ready = FALSE;
+   for (slave = 1; slave < NEX_MAXSLAVE; slave++)
+   {
+      if (mbxq->active[slave])
+      {
+         nexx_mbxq_finish(mbxq, mbxq->active[slave], NEX_MBXREQ_ERROR);
+      }
+      while (mbxq->queue[slave])
+      {
+         req = mbxq->queue[slave];
+         mbxq->queue[slave] = req->next;
+         osal_atomic_store(&(req->state), NEX_MBXREQ_ERROR);
+         if (req->callback)
+         {
+            req->callback(req, req->arg);
+         }
+      }
+   }
+}
+
+#ifdef NEX_VER1
+int nex_mbxq_init(nex_mbxqt *mbxq, uint8 group)
+{
+   return nexx_mbxq_init(&nexx_context, mbxq, group);
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatmbxq.c
+ */
+
+#ifndef _NEX_ECATMBXQ_H
+#define _NEX_ECATMBXQ_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. mailbox datagrams per processdata cycle */
+#ifndef NEX_MBXQ_MAXDGRAM
+#define NEX_MBXQ_MAXDGRAM  32
+#endif
+
+/** request state, not submitted or taken back */
+#define NEX_MBXREQ_IDLE    0
+/** request state, submitted, waiting for the slave mailbox */
+#define NEX_MBXREQ_QUEUED  1
+/** request state, writing the request to the slave */
+#define NEX_MBXREQ_WRITE   2
+/** request state, waiting for the read mailbox of the slave to fill */
+#define NEX_MBXREQ_STATUS  3
+/** request state, reading the response */
+#define NEX_MBXREQ_READ    4
+/** request state, completed, response in in */
+#define NEX_MBXREQ_DONE    5
+/** request state, failed, f.e. timeout, abort or mailbox error */
+#define NEX_MBXREQ_ERROR   6
+
+struct nex_mbxreq;
+
+/** check of a response by the protocol of the request
+ * @return 1 if done, 0 if the response is not for this request, -1 if failed */
+typedef int (*nex_mbxparset)(nexx_contextt *context, struct nex_mbxreq *req);
+
+/** one mailbox request, owned by the application until done or error */
+typedef struct nex_mbxreq
+{
+   /** slave number */
+   uint16           slave;
+   /** NEX_MBXREQ_xxx, poll for DONE or ERROR */
+   volatile uint32  state;
+   /** request mailbox, the counter is set when the request is started */
+   nex_mbxbuft      out;
+   /** response mailbox */
+   nex_mbxbuft      in;
+   /** FALSE if the request has no response */
+   boolean          response;
+   /** time from start to response in us */
+   int              timeout;
+   /** response check, NULL = any response except emergency */
+   nex_mbxparset    parse;
+   /** called by the processdata thread when done or failed, NULL = poll state */
+   void             (*callback)(struct nex_mbxreq *req, void *arg);
+   void             *arg;
+   /** protocol data, f.e. SDO index and data buffer */
+   uint16           index;
+   uint8            subindex;
+   void             *p;
+   /** buffer size on submit, data size when done */
+   int              size;
+   /** SDO abort code if failed by abort */
+   int32            abortcode;
+   /** internal */
+   osal_timert      timer;
+   struct nex_mbxreq *next;
+} nex_mbxreqt;
+
+/** one mailbox datagram in the frames of a cycle */
+typedef struct nex_mbxqdgram
+{
+   nex_mbxreqt      *req;
+   /** frame index */
+   uint8            idx;
+   /** datagram command */
+   uint8            cmd;
+   /** offset of data in rx frame */
+   uint16           offset;
+   uint16           length;
+} nex_mbxqdgramt;
+
+/** asynchronous mailbox engine, carried by the processdata frames of a group */
+typedef struct nex_mbxq
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group whose cycle carries the mailbox datagrams */
+   uint8            group;
+   /** internal, submitted nex_mbxreqt list, newest first, pushed and taken
+    * with atomic pointer operations */
+   void *volatile   submitted;
+   /** internal, active request and queue per slave */
+   nex_mbxreqt      *active[NEX_MAXSLAVE];
+   nex_mbxreqt      *queue[NEX_MAXSLAVE];
+   /** number of active requests */
+   int              nactive;
+   /** slave to serve first in the next cycle */
+   uint16           rr;
+   /** datagrams of the current cycle */
+   nex_mbxqdgramt   dgram[NEX_MBXQ_MAXDGRAM];
+   int              ndgram;
+   /** datagrams placed in frames */
+   int              nplaced;
+   /** TRUE while planned datagrams are not placed in a frame */
+   boolean          ready;
+} nex_mbxqt;
+
+#ifdef NEX_VER1
+int nex_mbxq_init(nex_mbxqt *mbxq, uint8 group);
+#endif
+
+int nexx_mbxq_init(nexx_contextt *context, nex_mbxqt *mbxq, uint8 group);
+int nexx_mbxq_open(nexx_contextt *context, nex_mbxqt *mbxq);
+void nexx_mbxq_clear(nex_mbxqt *mbxq, nex_mbxreqt *req, uint16 slave);
+int nexx_mbxq_submit(nex_mbxqt *mbxq, nex_mbxreqt *req);
+int nexx_mbxq_prepare(nex_mbxqt *mbxq);
+int nexx_mbxq_fill(nex_mbxqt *mbxq, uint8 idx);
+int nexx_mbxq_frame(nex_mbxqt *mbxq);
+int nexx_mbxq_run(nex_mbxqt *mbxq);
+void nexx_mbxq_receive(nex_mbxqt *mbxq, uint8 idx);
+void nexx_mbxq_lost(nex_mbxqt *mbxq, uint8 idx);
+void nexx_mbxq_close(nex_mbxqt *mbxq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATMBXQ_H */
@@ -0,0 +1,760 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Object dictionary cache.
+ *
+ * Reading an object dictionary over SDO Info costs a few mailbox round trips
+ * per object and entry. The cache keeps the dictionary per device type,
+ * keyed by vendor, product and revision, in one compact allocation with
+ * pooled names, and persists it to a file. Only devices not in the cache are
+ * read, each device type once, by up to NEX_ODC_MAXT threads in parallel.
+ *
+ * File format, all values little endian:
+ * - header: "NEXODC" 0 version(uint8), ndev(uint32).
+ * - per device: eep_man(uint32) eep_id(uint32) eep_rev(uint32) nobj(uint16)
+ *   0(uint16) nentry(uint32) namesize(uint32), the objects index(uint16)
+ *   datatype(uint16) objectcode(uint8) maxsub(uint8) nentry(uint16)
+ *   first(uint32) name(uint32), the entries subindex(uint8) valueinfo(uint8)
+ *   datatype(uint16) bitlength(uint16) access(uint16) name(uint32) and the
+ *   name pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatmbxq.h"
+#include "ethercatcoe.h"
+#include "ethercatodc.h"
+
+#define NEX_ODC_DEVSIZE    28
+#define NEX_ODC_OBJSIZE    16
+#define NEX_ODC_ENTRYSIZE  12
+
+/** worker reading the dictionary of one device type */
+typedef struct
+{
+   nexx_contextt    *context;
+   uint16           slave;
+   nex_odcdevt      *dev;
+   volatile int     running;
+} nex_odcscant;
+
+/** Allocate a device with its tables in one block. */
+static nex_odcdevt *nexx_odc_alloc(uint16 nobj, uint32 nentry, uint32 namesize)
+{
+   nex_odcdevt *dev;
+
+   dev = (nex_odcdevt *)osal_malloc(sizeof(nex_odcdevt) + nobj * sizeof(nex_odcobjt) +
+                                    nentry * sizeof(nex_odcentryt) + namesize);
+   if (dev)
+   {
+      memset(dev, 0x00, sizeof(nex_odcdevt));
+      dev->nobj = nobj;
+      dev->obj = (nex_odcobjt *)(dev + 1);
+      dev->nentry = nentry;
+      dev->entry = (nex_odcentryt *)(dev->obj + nobj);
+      dev->namesize = namesize;
+      dev->name = (char *)(dev->entry + nentry);
+   }
+   return dev;
+}
+
+/** Make room for n more bytes in a growing buffer.
+ * @return FALSE if out of memory */
+static boolean nexx_odc_reserve(uint8 **buf, uint32 *cap, uint32 used, uint32 n)
+{
+   uint8 *p;
+   uint32 size;
+
+   if ((used + n) <= *cap)
+   {
+      return TRUE;
+   }
+   size = *cap ? *cap : 4096;
+   while (size < (used + n))
+   {
+      size <<= 1;
+   }
+   p = (uint8 *)osal_malloc(size);
+   if (!p)
+   {
+      return FALSE;
+   }
+   if (*buf)
+   {
+      memcpy(p, *buf, used);
+      osal_free(*buf);
+   }
+   *buf = p;
+   *cap = size;
+   return TRUE;
+}
+
+/** Add a name to the pool of a scan, the empty name is offset 0.
+ * @return offset, 0 if empty or out of memory */
+static uint32 nexx_odc_addname(uint8 **pool, uint32 *cap, uint32 *used, const char *name)
+{
+   uint32 len, offset;
+
+   len = (uint32)strlen(name);
+   if (!len || !nexx_odc_reserve(pool, cap, *used, len + 1))
+   {
+      return 0;
+   }
+   offset = *used;
+   memcpy(*pool + offset, name, len + 1);
+   *used += len + 1;
+   return offset;
+}
+
+static int nexx_odc_cmpobj(const void *a, const void *b)
+{
+   return (int)((const nex_odcobjt *)a)->index - (int)((const nex_odcobjt *)b)->index;
+}
+
+/** Index list of a scan, grown as the Object Description List comes in. */
+typedef struct
+{
+   uint8            *buf;
+   uint32           cap;
+   uint32           n;
+} nex_odcindext;
+
+static int nexx_odc_addindex(void *arg, uint16 index)
+{
+   nex_odcindext *list = (nex_odcindext *)arg;
+
+   if ((list->n >= 0xffff) ||
+       !nexx_odc_reserve(&(list->buf), &(list->cap), list->n * sizeof(uint16), sizeof(uint16)))
+   {
+      return -1;
+   }
+   ((uint16 *)list->buf)[list->n++] = index;
+   return 0;
+}
+
+/** Read the object dictionary of a slave over SDO Info. The objects are
+ * read one by one, so the dictionary is not limited to NEX_MAXODLIST.
+ * @return device or NULL if the slave has no dictionary, a request failed
+ * or out of memory */
+static nex_odcdevt *nexx_odc_fetch(nexx_contextt *context, uint16 slave)
+{
+   nex_ODlistt *od;
+   nex_OElistt *oe;
+   nex_odcdevt *dev;
+   nex_odcobjt *obj;
+   nex_odcentryt *entry;
+   nex_odcindext list;
+   uint8 *entries, *pool;
+   uint32 entrycap, poolcap, nentry, poolsize, i;
+   int j;
+   boolean ok;
+
+   dev = NULL;
+   od = (nex_ODlistt *)osal_malloc(sizeof(nex_ODlistt));
+   oe = (nex_OElistt *)osal_malloc(sizeof(nex_OElistt));
+   memset(&list, 0x00, sizeof(list));
+   obj = NULL;
+   entries = NULL;
+   pool = NULL;
+   entrycap = poolcap = nentry = 0;
+   poolsize = 1;
+   if (od && oe && (nexx_readODlist_stream(context, slave, &nexx_odc_addindex, &list) > 0) && list.n)
+   {
+      obj = (nex_odcobjt *)osal_malloc(list.n * sizeof(nex_odcobjt));
+   }
+   ok = (boolean)(obj && nexx_odc_reserve(&pool, &poolcap, 0, 1));
+   if (ok)
+   {
+      pool[0] = 0;
+      /* one object at a time in the first item of the list */
+      memset(od, 0x00, sizeof(nex_ODlistt));
+      od->Slave = slave;
+      od->Entries = 1;
+      for (i = 0; ok && (i < list.n); i++)
+      {
+         od->Index[0] = ((uint16 *)list.buf)[i];
+         memset(oe, 0x00, sizeof(nex_OElistt));
+         if ((nexx_readODdescription(context, 0, od) <= 0) || (nexx_readOE(context, 0, od, oe) <= 0))
+         {
+            ok = FALSE;
+            break;
+         }
+         obj[i].index = od->Index[0];
+         obj[i].datatype = od->DataType[0];
+         obj[i].objectcode = od->ObjectCode[0];
+         obj[i].maxsub = od->MaxSub[0];
+         obj[i].first = nentry;
+         obj[i].nentry = 0;
+         obj[i].name = nexx_odc_addname(&pool, &poolcap, &poolsize, od->Name[0]);
+         for (j = 0; j <= od->MaxSub[0]; j++)
+         {
+            if (!oe->DataType[j] && !oe->BitLength[j])
+            {
+               continue;
+            }
+            if (!nexx_odc_reserve(&entries, &entrycap, nentry * sizeof(nex_odcentryt), sizeof(nex_odcentryt)))
+            {
+               ok = FALSE;
+               break;
+            }
+            entry = (nex_odcentryt *)entries + nentry;
+            entry->subindex = (uint8)j;
+            entry->valueinfo = oe->ValueInfo[j];
+            entry->datatype = oe->DataType[j];
+            entry->bitlength = oe->BitLength[j];
+            entry->access = oe->ObjAccess[j];
+            entry->name = nexx_odc_addname(&pool, &poolcap, &poolsize, oe->Name[j]);
+            obj[i].nentry++;
+            nentry++;
+         }
+      }
+   }
+   if (ok)
+   {
+      dev = nexx_odc_alloc((uint16)list.n, nentry, poolsize);
+      if (dev)
+      {
+         dev->eep_man = context->slavelist[slave].eep_man;
+         dev->eep_id = context->slavelist[slave].eep_id;
+         dev->eep_rev = context->slavelist[slave].eep_rev;
+         memcpy(dev->obj, obj, list.n * sizeof(nex_odcobjt));
+         if (nentry)
+         {
+            memcpy(dev->entry, entries, nentry * sizeof(nex_odcentryt));
+         }
+         memcpy(dev->name, pool, poolsize);
+         qsort(dev->obj, dev->nobj, sizeof(nex_odcobjt), &nexx_odc_cmpobj);
+      }
+   }
+   if (list.buf)
+   {
+      osal_free(list.buf);
+   }
+   if (pool)
+   {
+      osal_free(pool);
+   }
+   if (entries)
+   {
+      osal_free(entries);
+   }
+   if (obj)
+   {
+      osal_free(obj);
+   }
+   if (oe)
+   {
+      osal_free(oe);
+   }
+   if (od)
+   {
+      osal_free(od);
+   }
+   return dev;
+}
+
+OSAL_THREAD_FUNC nexx_odc_thread(void *param)
+{
+   nex_odcscant *scan;
+
+   scan = (nex_odcscant *)param;
+   scan->dev = nexx_odc_fetch(scan->context, scan->slave);
+   scan->running = 0;
+}
+
+/** Add a device read by a scan to the cache. */
+static void nexx_odc_link(nex_odct *odc, nex_odcdevt *dev)
+{
+   if (dev)
+   {
+      dev->next = odc->dev;
+      odc->dev = dev;
+      odc->changed = TRUE;
+   }
+}
+
+/** Initialise an empty cache.
+ *
+ * @param[out] odc            = odc struct
+ */
+void nexx_odc_init(nex_odct *odc)
+{
+   memset(odc, 0x00, sizeof(nex_odct));
+}
+
+/** Free all devices of the cache.
+ *
+ * @param[in]  odc            = odc struct
+ */
+void nexx_odc_free(nex_odct *odc)
+{
+   nex_odcdevt *dev;
+
+   while (odc->dev)
+   {
+      dev = odc->dev;
+      odc->dev = dev->next;
+      osal_free(dev);
+   }
+   odc->changed = FALSE;
+}
+
+static uint8 *nexx_odc_put(uint8 *p, uint32 value, int bytes)
+{
+   int i;
+
+   for (i = 0; i < bytes; i++)
+   {
+      *p++ = (uint8)(value >> (i * 8));
+   }
+   return p;
+}
+
+static const uint8 *nexx_odc_get(const uint8 *p, uint32 *value, int bytes)
+{
+   int i;
+
+   *value = 0;
+   for (i = 0; i < bytes; i++)
+   {
+      *value |= (uint32)(*p++) << (i * 8);
+   }
+   return p;
+}
+
+/** Load the devices of a cache file. Devices already in the cache are kept,
+ * devices of the file with the same identity are skipped.
+ *
+ * @param[in]  odc            = odc struct
+ * @param[in]  fname          = file name
+ * @return number of devices loaded, -1 if the file is missing or invalid
+ */
+int nexx_odc_load(nex_odct *odc, const char *fname)
+{
+   FILE *fp;
+   uint8 *buf;
+   const uint8 *p, *end;
+   nex_odcdevt *dev;
+   uint32 v, ndev, nobj, nentry, namesize, man, id, rev, rest;
+   long size;
+   int loaded, i;
+   uint32 d;
+   boolean valid;
+
+   fp = fopen(fname, "rb");
+   if (!fp)
+   {
+      return -1;
+   }
+   buf = NULL;
+   size = 0;
+   if (!fseek(fp, 0, SEEK_END) && ((size = ftell(fp)) > 0) && !fseek(fp, 0, SEEK_SET))
+   {
+      buf = (uint8 *)osal_malloc((size_t)size);
+   }
+   if (buf && (fread(buf, 1, (size_t)size, fp) != (size_t)size))
+   {
+      osal_free(buf);
+      buf = NULL;
+   }
+   fclose(fp);
+   if (!buf)
+   {
+      return -1;
+   }
+   end = buf + size;
+   valid = (boolean)((size >= 12) && !memcmp(buf, "NEXODC", 7) && (buf[7] == NEX_ODC_VERSION));
+   loaded = 0;
+   ndev = 0;
+   if (valid)
+   {
+      p = nexx_odc_get(buf + 8, &ndev, 4);
+      for (d = 0; valid && (d < ndev); d++)
+      {
+         if ((end - p) < NEX_ODC_DEVSIZE)
+         {
+            valid = FALSE;
+            break;
+         }
+         p = nexx_odc_get(p, &man, 4);
+         p = nexx_odc_get(p, &id, 4);
+         p = nexx_odc_get(p, &rev, 4);
+         p = nexx_odc_get(p, &nobj, 2);
+         p = nexx_odc_get(p, &v, 2);
+         p = nexx_odc_get(p, &nentry, 4);
+         p = nexx_odc_get(p, &namesize, 4);
+         /* each part on its own against the rest of the file, a sum could wrap */
+         rest = (uint32)(end - p);
+         if ((nobj > rest / NEX_ODC_OBJSIZE) ||
+             (nentry > (rest - nobj * NEX_ODC_OBJSIZE) / NEX_ODC_ENTRYSIZE) ||
+             (namesize > (rest - nobj * NEX_ODC_OBJSIZE - nentry * NEX_ODC_ENTRYSIZE)) ||
+             !namesize)
+         {
+            valid = FALSE;
+            break;
+         }
+         if (nexx_odc_find(odc, man, id, rev))
+         {
+            p += nobj * NEX_ODC_OBJSIZE + nentry * NEX_ODC_ENTRYSIZE + namesize;
+            continue;
+         }
+         dev = nexx_odc_alloc((uint16)nobj, nentry, namesize);
+         if (!dev)
+         {
+            break;
+         }
+         dev->eep_man = man;
+         dev->eep_id = id;
+         dev->eep_rev = rev;
+         for (i = 0; i < (int)nobj; i++)
+         {
+            p = nexx_odc_get(p, &v, 2);
+            dev->obj[i].index = (uint16)v;
+            p = nexx_odc_get(p, &v, 2);
+            dev->obj[i].datatype = (uint16)v;
+            dev->obj[i].objectcode = *p++;
+            dev->obj[i].maxsub = *p++;
+            p = nexx_odc_get(p, &v, 2);
+            dev->obj[i].nentry = (uint16)v;
+            p = nexx_odc_get(p, &(dev->obj[i].first), 4);
+            p = nexx_odc_get(p, &(dev->obj[i].name), 4);
+            /* first can be near the uint32 limit, compare without the sum */
+            if ((dev->obj[i].first > nentry) || (dev->obj[i].nentry > (nentry - dev->obj[i].first)) ||
+                (dev->obj[i].name >= namesize))
+            {
+               valid = FALSE;
+            }
+         }
+         for (i = 0; i < (int)nentry; i++)
+         {
+            dev->entry[i].subindex = *p++;
+            dev->entry[i].valueinfo = *p++;
+            p = nexx_odc_get(p, &v, 2);
+            dev->entry[i].datatype = (uint16)v;
+            p = nexx_odc_get(p, &v, 2);
+            dev->entry[i].bitlength = (uint16)v;
+            p = nexx_odc_get(p, &v, 2);
+            dev->entry[i].access = (uint16)v;
+            p = nexx_odc_get(p, &(dev->entry[i].name), 4);
+            if (dev->entry[i].name >= namesize)
+            {
+               valid = FALSE;
+            }
+         }
+         memcpy(dev->name, p, namesize);
+         p += namesize;
+         /* every name must end in the pool */
+         if (!valid || dev->name[namesize - 1])
+         {
+            osal_free(dev);
+            valid = FALSE;
+            break;
+         }
+         dev->next = odc->dev;
+         odc->dev = dev;
+         loaded++;
+      }
+   }
+   osal_free(buf);
+   if (!valid)
+   {
+      return -1;
+   }
+   return loaded;
+}
+
+/** Save all devices of the cache to a file.
+ *
+ * @param[in]  odc            = odc struct
+ * @param[in]  fname          = file name
+ * @return number of devices saved, -1 if the file could not be written
+ */
+int nexx_odc_save(nex_odct *odc, const char *fname)
+{
+   FILE *fp;
+   nex_odcdevt *dev;
+   uint8 rec[NEX_ODC_DEVSIZE], *p;
+   uint32 ndev, i;
+   boolean ok;
+
+   fp = fopen(fname, "wb");
+   if (!fp)
+   {
+      return -1;
+   }
+   ndev = 0;
+   for (dev = odc->dev; dev; dev = dev->next)
+   {
+      ndev++;
+   }
+   memcpy(rec, "NEXODC", 7);
+   rec[7] = NEX_ODC_VERSION;
+   p = nexx_odc_put(rec + 8, ndev, 4);
+   ok = (boolean)(fwrite(rec, 1, p - rec, fp) == (size_t)(p - rec));
+   for (dev = odc->dev; ok && dev; dev = dev->next)
+   {
+      p = nexx_odc_put(rec, dev->eep_man, 4);
+      p = nexx_odc_put(p, dev->eep_id, 4);
+      p = nexx_odc_put(p, dev->eep_rev, 4);
+      p = nexx_odc_put(p, dev->nobj, 2);
+      p = nexx_odc_put(p, 0, 2);
+      p = nexx_odc_put(p, dev->nentry, 4);
+      p = nexx_odc_put(p, dev->namesize, 4);
+      ok = (boolean)(fwrite(rec, 1, p - rec, fp) == (size_t)(p - rec));
+      for (i = 0; ok && (i < dev->nobj); i++)
+      {
+         p = nexx_odc_put(rec, dev->obj[i].index, 2);
+         p = nexx_odc_put(p, dev->obj[i].datatype, 2);
+         *p++ = dev->obj[i].objectcode;
+         *p++ = dev->obj[i].maxsub;
+         p = nexx_odc_put(p, dev->obj[i].nentry, 2);
+         p = nexx_odc_put(p, dev->obj[i].first, 4);
+         p = nexx_odc_put(p, dev->obj[i].name, 4);
+         ok = (boolean)(fwrite(rec, 1, p - rec, fp) == (size_t)(p - rec));
+      }
+      for (i = 0; ok && (i < dev->nentry); i++)
+      {
+         p = rec;
+         *p++ = dev->entry[i].subindex;
+         *p++ = dev->entry[i].valueinfo;
+         p = nexx_odc_put(p, dev->entry[i].datatype, 2);
+         p = nexx_odc_put(p, dev->entry[i].bitlength, 2);
+         p = nexx_odc_put(p, dev->entry[i].access, 2);
+         p = nexx_odc_put(p, dev->entry[i].name, 4);
+         ok = (boolean)(fwrite(rec, 1, p - rec, fp) == (size_t)(p - rec));
+      }
+      ok = (boolean)(ok && (fwrite(dev->name, 1, dev->namesize, fp) == dev->namesize));
+   }
+   if (fclose(fp) || !ok)
+   {
+      return -1;
+   }
+   odc->changed = FALSE;
+   return (int)ndev;
+}
+
+/** Read the object dictionaries of all slaves not in the cache. Each device
+ * type is read once, from the first slave with that identity, by up to
+ * NEX_ODC_MAXT threads in parallel. Call in PRE-OP or higher.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  odc            = odc struct
+ * @return number of devices added
+ */
+int nexx_odc_scan(nexx_contextt *context, nex_odct *odc)
+{
+   nex_odcscant scan[NEX_ODC_MAXT];
+   OSAL_THREAD_HANDLE thread[NEX_ODC_MAXT];
+   nex_slavet *sl, *prev;
+   nex_odcdevt *dev;
+   int added, thrn, running;
+   uint16 slave, i;
+
+   memset(scan, 0x00, sizeof(scan));
+   added = 0;
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if (!(sl->mbx_proto & ECT_MBXPROT_COE) || !(sl->CoEdetails & ECT_COEDET_SDOINFO) ||
+          nexx_odc_find(odc, sl->eep_man, sl->eep_id, sl->eep_rev))
+      {
+         continue;
+      }
+      /* only the first slave of a device type */
+      for (i = 1; i < slave; i++)
+      {
+         prev = &(context->slavelist[i]);
+         if ((prev->eep_man == sl->eep_man) && (prev->eep_id == sl->eep_id) &&
+             (prev->eep_rev == sl->eep_rev) && (prev->mbx_proto & ECT_MBXPROT_COE) &&
+             (prev->CoEdetails & ECT_COEDET_SDOINFO))
+         {
+            break;
+         }
+      }
+      if (i < slave)
+      {
+         continue;
+      }
+      if (NEX_ODC_MAXT <= 1)
+      {
+         /* serialised version */
+         dev = nexx_odc_fetch(context, slave);
+         added += dev ? 1 : 0;
+         nexx_odc_link(odc, dev);
+         continue;
+      }
+      /* multi-threaded version, take a free worker and its result */
+      do
+      {
+         for (thrn = 0; (thrn < NEX_ODC_MAXT) && scan[thrn].running; thrn++)
+         {
+            ;
+         }
+         if (thrn >= NEX_ODC_MAXT)
+         {
+            osal_usleep(1000);
+         }
+      } while (thrn >= NEX_ODC_MAXT);
+      added += scan[thrn].dev ? 1 : 0;
+      nexx_odc_link(odc, scan[thrn].dev);
+      scan[thrn].dev = NULL;
+      scan[thrn].context = context;
+      scan[thrn].slave = slave;
+      scan[thrn].running = 1;
+      if (!osal_thread_create(&(thread[thrn]), 128000, &nexx_odc_thread, &(scan[thrn])))
+      {
+         /* no thread, read it here */
+         scan[thrn].dev = nexx_odc_fetch(context, slave);
+         scan[thrn].running = 0;
+      }
+   }
+   /* wait for all threads to finish */
+   do
+   {
+      running = 0;
+      for (thrn = 0; thrn < NEX_ODC_MAXT; thrn++)
+      {
+         running += scan[thrn].running;
+      }
+      if (running)
+      {
+         osal_usleep(1000);
+      }
+   } while (running);
+   for (thrn = 0; thrn < NEX_ODC_MAXT; thrn++)
+   {
+      added += scan[thrn].dev ? 1 : 0;
+      nexx_odc_link(odc, scan[thrn].dev);
+   }
+   return added;
+}
+
+/** Find a device type in the cache.
+ *
+ * @param[in]  odc            = odc struct
+ * @param[in]  eep_man        = vendor id
+ * @param[in]  eep_id         = product code
+ * @param[in]  eep_rev        = revision
+ * @return device or NULL if not cached
+ */
+const nex_odcdevt *nexx_odc_find(nex_odct *odc, uint32 eep_man, uint32 eep_id, uint32 eep_rev)
+{
+   nex_odcdevt *dev;
+
+   for (dev = odc->dev; dev; dev = dev->next)
+   {
+      if ((dev->eep_man == eep_man) && (dev->eep_id == eep_id) && (dev->eep_rev == eep_rev))
+      {
+         return dev;
+      }
+   }
+   return NULL;
+}
+
+/** Object dictionary of a slave, read and added to the cache if unknown.
+ *
+ * @param[in]  context        = context struct
+ * @param[in]  odc            = odc struct
+ * @param[in]  slave          = slave number
+ * @return device or NULL if the slave has no dictionary
+ */
+const nex_odcdevt *nexx_odc_slave(nexx_contextt *context, nex_odct *odc, uint16 slave)
+{
+   nex_slavet *sl = &(context->slavelist[slave]);
+   const nex_odcdevt *found;
+   nex_odcdevt *dev;
+
+   found = nexx_odc_find(odc, sl->eep_man, sl->eep_id, sl->eep_rev);
+   if (!found && (sl->mbx_proto & ECT_MBXPROT_COE) && (sl->CoEdetails & ECT_COEDET_SDOINFO))
+   {
+      dev = nexx_odc_fetch(context, slave);
+      nexx_odc_link(odc, dev);
+      found = dev;
+   }
+   return found;
+}
+
+/** Find an object of a device.
+ *
+ * @param[in]  dev            = device
+ * @param[in]  index          = object index
+ * @return object or NULL if not in the dictionary
+ */
+const nex_odcobjt *nexx_odc_object(const nex_odcdevt *dev, uint16 index)
+{
+   int lo, hi, mid;
+
+   lo = 0;
+   hi = (int)dev->nobj - 1;
+   while (lo <= hi)
+   {
+      mid = (lo + hi) / 2;
+      if (dev->obj[mid].index == index)
+      {
+         return &(dev->obj[mid]);
+      }
+      if (dev->obj[mid].index < index)
+      {
+         lo = mid + 1;
+      }
+      else
+      {
+         hi = mid - 1;
+      }
+   }
+   return NULL;
+}
+
+/** Find an entry of an object.
+ *
+ * @param[in]  dev            = device
+ * @param[in]  obj            = object of dev
+ * @param[in]  subindex       = subindex
+ * @return entry or NULL if the object has no such entry
+ */
+const nex_odcentryt *nexx_odc_entry(const nex_odcdevt *dev, const nex_odcobjt *obj, uint8 subindex)
+{
+   uint32 i;
+
+   for (i = obj->first; i < (obj->first + obj->nentry); i++)
+   {
+      if (dev->entry[i].subindex == subindex)
+      {
+         return &(dev->entry[i]);
+      }
+   }
+   return NULL;
+}
+
+/** Name of an object or entry.
+ *
+ * @param[in]  dev            = device
+ * @param[in]  name           = name offset of an object or entry of dev
+ * @return zero terminated name, empty if none
+ */
+const char *nexx_odc_name(const nex_odcdevt *dev, uint32 name)
+{
+   return dev->name + name;
+}
+
+#ifdef NEX_VER1
+int nex_odc_scan(nex_odct *odc)
+{
+   return nexx_odc_scan(&nexx_context, odc);
+}
+
+const nex_odcdevt *nex_odc_slave(nex_odct *odc, uint16 slave)
+{
+   return nexx_odc_slave(&nexx_context, odc, slave);
+}
+#endif
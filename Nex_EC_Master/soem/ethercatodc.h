@@ -0,0 +1,100 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatodc.c
+ */
+
+#ifndef _NEX_ECATODC_H
+#define _NEX_ECATODC_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. threads reading object dictionaries in parallel */
+#ifndef NEX_ODC_MAXT
+#define NEX_ODC_MAXT       4
+#endif
+/** file version */
+#define NEX_ODC_VERSION    1
+
+/** one entry (subindex) of an object in the cache */
+typedef struct nex_odcentry
+{
+   uint8            subindex;
+   /** value info, see EtherCAT specification */
+   uint8            valueinfo;
+   uint16           datatype;
+   uint16           bitlength;
+   uint16           access;
+   /** name, offset in the name pool of the device */
+   uint32           name;
+} nex_odcentryt;
+
+/** one object of a device in the cache */
+typedef struct nex_odcobj
+{
+   uint16           index;
+   uint16           datatype;
+   uint8            objectcode;
+   uint8            maxsub;
+   /** entries of the object, entry[first] .. entry[first + nentry - 1] of the device */
+   uint16           nentry;
+   uint32           first;
+   /** name, offset in the name pool of the device */
+   uint32           name;
+} nex_odcobjt;
+
+/** object dictionary of one device type, one allocation */
+typedef struct nex_odcdev
+{
+   /** identity of the device */
+   uint32           eep_man;
+   uint32           eep_id;
+   uint32           eep_rev;
+   /** objects sorted by index */
+   uint16           nobj;
+   nex_odcobjt      *obj;
+   uint32           nentry;
+   nex_odcentryt    *entry;
+   /** zero terminated names, offset 0 is the empty name */
+   uint32           namesize;
+   char             *name;
+   struct nex_odcdev *next;
+} nex_odcdevt;
+
+/** object dictionary cache */
+typedef struct nex_odc
+{
+   /** devices, newest first */
+   nex_odcdevt      *dev;
+   /** TRUE if devices were added since load or save */
+   boolean          changed;
+} nex_odct;
+
+#ifdef NEX_VER1
+int nex_odc_scan(nex_odct *odc);
+const nex_odcdevt *nex_odc_slave(nex_odct *odc, uint16 slave);
+#endif
+
+void nexx_odc_init(nex_odct *odc);
+void nexx_odc_free(nex_odct *odc);
+int nexx_odc_load(nex_odct *odc, const char *fname);
+int nexx_odc_save(nex_odct *odc, const char *fname);
+int nexx_odc_scan(nexx_contextt *context, nex_odct *odc);
+const nex_odcdevt *nexx_odc_find(nex_odct *odc, uint32 eep_man, uint32 eep_id, uint32 eep_rev);
+const nex_odcdevt *nexx_odc_slave(nexx_contextt *context, nex_odct *odc, uint16 slave);
+const nex_odcobjt *nexx_odc_object(const nex_odcdevt *dev, uint16 index);
+const nex_odcentryt *nexx_odc_entry(const nex_odcdevt *dev, const nex_odcobjt *obj, uint8 subindex);
+const char *nexx_odc_name(const nex_odcdevt *dev, uint32 name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATODC_H */
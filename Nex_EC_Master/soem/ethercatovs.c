@@ -0,0 +1,391 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Oversampling demultiplexer.
+ *
+ * Oversampling slaves transfer several samples of a channel per cycle. The
+ * samples are taken at every SYNC0 of the slave and latched as a block at
+ * SYNC1, the last one is the SYNC0 at or before the last SYNC1 before the
+ * frame passed. Each cycle the receive processdata function splits the
+ * samples to one ring per channel and stamps every sample with its DC time,
+ * derived from the DC time of the frame and the SYNC0 and SYNC1 cycle and
+ * shift of the slave. The rings are single producer single consumer, the
+ * processdata thread writes and one application thread reads, without
+ * locks.
+ */
+
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatlayout.h"
+#include "ethercatovs.h"
+
+/** Initialise the demultiplexer of a group. Add the channels with
+ * nexx_ovs_scan() or nexx_ovs_add(), the rings are created when the group
+ * is mapped.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] ovs            = ovs struct
+ * @param[in]  group          = group number
+ * @param[in]  ringsize       = samples per channel ring, rounded up to a power of 2
+ * @return 1
+ */
+int nexx_ovs_init(nexx_contextt *context, nex_ovst *ovs, uint8 group, uint32 ringsize)
+{
+   memset(ovs, 0x00, sizeof(nex_ovst));
+   ovs->context = context;
+   ovs->group = group;
+   ovs->ringsize = 2;
+   while (ovs->ringsize < ringsize)
+   {
+      ovs->ringsize <<= 1;
+   }
+   context->grouplist[group].ovs = ovs;
+
+   return 1;
+}
+
+/** Add a channel, check it against the mapping when the group is mapped.
+ * Refused once the group is mapped, the processdata thread may be running
+ * the rings then. */
+static int nexx_ovs_addchan(nex_ovst *ovs, const nex_ovschant *chan)
+{
+   if (ovs->mem || (ovs->nchan >= NEX_OVS_MAXCHAN) || !chan->nsamples ||
+       ((chan->bitlen != 8) && (chan->bitlen != 16) && (chan->bitlen != 32)))
+   {
+      return 0;
+   }
+   ovs->chan[ovs->nchan++] = *chan;
+   return 1;
+}
+
+/** Find the oversampled channels of the slaves in the group. An object
+ * that is mapped more than once in the inputs of a slave at a constant
+ * distance is taken as one channel, each mapping is one sample. The PDO
+ * mapping is read by SDO or from SII, call in PRE_OP before the group is
+ * mapped. Samples are signed only if the data type says so, entries without
+ * a data type, as from the CoE PDO mapping, are unsigned.
+ *
+ * @param[in]  ovs            = ovs struct
+ * @return number of channels found
+ */
+int nexx_ovs_scan(nex_ovst *ovs)
+{
+   nexx_contextt *context = ovs->context;
+   nex_pdoentryt list[NEX_MAXPDOENTRY];
+   boolean used[NEX_MAXPDOENTRY];
+   nex_ovschant chan;
+   nex_pdoentryt *e, *f;
+   uint32 last;
+   uint16 slave;
+   int i, j, n, found = 0;
+   boolean valid;
+
+   for (slave = 1; slave <= *(context->slavecount); slave++)
+   {
+      if (ovs->group && (ovs->group != context->slavelist[slave].group))
+      {
+         continue;
+      }
+      n = nexx_readPDOentries(context, slave, list, NEX_MAXPDOENTRY);
+      memset(used, 0x00, sizeof(used));
+      for (i = 0; i < n; i++)
+      {
+         e = &(list[i]);
+         if (used[i] || e->output || !e->index)
+         {
+            continue;
+         }
+         memset(&chan, 0x00, sizeof(chan));
+         chan.slave = slave;
+         chan.bitoffset = e->bitoffset;
+         chan.bitlen = e->bitlen;
+         chan.sign = (boolean)((e->datatype == ECT_INTEGER8) || (e->datatype == ECT_INTEGER16) ||
+                               (e->datatype == ECT_INTEGER32));
+         chan.index = e->index;
+         chan.subindex = e->subindex;
+         chan.nsamples = 1;
+         last = e->bitoffset;
+         valid = TRUE;
+         for (j = i + 1; j < n; j++)
+         {
+            f = &(list[j]);
+            if (f->output || (f->index != e->index) || (f->subindex != e->subindex) ||
+                (f->bitlen != e->bitlen))
+            {
+               continue;
+            }
+            used[j] = TRUE;
+            if (chan.nsamples == 1)
+            {
+               chan.stride = (uint16)((f->bitoffset - last) / 8);
+            }
+            if (((f->bitoffset - last) % 8) || ((f->bitoffset - last) != (uint32)chan.stride * 8))
+            {
+               valid = FALSE;
+            }
+            last = f->bitoffset;
+            chan.nsamples++;
+         }
+         if (valid && (chan.nsamples >= NEX_OVS_MINSAMPLES) && nexx_ovs_addchan(ovs, &chan))
+         {
+            found++;
+         }
+      }
+   }
+
+   return found;
+}
+
+/** Add interleaved channels by hand, f.e. for a slave that maps all samples
+ * as one array. Sample k of channel c is at bitoffset + (k * nchan + c) * bitlen.
+ * Call before the group is mapped.
+ *
+ * @param[in]  ovs            = ovs struct
+ * @param[in]  slave          = slave number
+ * @param[in]  bitoffset      = first sample in the inputs of slave
+ * @param[in]  bitlen         = sample length in bits, 8, 16 or 32
+ * @param[in]  sign           = TRUE for signed samples
+ * @param[in]  nchan          = number of interleaved channels
+ * @param[in]  nsamples       = samples per channel per cycle
+ * @return number of channels added
+ */
+int nexx_ovs_add(nex_ovst *ovs, uint16 slave, uint32 bitoffset, uint8 bitlen, boolean sign,
+   uint16 nchan, uint16 nsamples)
+{
+   nex_ovschant chan;
+   uint16 c;
+
+   if ((ovs->nchan + nchan) > NEX_OVS_MAXCHAN)
+   {
+      return 0;
+   }
+   memset(&chan, 0x00, sizeof(chan));
+   chan.slave = slave;
+   chan.bitlen = bitlen;
+   chan.sign = sign;
+   chan.nsamples = nsamples;
+   chan.stride = (uint16)(nchan * bitlen / 8);
+   for (c = 0; c < nchan; c++)
+   {
+      chan.bitoffset = bitoffset + (uint32)c * bitlen;
+      if (!nexx_ovs_addchan(ovs, &chan))
+      {
+         return c;
+      }
+   }
+
+   return nchan;
+}
+
+/** Resolve the channels to the current IOmap and create empty rings. Called
+ * when the group is mapped.
+ *
+ * @param[in]  ovs            = ovs struct
+ * @return number of channels, 0 if a channel does not fit the mapping
+ */
+int nexx_ovs_compile(nex_ovst *ovs)
+{
+   nexx_contextt *context = ovs->context;
+   nex_ovschant *ch;
+   nex_slavet *sl;
+   uint32 bit;
+   int i;
+
+   if (ovs->mem)
+   {
+      osal_free(ovs->mem);
+      ovs->mem = NULL;
+   }
+   memset(ovs->ring, 0x00, sizeof(ovs->ring));
+   memset(ovs->src, 0x00, sizeof(ovs->src));
+   ovs->lasttime = 0;
+   ovs->period = 0;
+   if (!ovs->nchan)
+   {
+      return 0;
+   }
+   for (i = 0; i < ovs->nchan; i++)
+   {
+      ch = &(ovs->chan[i]);
+      if (!ch->slave || (ch->slave > *(context->slavecount)))
+      {
+         return 0;
+      }
+      sl = &(context->slavelist[ch->slave]);
+      bit = sl->Istartbit + ch->bitoffset;
+      if (!sl->inputs || (bit % 8) ||
+          ((ch->bitoffset + (uint32)(ch->nsamples - 1) * ch->stride * 8 + ch->bitlen) > sl->Ibits))
+      {
+         return 0;
+      }
+      ovs->src[i] = sl->inputs + (bit / 8);
+   }
+   ovs->mem = (nex_ovssamplet *)osal_malloc(ovs->nchan * ovs->ringsize * sizeof(nex_ovssamplet));
+   if (!ovs->mem)
+   {
+      return 0;
+   }
+   for (i = 0; i < ovs->nchan; i++)
+   {
+      ovs->ring[i].mask = ovs->ringsize - 1;
+      ovs->ring[i].buf = ovs->mem + i * ovs->ringsize;
+   }
+
+   return ovs->nchan;
+}
+
+/** Demultiplex the samples of the last cycle to the rings. Called by the
+ * receive processdata function, a cycle without new DC time is skipped so
+ * lost frames do not repeat samples.
+ *
+ * @param[in]  ovs            = ovs struct
+ */
+void nexx_ovs_run(nex_ovst *ovs)
+{
+   nexx_contextt *context = ovs->context;
+   nex_ovschant *ch;
+   nex_ovsringt *ring;
+   nex_slavet *sl;
+   nex_ovssamplet *s;
+   const uint8 *p;
+   int64 dctime, tlast, interval, period1;
+   uint32 head, space, n, k, u32;
+   int i;
+
+   dctime = *(context->DCtime);
+   if (!ovs->mem || (dctime == ovs->lasttime))
+   {
+      return;
+   }
+   ovs->period = ovs->lasttime ? (dctime - ovs->lasttime) : 0;
+   ovs->lasttime = dctime;
+   for (i = 0; i < ovs->nchan; i++)
+   {
+      ch = &(ovs->chan[i]);
+      ring = &(ovs->ring[i]);
+      sl = &(context->slavelist[ch->slave]);
+      tlast = dctime;
+      interval = ch->interval;
+      if (sl->DCcycle > 0)
+      {
+         /* the block is latched at the last SYNC1 before the frame, DCcycle1
+            after a SYNC0, the last sample is the SYNC0 at or before it */
+         period1 = ((sl->DCcycle1 / sl->DCcycle) + 1) * (int64)sl->DCcycle;
+         tlast -= (dctime - sl->DCshift - sl->DCcycle1) % period1;
+         tlast -= sl->DCcycle1 % sl->DCcycle;
+         if (!interval)
+         {
+            interval = sl->DCcycle;
+         }
+      }
+      else if (!interval)
+      {
+         /* no SYNC0, the samples span the processdata cycle */
+         interval = ovs->period / ch->nsamples;
+      }
+      if (!interval)
+      {
+         /* the time between the samples is not known before the second cycle */
+         continue;
+      }
+      tlast += ch->delay;
+      head = ring->head;
+      space = ovs->ringsize - (head - osal_atomic_load(&(ring->tail)));
+      n = ch->nsamples;
+      if (n > space)
+      {
+         /* keep the stream contiguous, drop the newest */
+         osal_atomic_add(&(ring->overrun), n - space);
+         n = space;
+      }
+      p = ovs->src[i];
+      for (k = 0; k < n; k++, p += ch->stride)
+      {
+         s = &(ring->buf[(head + k) & ring->mask]);
+         s->time = tlast - (int64)(ch->nsamples - 1 - k) * interval;
+         switch (ch->bitlen)
+         {
+            case 8:
+               s->value = ch->sign ? (int64)(int8)p[0] : (int64)p[0];
+               break;
+            case 16:
+               s->value = ch->sign ? (int64)(int16)(p[0] | (p[1] << 8)) : (int64)(uint16)(p[0] | (p[1] << 8));
+               break;
+            default:
+               u32 = (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+               s->value = ch->sign ? (int64)(int32)u32 : (int64)u32;
+               break;
+         }
+      }
+      /* publish the samples */
+      osal_atomic_store(&(ring->head), head + n);
+   }
+}
+
+/** Read samples of a channel from its ring. Only one thread may read a
+ * channel, different channels may be read by different threads.
+ *
+ * @param[in]  ovs            = ovs struct
+ * @param[in]  chan           = channel number
+ * @param[out] sample         = sample buffer
+ * @param[in]  max            = size of sample buffer
+ * @return number of samples read
+ */
+int nexx_ovs_read(nex_ovst *ovs, int chan, nex_ovssamplet *sample, int max)
+{
+   nex_ovsringt *ring;
+   uint32 tail, n, k;
+
+   if ((chan < 0) || (chan >= ovs->nchan) || !ovs->mem || (max <= 0))
+   {
+      return 0;
+   }
+   ring = &(ovs->ring[chan]);
+   tail = ring->tail;
+   n = osal_atomic_load(&(ring->head)) - tail;
+   if (n > (uint32)max)
+   {
+      n = max;
+   }
+   for (k = 0; k < n; k++)
+   {
+      sample[k] = ring->buf[(tail + k) & ring->mask];
+   }
+   /* release the slots */
+   osal_atomic_store(&(ring->tail), tail + n);
+
+   return (int)n;
+}
+
+/** Remove the demultiplexer from the group and release the rings.
+ *
+ * @param[in]  ovs            = ovs struct
+ */
+void nexx_ovs_close(nex_ovst *ovs)
+{
+   if (ovs->context && (ovs->context->grouplist[ovs->group].ovs == ovs))
+   {
+      ovs->context->grouplist[ovs->group].ovs = NULL;
+   }
+   if (ovs->mem)
+   {
+      osal_free(ovs->mem);
+   }
+   ovs->mem = NULL;
+   ovs->nchan = 0;
+}
+
+#ifdef NEX_VER1
+int nex_ovs_init(nex_ovst *ovs, uint8 group, uint32 ringsize)
+{
+   return nexx_ovs_init(&nexx_context, ovs, group, ringsize);
+}
+#endif
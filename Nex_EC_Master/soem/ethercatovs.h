@@ -0,0 +1,118 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatovs.c
+ */
+
+#ifndef _NEX_ECATOVS_H
+#define _NEX_ECATOVS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. oversampled channels of a group */
+#ifndef NEX_OVS_MAXCHAN
+#define NEX_OVS_MAXCHAN    64
+#endif
+/** min. number of samples for an array to be taken as oversampled by the scan */
+#ifndef NEX_OVS_MINSAMPLES
+#define NEX_OVS_MINSAMPLES 2
+#endif
+
+/** one timestamped sample */
+typedef struct nex_ovssample
+{
+   /** DC time of the sample in ns */
+   int64            time;
+   /** raw value, sign extended if the channel is signed */
+   int64            value;
+} nex_ovssamplet;
+
+/** single producer single consumer ring of samples */
+typedef struct nex_ovsring
+{
+   /** next slot to write, only written by the processdata thread */
+   volatile uint32  head;
+   /** next slot to read, only written by the reader */
+   volatile uint32  tail;
+   /** samples dropped because the ring was full */
+   volatile uint32  overrun;
+   /** ring size - 1, size is a power of 2 */
+   uint32           mask;
+   nex_ovssamplet   *buf;
+} nex_ovsringt;
+
+/** one oversampled channel */
+typedef struct nex_ovschan
+{
+   /** slave that provides the samples */
+   uint16           slave;
+   /** first sample, bit in the inputs of slave, must be byte aligned */
+   uint32           bitoffset;
+   /** sample length in bits, 8, 16 or 32 */
+   uint8            bitlen;
+   /** TRUE if the samples are signed */
+   boolean          sign;
+   /** number of samples per cycle */
+   uint16           nsamples;
+   /** distance between samples in bytes */
+   uint16           stride;
+   /** time between samples in ns, 0 = SYNC0 cycle of slave, or the
+    * processdata cycle / nsamples if the slave runs without SYNC0 */
+   int32            interval;
+   /** added to the timestamp in ns, f.e. conversion delay */
+   int32            delay;
+   /** object of the samples, 0 if added by hand */
+   uint16           index;
+   uint8            subindex;
+} nex_ovschant;
+
+/** oversampling demultiplexer of a group */
+typedef struct nex_ovs
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** channels */
+   nex_ovschant     chan[NEX_OVS_MAXCHAN];
+   /** number of channels */
+   int              nchan;
+   /** ring per channel, same index as chan */
+   nex_ovsringt     ring[NEX_OVS_MAXCHAN];
+   /** samples per ring, power of 2 */
+   uint32           ringsize;
+   /** internal, address of first sample per channel, valid after mapping */
+   uint8            *src[NEX_OVS_MAXCHAN];
+   /** internal, DC time of the last demultiplexed cycle */
+   int64            lasttime;
+   /** internal, DC time between the last two cycles, 0 = not known yet */
+   int64            period;
+   /** internal, memory of all rings */
+   nex_ovssamplet   *mem;
+} nex_ovst;
+
+#ifdef NEX_VER1
+int nex_ovs_init(nex_ovst *ovs, uint8 group, uint32 ringsize);
+#endif
+
+int nexx_ovs_init(nexx_contextt *context, nex_ovst *ovs, uint8 group, uint32 ringsize);
+int nexx_ovs_scan(nex_ovst *ovs);
+int nexx_ovs_add(nex_ovst *ovs, uint16 slave, uint32 bitoffset, uint8 bitlen, boolean sign,
+   uint16 nchan, uint16 nsamples);
+int nexx_ovs_compile(nex_ovst *ovs);
+void nexx_ovs_run(nex_ovst *ovs);
+int nexx_ovs_read(nex_ovst *ovs, int chan, nex_ovssamplet *sample, int max);
+void nexx_ovs_close(nex_ovst *ovs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATOVS_H */
@@ -0,0 +1,334 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Lock-free process data exchange.
+ *
+ * The RT thread owns the IOmap. Application threads do not touch it, they
+ * read a consistent copy of the inputs and stage their outputs:
+ *
+ * - After every receive the RT thread copies the group inputs to a snapshot
+ *   protected by a sequence counter (seqlock). Any number of threads can copy
+ *   from it without blocking the RT thread.
+ * - Every slave has a triple buffered output image. One producer thread per
+ *   slave writes and commits it, the RT thread copies the latest committed
+ *   image to the IOmap at the start of the cycle. A commit never waits and
+ *   the RT thread always sees a complete image.
+ */
+
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatpdx.h"
+
+/** Number of output bytes a slave occupies in the IOmap, bit slaves included. */
+static uint16 nexx_pdx_osize(nex_slavet *sl)
+{
+   if (sl->Obytes)
+   {
+      return (uint16)sl->Obytes;
+   }
+   return (uint16)((sl->Ostartbit + sl->Obits + 7) / 8);
+}
+
+/** Number of input bytes a slave occupies in the IOmap, bit slaves included. */
+static uint16 nexx_pdx_isize(nex_slavet *sl)
+{
+   if (sl->Ibytes)
+   {
+      return (uint16)sl->Ibytes;
+   }
+   return (uint16)((sl->Istartbit + sl->Ibits + 7) / 8);
+}
+
+/** Initialise the process data exchange of a mapped group.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] pdx            = exchange struct
+ * @param[in]  group          = group number
+ * @return 1 if successful, 0 if out of memory
+ */
+int nexx_pdx_init(nexx_contextt *context, nex_pdxt *pdx, uint8 group)
+{
+   uint16 slave;
+   uint32 memsize;
+   uint8 *p;
+   nex_slavet *sl;
+   int i;
+
+   memset(pdx, 0x00, sizeof(nex_pdxt));
+   pdx->context = context;
+   pdx->group = group;
+   pdx->Ibytes = context->grouplist[group].Ibytes;
+   pdx->nslave = (uint16)(*(context->slavecount) + 1);
+   memsize = pdx->nslave * sizeof(nex_pdxslavet) + pdx->Ibytes;
+   for (slave = 1; slave < pdx->nslave; slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if ((!group || (group == sl->group)) && sl->Obits)
+      {
+         memsize += 3 * nexx_pdx_osize(sl);
+      }
+   }
+   pdx->mem = osal_malloc(memsize);
+   if (!pdx->mem)
+   {
+      return 0;
+   }
+   memset(pdx->mem, 0x00, memsize);
+   pdx->slave = (nex_pdxslavet *)pdx->mem;
+   p = pdx->mem + pdx->nslave * sizeof(nex_pdxslavet);
+   pdx->inputs = p;
+   p += pdx->Ibytes;
+   for (slave = 1; slave < pdx->nslave; slave++)
+   {
+      sl = &(context->slavelist[slave]);
+      if ((!group || (group == sl->group)) && sl->Obits)
+      {
+         pdx->slave[slave].size = nexx_pdx_osize(sl);
+         for (i = 0; i < 3; i++)
+         {
+            pdx->slave[slave].buf[i] = p;
+            /* start with the outputs as they are now */
+            memcpy(p, sl->outputs, pdx->slave[slave].size);
+            p += pdx->slave[slave].size;
+         }
+         pdx->slave[slave].back = 0;
+         pdx->slave[slave].state = 1;
+         pdx->slave[slave].front = 2;
+         pdx->slave[slave].last = 1;
+      }
+   }
+
+   return 1;
+}
+
+/** Release the buffers of the process data exchange.
+ *
+ * @param[in]  pdx            = exchange struct
+ */
+void nexx_pdx_close(nex_pdxt *pdx)
+{
+   if (pdx->mem)
+   {
+      osal_free(pdx->mem);
+   }
+   pdx->mem = NULL;
+   pdx->slave = NULL;
+   pdx->inputs = NULL;
+}
+
+/** Get the output image of a slave for writing by the producer thread.
+ * The image holds the last committed outputs, so only changed values
+ * need to be written. Only one thread may produce outputs for a slave.
+ *
+ * @param[in]  pdx            = exchange struct
+ * @param[in]  slave          = slave number
+ * @return pointer to output image with the layout of the slave outputs in
+ * the IOmap (bit slaves start at Ostartbit), NULL if slave has no outputs
+ */
+uint8 *nexx_pdx_outputs(nex_pdxt *pdx, uint16 slave)
+{
+   nex_pdxslavet *ps;
+
+   if ((slave >= pdx->nslave) || !pdx->slave[slave].size)
+   {
+      return NULL;
+   }
+   ps = &(pdx->slave[slave]);
+   memcpy(ps->buf[ps->back], ps->buf[ps->last], ps->size);
+
+   return ps->buf[ps->back];
+}
+
+/** Commit the output image of a slave. The RT thread copies it to the
+ * IOmap at the start of the next cycle.
+ *
+ * @param[in]  pdx            = exchange struct
+ * @param[in]  slave          = slave number
+ */
+void nexx_pdx_commit(nex_pdxt *pdx, uint16 slave)
+{
+   nex_pdxslavet *ps;
+   uint32 prev;
+
+   if ((slave >= pdx->nslave) || !pdx->slave[slave].size)
+   {
+      return;
+   }
+   ps = &(pdx->slave[slave]);
+   ps->last = ps->back;
+   prev = osal_atomic_exchange(&(ps->state), ps->back | NEX_PDX_FRESH);
+   ps->back = prev & NEX_PDX_IDXMASK;
+}
+
+/** Copy all committed output images to the IOmap. Called by the RT thread
+ * before sending the processdata.
+ *
+ * @param[in]  pdx            = exchange struct
+ * @return number of slaves with new outputs
+ */
+int nexx_pdx_apply(nex_pdxt *pdx)
+{
+   uint16 slave, i;
+   uint32 prev;
+   uint8 *src, *dst, mask;
+   int bit, firstbit, lastbit, cnt = 0;
+   nex_pdxslavet *ps;
+   nex_slavet *sl;
+
+   for (slave = 1; slave < pdx->nslave; slave++)
+   {
+      ps = &(pdx->slave[slave]);
+      if (!ps->size || !(osal_atomic_load(&(ps->state)) & NEX_PDX_FRESH))
+      {
+         continue;
+      }
+      prev = osal_atomic_exchange(&(ps->state), ps->front);
+      ps->front = prev & NEX_PDX_IDXMASK;
+      sl = &(pdx->context->slavelist[slave]);
+      src = ps->buf[ps->front];
+      dst = sl->outputs;
+      if (sl->Obytes)
+      {
+         memcpy(dst, src, ps->size);
+      }
+      else
+      {
+         /* bit slave, other slaves share the bytes */
+         firstbit = sl->Ostartbit;
+         lastbit = sl->Ostartbit + sl->Obits - 1;
+         for (i = 0; i < ps->size; i++)
+         {
+            mask = 0;
+            for (bit = 0; bit < 8; bit++)
+            {
+               if (((i * 8 + bit) >= firstbit) && ((i * 8 + bit) <= lastbit))
+               {
+                  mask |= (uint8)(1 << bit);
+               }
+            }
+            dst[i] = (uint8)((dst[i] & ~mask) | (src[i] & mask));
+         }
+      }
+      cnt++;
+   }
+
+   return cnt;
+}
+
+/** Publish the group inputs to the snapshot. Called by the RT thread after
+ * receiving the processdata.
+ *
+ * @param[in]  pdx            = exchange struct
+ */
+void nexx_pdx_publish(nex_pdxt *pdx)
+{
+   uint32 seq;
+
+   seq = pdx->seq;
+   osal_atomic_store(&(pdx->seq), seq + 1);
+   /* the odd sequence is visible before the copy starts */
+   osal_atomic_fence();
+   memcpy(pdx->inputs, pdx->context->grouplist[pdx->group].inputs, pdx->Ibytes);
+   /* the copy is complete before the even sequence */
+   osal_atomic_fence();
+   osal_atomic_store(&(pdx->seq), seq + 2);
+}
+
+/** Read a consistent copy of the inputs of a slave from any thread.
+ *
+ * @param[in]  pdx            = exchange struct
+ * @param[in]  slave          = slave number, 0 = all inputs of the group
+ * @param[out] dst            = destination buffer, same layout as the IOmap
+ * @param[in]  size           = size of destination buffer
+ * @return number of the cycle the inputs belong to, 0 if none published yet
+ * or the slave has no inputs in the group
+ */
+uint32 nexx_pdx_readinputs(nex_pdxt *pdx, uint16 slave, void *dst, int size)
+{
+   uint32 seq1, seq2, offset, length;
+   nex_slavet *sl;
+
+   if (size < 0)
+   {
+      return 0;
+   }
+   if (slave)
+   {
+      /* slaves of other groups or without inputs have no place in the snapshot */
+      if (slave >= pdx->nslave)
+      {
+         return 0;
+      }
+      sl = &(pdx->context->slavelist[slave]);
+      if ((pdx->group && (pdx->group != sl->group)) || !sl->Ibits || !sl->inputs)
+      {
+         return 0;
+      }
+      offset = (uint32)(sl->inputs - pdx->context->grouplist[pdx->group].inputs);
+      length = nexx_pdx_isize(sl);
+      if ((sl->inputs < pdx->context->grouplist[pdx->group].inputs) ||
+          (offset > pdx->Ibytes) || (length > (pdx->Ibytes - offset)))
+      {
+         return 0;
+      }
+   }
+   else
+   {
+      offset = 0;
+      length = pdx->Ibytes;
+   }
+   if (length > (uint32)size)
+   {
+      length = size;
+   }
+   do
+   {
+      do
+      {
+         seq1 = osal_atomic_load(&(pdx->seq));
+      } while (seq1 & 1);
+      memcpy(dst, pdx->inputs + offset, length);
+      /* the copy is done before the sequence is checked again */
+      osal_atomic_fence();
+      seq2 = osal_atomic_load(&(pdx->seq));
+   } while (seq1 != seq2);
+
+   return seq1 >> 1;
+}
+
+/** One processdata cycle with the exchange: copy the committed outputs,
+ * transmit, receive and publish the inputs.
+ *
+ * @param[in]  pdx            = exchange struct
+ * @param[in]  timeout        = receive timeout in us
+ * @return workcounter or NEX_NOFRAME
+ */
+int nexx_pdx_processdata(nex_pdxt *pdx, int timeout)
+{
+   int wkc;
+
+   nexx_pdx_apply(pdx);
+   nexx_send_processdata_group(pdx->context, pdx->group);
+   wkc = nexx_receive_processdata_group(pdx->context, pdx->group, timeout);
+   if (wkc > 0)
+   {
+      nexx_pdx_publish(pdx);
+   }
+
+   return wkc;
+}
+
+#ifdef NEX_VER1
+int nex_pdx_init(nex_pdxt *pdx, uint8 group)
+{
+   return nexx_pdx_init(&nexx_context, pdx, group);
+}
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatpdx.c
+ */
+
+#ifndef _NEX_ECATPDX_H
+#define _NEX_ECATPDX_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** fresh flag in triple buffer state, lower bits hold the middle buffer */
+#define NEX_PDX_FRESH      0x04
+/** buffer index mask in triple buffer state */
+#define NEX_PDX_IDXMASK    0x03
+
+/** staged outputs of one slave, triple buffered */
+typedef struct nex_pdxslave
+{
+   /** three copies of the slave output image */
+   uint8            *buf[3];
+   /** middle buffer index and fresh flag, shared by producer and RT thread */
+   volatile uint32  state;
+   /** producer, buffer being written */
+   uint32           back;
+   /** producer, buffer committed last */
+   uint32           last;
+   /** RT thread, buffer being copied to IOmap */
+   uint32           front;
+   /** size of output image in bytes, 0 if slave has no outputs */
+   uint16           size;
+} nex_pdxslavet;
+
+/** process data exchange between the RT thread and application threads */
+typedef struct nex_pdx
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** input snapshot sequence, odd while the RT thread updates it */
+   volatile uint32  seq;
+   /** input snapshot of the group */
+   uint8            *inputs;
+   /** size of input snapshot */
+   uint32           Ibytes;
+   /** number of entries in slave */
+   uint16           nslave;
+   /** staged outputs per slave, index is slave number */
+   nex_pdxslavet    *slave;
+   /** internal, memory of all buffers */
+   uint8            *mem;
+} nex_pdxt;
+
+#ifdef NEX_VER1
+int nex_pdx_init(nex_pdxt *pdx, uint8 group);
+#endif
+
+int nexx_pdx_init(nexx_contextt *context, nex_pdxt *pdx, uint8 group);
+void nexx_pdx_close(nex_pdxt *pdx);
+uint8 *nexx_pdx_outputs(nex_pdxt *pdx, uint16 slave);
+void nexx_pdx_commit(nex_pdxt *pdx, uint16 slave);
+int nexx_pdx_apply(nex_pdxt *pdx);
+void nexx_pdx_publish(nex_pdxt *pdx);
+uint32 nexx_pdx_readinputs(nex_pdxt *pdx, uint16 slave, void *dst, int size);
+int nexx_pdx_processdata(nex_pdxt *pdx, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATPDX_H */
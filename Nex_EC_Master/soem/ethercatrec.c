@@ -0,0 +1,477 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Processdata recorder.
+ *
+ * The receive processdata function copies the DC time and the selected
+ * signals of every cycle as one row to a single producer single consumer
+ * ring, a few memcpy without locks or system calls. A writer thread takes
+ * the rows in chunks of NEX_REC_CHUNK, stores them column by column and
+ * compresses each column, so slowly changing signals cost almost nothing.
+ *
+ * File format, all values little endian:
+ * - header: "NEXREC" 0 version(uint8), nsignal(uint32), chunk rows(uint32),
+ *   per signal slave(uint16) output(uint8) 0(uint8) bitoffset(uint32)
+ *   bytes(uint16) 0(uint16) eep_man(uint32) eep_id(uint32).
+ * - chunks: "NRCK"(uint32), rows(uint32), then per column the encoded
+ *   length(uint32) and data. Column 0 is the DC time as zigzag LEB128
+ *   varints of the delta of delta, one per row. Then one column per signal:
+ *   each byte is XOR-ed with the same byte of the previous row (the first
+ *   row of a chunk with 0), stored byte position by byte position for all
+ *   rows, and a 0 is followed by the number of zeros in the run minus 1.
+ */
+
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatrec.h"
+
+#define NEX_REC_CHUNKID    0x4B43524EUL
+
+/** Initialise the recorder of a group. Add the signals with nexx_rec_add(),
+ * they are resolved when the group is mapped.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] rec            = rec struct
+ * @param[in]  group          = group number
+ * @return 1
+ */
+int nexx_rec_init(nexx_contextt *context, nex_rect *rec, uint8 group)
+{
+   memset(rec, 0x00, sizeof(nex_rect));
+   rec->context = context;
+   rec->group = group;
+   context->grouplist[group].rec = rec;
+
+   return 1;
+}
+
+/** Add a signal to record. Signals can only be added before nexx_rec_open().
+ *
+ * @param[in]  rec            = rec struct
+ * @param[in]  slave          = slave number
+ * @param[in]  output         = TRUE for outputs, FALSE for inputs
+ * @param[in]  bitoffset      = first bit in the image of slave, byte aligned
+ * @param[in]  bytes          = length in bytes, 0 = rest of the image of slave
+ * @return number of signals, 0 if full or recording
+ */
+int nexx_rec_add(nex_rect *rec, uint16 slave, boolean output, uint32 bitoffset, uint16 bytes)
+{
+   nex_recsignalt *sig;
+
+   if ((rec->nsignal >= NEX_REC_MAXSIGNAL) || rec->fp)
+   {
+      return 0;
+   }
+   sig = &(rec->signal[rec->nsignal++]);
+   sig->slave = slave;
+   sig->output = output;
+   sig->bitoffset = bitoffset;
+   sig->bytes = bytes;
+   if (rec->context->grouplist[rec->group].nsegments)
+   {
+      nexx_rec_compile(rec);
+   }
+
+   return rec->nsignal;
+}
+
+/** Resolve the signals to the current IOmap. Called when the group is
+ * mapped. If the row size changes while recording, capture stops.
+ *
+ * @param[in]  rec            = rec struct
+ * @return row size in bytes, 0 if a signal does not fit the mapping
+ */
+int nexx_rec_compile(nex_rect *rec)
+{
+   nexx_contextt *context = rec->context;
+   nex_recsignalt *sig;
+   nex_slavet *sl;
+   uint32 bit, nbits, rowsize;
+   uint8 *image;
+   int i;
+
+   rowsize = sizeof(int64);
+   for (i = 0; i < rec->nsignal; i++)
+   {
+      sig = &(rec->signal[i]);
+      rec->src[i] = NULL;
+      rec->len[i] = 0;
+      if (!sig->slave || (sig->slave > *(context->slavecount)))
+      {
+         break;
+      }
+      sl = &(context->slavelist[sig->slave]);
+      image = sig->output ? sl->outputs : sl->inputs;
+      bit = (sig->output ? sl->Ostartbit : sl->Istartbit) + sig->bitoffset;
+      nbits = sig->output ? sl->Obits : sl->Ibits;
+      if (!image || (bit % 8) || (sig->bitoffset >= nbits) ||
+          ((sig->bitoffset + (uint32)sig->bytes * 8) > ((nbits + 7) & ~7U)))
+      {
+         break;
+      }
+      rec->src[i] = image + (bit / 8);
+      rec->len[i] = sig->bytes ? sig->bytes : (uint16)((nbits - sig->bitoffset + 7) / 8);
+      rowsize += rec->len[i];
+   }
+   if (i < rec->nsignal)
+   {
+      osal_atomic_store(&(rec->active), 0);
+      return 0;
+   }
+   if (rec->fp && (rowsize != rec->rowsize))
+   {
+      osal_atomic_store(&(rec->active), 0);
+      return 0;
+   }
+   rec->rowsize = rowsize;
+
+   return (int)rowsize;
+}
+
+/** Write a value little endian to a buffer. */
+static uint8 *nexx_rec_put(uint8 *p, uint64 value, int bytes)
+{
+   int i;
+
+   for (i = 0; i < bytes; i++)
+   {
+      *p++ = (uint8)(value >> (i * 8));
+   }
+   return p;
+}
+
+/** Create the file and the ring. Capture starts now, store the rows with
+ * nexx_rec_flush() or the writer thread of nexx_rec_start().
+ *
+ * @param[in]  rec            = rec struct
+ * @param[in]  fname          = file name
+ * @param[in]  nrows          = rows in ring, rounded up to a power of 2
+ * @return 1 if successful, 0 if the group is not mapped, out of memory or
+ * the file can not be written
+ */
+int nexx_rec_open(nex_rect *rec, const char *fname, uint32 nrows)
+{
+   uint8 head[24], *p;
+   nex_slavet *sl;
+   uint32 size;
+   size_t len;
+   int i;
+   boolean ok;
+
+   if (rec->fp || !rec->nsignal || !nexx_rec_compile(rec))
+   {
+      return 0;
+   }
+   size = NEX_REC_CHUNK;
+   while (size < nrows)
+   {
+      size <<= 1;
+   }
+   rec->mask = size - 1;
+   rec->ring = (uint8 *)osal_malloc(size * rec->rowsize);
+   rec->chunk = (uint8 *)osal_malloc(NEX_REC_CHUNK * rec->rowsize);
+   /* worst case encoding, varint time and every byte a single zero */
+   rec->enc = (uint8 *)osal_malloc(12 + 4 * (rec->nsignal + 1) +
+                                   NEX_REC_CHUNK * (10 + 2 * (rec->rowsize - sizeof(int64))));
+   rec->fp = (rec->ring && rec->chunk && rec->enc) ? fopen(fname, "wb") : NULL;
+   if (!rec->fp)
+   {
+      nexx_rec_close(rec);
+      return 0;
+   }
+   p = nexx_rec_put(head, 0x43455258454EULL, 6);
+   *p++ = 0;
+   *p++ = NEX_REC_VERSION;
+   p = nexx_rec_put(p, rec->nsignal, 4);
+   p = nexx_rec_put(p, NEX_REC_CHUNK, 4);
+   len = (size_t)(p - head);
+   ok = (boolean)(fwrite(head, 1, len, rec->fp) == len);
+   for (i = 0; ok && (i < rec->nsignal); i++)
+   {
+      sl = &(rec->context->slavelist[rec->signal[i].slave]);
+      p = nexx_rec_put(head, rec->signal[i].slave, 2);
+      p = nexx_rec_put(p, rec->signal[i].output, 2);
+      p = nexx_rec_put(p, rec->signal[i].bitoffset, 4);
+      p = nexx_rec_put(p, rec->len[i], 4);
+      p = nexx_rec_put(p, sl->eep_man, 4);
+      p = nexx_rec_put(p, sl->eep_id, 4);
+      len = (size_t)(p - head);
+      ok = (boolean)(fwrite(head, 1, len, rec->fp) == len);
+   }
+   if (!ok)
+   {
+      nexx_rec_close(rec);
+      return 0;
+   }
+   rec->head = 0;
+   rec->tail = 0;
+   rec->dropped = 0;
+   rec->stored = 0;
+   osal_atomic_store(&(rec->active), 1);
+
+   return 1;
+}
+
+/** Capture one row. Called by the receive processdata function.
+ *
+ * @param[in]  rec            = rec struct
+ */
+void nexx_rec_capture(nex_rect *rec)
+{
+   uint32 head;
+   uint8 *row;
+   int i;
+
+   if (!rec->active)
+   {
+      return;
+   }
+   /* counted before active is checked again, close waits for it before
+      the ring is freed */
+   osal_atomic_add(&(rec->capturing), 1);
+   osal_atomic_fence();
+   if (!osal_atomic_load(&(rec->active)))
+   {
+      osal_atomic_add(&(rec->capturing), (uint32)-1);
+      return;
+   }
+   head = rec->head;
+   if ((head - osal_atomic_load(&(rec->tail))) > rec->mask)
+   {
+      osal_atomic_add(&(rec->dropped), 1);
+      osal_atomic_add(&(rec->capturing), (uint32)-1);
+      return;
+   }
+   row = rec->ring + (head & rec->mask) * rec->rowsize;
+   memcpy(row, rec->context->DCtime, sizeof(int64));
+   row += sizeof(int64);
+   for (i = 0; i < rec->nsignal; i++)
+   {
+      memcpy(row, rec->src[i], rec->len[i]);
+      row += rec->len[i];
+   }
+   osal_atomic_store(&(rec->head), head + 1);
+   osal_atomic_add(&(rec->capturing), (uint32)-1);
+}
+
+/** Encode a chunk of rows column by column. */
+static uint32 nexx_rec_encode(nex_rect *rec, uint32 rows)
+{
+   uint8 *p, *lenp, *row;
+   uint64 zz;
+   int64 t, prev = 0, delta, pdelta = 0;
+   uint32 r, off, b, zeros;
+   uint8 x, last;
+   int i;
+
+   p = nexx_rec_put(rec->enc, NEX_REC_CHUNKID, 4);
+   p = nexx_rec_put(p, rows, 4);
+   /* DC time */
+   lenp = p;
+   p += 4;
+   for (r = 0; r < rows; r++)
+   {
+      memcpy(&t, rec->chunk + r * rec->rowsize, sizeof(t));
+      delta = t - prev;
+      zz = (uint64)(delta - pdelta);
+      zz = (zz << 1) ^ (uint64)((delta - pdelta) >> 63);
+      prev = t;
+      pdelta = delta;
+      do
+      {
+         *p++ = (uint8)((zz & 0x7f) | ((zz > 0x7f) ? 0x80 : 0));
+         zz >>= 7;
+      } while (zz);
+   }
+   nexx_rec_put(lenp, (uint32)(p - lenp - 4), 4);
+   /* signals */
+   off = sizeof(int64);
+   for (i = 0; i < rec->nsignal; i++)
+   {
+      lenp = p;
+      p += 4;
+      zeros = 0;
+      for (b = off; b < off + rec->len[i]; b++)
+      {
+         last = 0;
+         row = rec->chunk + b;
+         for (r = 0; r < rows; r++, row += rec->rowsize)
+         {
+            x = *row ^ last;
+            last = *row;
+            if (!x)
+            {
+               if (++zeros == 256)
+               {
+                  *p++ = 0;
+                  *p++ = 255;
+                  zeros = 0;
+               }
+               continue;
+            }
+            if (zeros)
+            {
+               *p++ = 0;
+               *p++ = (uint8)(zeros - 1);
+               zeros = 0;
+            }
+            *p++ = x;
+         }
+      }
+      if (zeros)
+      {
+         *p++ = 0;
+         *p++ = (uint8)(zeros - 1);
+      }
+      nexx_rec_put(lenp, (uint32)(p - lenp - 4), 4);
+      off += rec->len[i];
+   }
+
+   return (uint32)(p - rec->enc);
+}
+
+/** Store captured rows in the file, one chunk at a time.
+ *
+ * @param[in]  rec            = rec struct
+ * @param[in]  all            = FALSE to store full chunks only, TRUE for all rows
+ * @return number of rows stored, NEX_ERROR if the file can not be written,
+ * capture is stopped then
+ */
+int nexx_rec_flush(nex_rect *rec, boolean all)
+{
+   uint32 tail, avail, rows, r, first, len;
+   int stored = 0;
+
+   if (!rec->fp)
+   {
+      return 0;
+   }
+   tail = rec->tail;
+   avail = osal_atomic_load(&(rec->head)) - tail;
+   while ((avail >= NEX_REC_CHUNK) || (all && avail))
+   {
+      rows = (avail > NEX_REC_CHUNK) ? NEX_REC_CHUNK : avail;
+      /* copy out of the ring in up to two parts */
+      first = (rec->mask + 1) - (tail & rec->mask);
+      r = (rows < first) ? rows : first;
+      memcpy(rec->chunk, rec->ring + (tail & rec->mask) * rec->rowsize, r * rec->rowsize);
+      if (r < rows)
+      {
+         memcpy(rec->chunk + r * rec->rowsize, rec->ring, (rows - r) * rec->rowsize);
+      }
+      tail += rows;
+      osal_atomic_store(&(rec->tail), tail);
+      len = nexx_rec_encode(rec, rows);
+      if (fwrite(rec->enc, 1, len, rec->fp) != len)
+      {
+         osal_atomic_store(&(rec->active), 0);
+         return NEX_ERROR;
+      }
+      rec->stored += rows;
+      stored += rows;
+      avail -= rows;
+   }
+
+   return stored;
+}
+
+/** Writer thread, stores full chunks until stopped or the file can not be written. */
+static OSAL_THREAD_FUNC nexx_rec_writer(void *param)
+{
+   nex_rect *rec = (nex_rect *)param;
+   int n;
+
+   while (osal_atomic_load(&(rec->run)))
+   {
+      n = nexx_rec_flush(rec, FALSE);
+      if (n < 0)
+      {
+         break;
+      }
+      if (!n)
+      {
+         osal_usleep(1000);
+      }
+   }
+   osal_atomic_store(&(rec->running), 0);
+}
+
+/** Start a writer thread that stores the rows until nexx_rec_close().
+ *
+ * @param[in]  rec            = rec struct
+ * @return 1 if started
+ */
+int nexx_rec_start(nex_rect *rec)
+{
+   if (!rec->fp || rec->running)
+   {
+      return 0;
+   }
+   osal_atomic_store(&(rec->run), 1);
+   osal_atomic_store(&(rec->running), 1);
+   if (!osal_thread_create(&(rec->thread), 128000, &nexx_rec_writer, rec))
+   {
+      osal_atomic_store(&(rec->run), 0);
+      osal_atomic_store(&(rec->running), 0);
+      return 0;
+   }
+
+   return 1;
+}
+
+/** Stop capture, store the remaining rows and close the file. The recorder
+ * stays attached to the group and can be opened again.
+ *
+ * @param[in]  rec            = rec struct
+ */
+void nexx_rec_close(nex_rect *rec)
+{
+   osal_atomic_store(&(rec->active), 0);
+   osal_atomic_fence();
+   /* a capture that saw active set is still writing the ring */
+   while (osal_atomic_load(&(rec->capturing)))
+   {
+      osal_usleep(100);
+   }
+   osal_atomic_store(&(rec->run), 0);
+   while (osal_atomic_load(&(rec->running)))
+   {
+      osal_usleep(1000);
+   }
+   if (rec->fp)
+   {
+      nexx_rec_flush(rec, TRUE);
+      fclose(rec->fp);
+      rec->fp = NULL;
+   }
+   if (rec->ring)
+   {
+      osal_free(rec->ring);
+   }
+   if (rec->chunk)
+   {
+      osal_free(rec->chunk);
+   }
+   if (rec->enc)
+   {
+      osal_free(rec->enc);
+   }
+   rec->ring = NULL;
+   rec->chunk = NULL;
+   rec->enc = NULL;
+}
+
+#ifdef NEX_VER1
+int nex_rec_init(nex_rect *rec, uint8 group)
+{
+   return nexx_rec_init(&nexx_context, rec, group);
+}
+#endif
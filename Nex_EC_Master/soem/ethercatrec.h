@@ -0,0 +1,106 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatrec.c
+ */
+
+#ifndef _NEX_ECATREC_H
+#define _NEX_ECATREC_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** max. signals of a recorder */
+#ifndef NEX_REC_MAXSIGNAL
+#define NEX_REC_MAXSIGNAL  64
+#endif
+/** rows per compressed chunk in the file */
+#ifndef NEX_REC_CHUNK
+#define NEX_REC_CHUNK      1024
+#endif
+/** file version */
+#define NEX_REC_VERSION    1
+
+/** one recorded signal, a byte range of the inputs or outputs of a slave */
+typedef struct nex_recsignal
+{
+   /** slave number */
+   uint16           slave;
+   /** TRUE for outputs, FALSE for inputs */
+   boolean          output;
+   /** first bit in the inputs or outputs of slave, must be byte aligned */
+   uint32           bitoffset;
+   /** length in bytes, 0 = whole image of the slave from bitoffset */
+   uint16           bytes;
+} nex_recsignalt;
+
+/** processdata recorder of a group */
+typedef struct nex_rec
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** signals */
+   nex_recsignalt   signal[NEX_REC_MAXSIGNAL];
+   /** number of signals */
+   int              nsignal;
+   /** internal, address and length of each signal, valid after mapping */
+   uint8            *src[NEX_REC_MAXSIGNAL];
+   uint16           len[NEX_REC_MAXSIGNAL];
+   /** bytes per row, DC time and all signals */
+   uint32           rowsize;
+   /** rows in ring - 1, ring size is a power of 2 */
+   uint32           mask;
+   /** ring from processdata thread to writer */
+   uint8            *ring;
+   /** next row to write, only written by the processdata thread */
+   volatile uint32  head;
+   /** next row to store, only written by the writer */
+   volatile uint32  tail;
+   /** rows dropped because the ring was full */
+   volatile uint32  dropped;
+   /** rows captured while set */
+   volatile uint32  active;
+   /** number of captures in progress, close waits for 0 */
+   volatile uint32  capturing;
+   /** writer thread runs while set */
+   volatile uint32  run;
+   /** writer thread is running */
+   volatile uint32  running;
+   /** rows stored in the file */
+   uint64           stored;
+   /** file, NULL if not recording */
+   FILE             *fp;
+   /** internal, rows of one chunk and its encoding */
+   uint8            *chunk;
+   uint8            *enc;
+   OSAL_THREAD_HANDLE thread;
+} nex_rect;
+
+#ifdef NEX_VER1
+int nex_rec_init(nex_rect *rec, uint8 group);
+#endif
+
+int nexx_rec_init(nexx_contextt *context, nex_rect *rec, uint8 group);
+int nexx_rec_add(nex_rect *rec, uint16 slave, boolean output, uint32 bitoffset, uint16 bytes);
+int nexx_rec_compile(nex_rect *rec);
+int nexx_rec_open(nex_rect *rec, const char *fname, uint32 nrows);
+void nexx_rec_capture(nex_rect *rec);
+int nexx_rec_flush(nex_rect *rec, boolean all);
+int nexx_rec_start(nex_rect *rec);
+void nexx_rec_close(nex_rect *rec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATREC_H */
@@ -0,0 +1,380 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Master-side processdata routing.
+ *
+ * A routing table copies fields from the inputs of slaves to the outputs of
+ * slaves. At mapping time the table is compiled to a program with the IOmap
+ * pointers resolved: byte aligned fields that are adjacent in both inputs and
+ * outputs are merged to one block copy, other fields become bit field or
+ * scaled copies. The receive processdata function runs the program as soon
+ * as the inputs are in, so the outputs are ready for the next send.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "osal.h"
+#include "oshw.h"
+#include "ethercattype.h"
+#include "ethercatbase.h"
+#include "ethercatmain.h"
+#include "ethercatroute.h"
+
+/** Size in bits of a data type that can be scaled.
+ *
+ * @param[in]  datatype       = data type
+ * @return size in bits, 0 if the type can not be scaled
+ */
+static uint16 nexx_route_typesize(uint16 datatype)
+{
+   switch (datatype)
+   {
+      case ECT_INTEGER8:
+      case ECT_UNSIGNED8:
+         return 8;
+      case ECT_INTEGER16:
+      case ECT_UNSIGNED16:
+         return 16;
+      case ECT_INTEGER32:
+      case ECT_UNSIGNED32:
+      case ECT_REAL32:
+         return 32;
+      default:
+         return 0;
+   }
+}
+
+/** Order of operations, block copies by source address so adjacent ones meet. */
+static int nexx_route_cmp(const void *a, const void *b)
+{
+   const nex_routeopt *opa = (const nex_routeopt *)a;
+   const nex_routeopt *opb = (const nex_routeopt *)b;
+
+   if (opa->type != opb->type)
+   {
+      return (opa->type < opb->type) ? -1 : 1;
+   }
+   if (opa->src != opb->src)
+   {
+      return (opa->src < opb->src) ? -1 : 1;
+   }
+   return 0;
+}
+
+/** Initialise the routing of a group. The program is compiled now if the
+ * group is mapped, and again every time the group is mapped.
+ *
+ * @param[in]  context        = context struct
+ * @param[out] route          = route struct
+ * @param[in]  group          = group number
+ * @param[in]  table          = routing table, must stay valid
+ * @param[in]  nentries       = number of entries in table
+ * @return number of operations, 0 if an entry does not fit the mapping,
+ * number of entries if the group is not mapped yet
+ */
+int nexx_route_init(nexx_contextt *context, nex_routet *route, uint8 group,
+   const nex_routeentryt *table, int nentries)
+{
+   nex_groupt *grp;
+
+   memset(route, 0x00, sizeof(nex_routet));
+   route->context = context;
+   route->group = group;
+   route->table = table;
+   route->nentries = nentries;
+   grp = &(context->grouplist[group]);
+   grp->route = route;
+   if (grp->nsegments && (grp->outputs || grp->inputs))
+   {
+      return nexx_route_compile(route);
+   }
+
+   return nentries;
+}
+
+/** Compile the routing table to a program with the current IOmap pointers.
+ *
+ * @param[in]  route          = route struct
+ * @return number of operations, 0 if an entry does not fit the mapping
+ */
+int nexx_route_compile(nex_routet *route)
+{
+   nexx_contextt *context;
+   const nex_routeentryt *e;
+   nex_slavet *src, *dst;
+   nex_routeopt *op;
+   uint32 sbit, dbit;
+   uint16 chunk, done;
+   int i, n, nop;
+
+   context = route->context;
+   if (route->op)
+   {
+      osal_free(route->op);
+      route->op = NULL;
+   }
+   route->nop = 0;
+   /* bit fields are split in chunks of 32 bits */
+   n = 0;
+   for (i = 0; i < route->nentries; i++)
+   {
+      n += (route->table[i].bitlen + 31) / 32;
+   }
+   if (!n)
+   {
+      return 0;
+   }
+   route->op = (nex_routeopt *)osal_malloc(n * sizeof(nex_routeopt));
+   if (!route->op)
+   {
+      return 0;
+   }
+   memset(route->op, 0x00, n * sizeof(nex_routeopt));
+   nop = 0;
+   for (i = 0; i < route->nentries; i++)
+   {
+      e = &(route->table[i]);
+      if (!e->srcslave || (e->srcslave > *(context->slavecount)) ||
+          !e->dstslave || (e->dstslave > *(context->slavecount)))
+      {
+         break;
+      }
+      src = &(context->slavelist[e->srcslave]);
+      dst = &(context->slavelist[e->dstslave]);
+      if (!e->bitlen || !src->inputs || !dst->outputs ||
+          ((e->srcbit + e->bitlen) > src->Ibits) || ((e->dstbit + e->bitlen) > dst->Obits))
+      {
+         break;
+      }
+      sbit = src->Istartbit + e->srcbit;
+      dbit = dst->Ostartbit + e->dstbit;
+      if (e->datatype)
+      {
+         /* scaled values are byte aligned */
+         if ((sbit % 8) || (dbit % 8) || (e->bitlen != nexx_route_typesize(e->datatype)))
+         {
+            break;
+         }
+         op = &(route->op[nop++]);
+         op->type = NEX_ROUTE_SCALE;
+         op->src = src->inputs + (sbit / 8);
+         op->dst = dst->outputs + (dbit / 8);
+         op->datatype = e->datatype;
+         op->scale = e->scale;
+      }
+      else if (!(sbit % 8) && !(dbit % 8) && !(e->bitlen % 8))
+      {
+         op = &(route->op[nop++]);
+         op->type = NEX_ROUTE_COPY;
+         op->src = src->inputs + (sbit / 8);
+         op->dst = dst->outputs + (dbit / 8);
+         op->length = e->bitlen / 8;
+      }
+      else
+      {
+         for (done = 0; done < e->bitlen; done += chunk)
+         {
+            chunk = e->bitlen - done;
+            if (chunk > 32)
+            {
+               chunk = 32;
+            }
+            op = &(route->op[nop++]);
+            op->type = NEX_ROUTE_BITS;
+            op->src = src->inputs + ((sbit + done) / 8);
+            op->srcbit = (uint8)((sbit + done) % 8);
+            op->dst = dst->outputs + ((dbit + done) / 8);
+            op->dstbit = (uint8)((dbit + done) % 8);
+            op->length = chunk;
+         }
+      }
+   }
+   if (i < route->nentries)
+   {
+      /* entry i does not fit the mapping */
+      osal_free(route->op);
+      route->op = NULL;
+      return 0;
+   }
+   /* merge block copies that are adjacent in inputs and outputs */
+   qsort(route->op, nop, sizeof(nex_routeopt), nexx_route_cmp);
+   n = 0;
+   for (i = 0; i < nop; i++)
+   {
+      if (n > 0)
+      {
+         op = &(route->op[n - 1]);
+         if ((route->op[i].type == NEX_ROUTE_COPY) && (op->type == NEX_ROUTE_COPY) &&
+             ((op->src + op->length) == route->op[i].src) && ((op->dst + op->length) == route->op[i].dst) &&
+             ((op->length + route->op[i].length) <= 0xffff))
+         {
+            op->length += route->op[i].length;
+            continue;
+         }
+      }
+      route->op[n++] = route->op[i];
+   }
+   route->nop = n;
+
+   return n;
+}
+
+/** Copy a bit field of max. 32 bits. */
+static void nexx_route_bits(const nex_routeopt *op)
+{
+   uint64 v = 0, mask;
+   int i, nbytes;
+
+   nbytes = (op->srcbit + op->length + 7) / 8;
+   for (i = 0; i < nbytes; i++)
+   {
+      v |= (uint64)op->src[i] << (i * 8);
+   }
+   mask = ((uint64)1 << op->length) - 1;
+   v = ((v >> op->srcbit) & mask) << op->dstbit;
+   mask <<= op->dstbit;
+   nbytes = (op->dstbit + op->length + 7) / 8;
+   for (i = 0; i < nbytes; i++)
+   {
+      op->dst[i] = (uint8)((op->dst[i] & ~(mask >> (i * 8))) | (v >> (i * 8)));
+   }
+}
+
+/** Copy a value with scaling, the result is rounded and saturated. */
+static void nexx_route_scale(const nex_routeopt *op)
+{
+   float64 v;
+   float32 f;
+   uint16 w;
+   uint32 l;
+
+   switch (op->datatype)
+   {
+      case ECT_INTEGER8:
+         v = (int8)op->src[0];
+         break;
+      case ECT_UNSIGNED8:
+         v = op->src[0];
+         break;
+      case ECT_INTEGER16:
+         memcpy(&w, op->src, sizeof(w));
+         v = (int16)etohs(w);
+         break;
+      case ECT_UNSIGNED16:
+         memcpy(&w, op->src, sizeof(w));
+         v = etohs(w);
+         break;
+      case ECT_INTEGER32:
+         memcpy(&l, op->src, sizeof(l));
+         v = (int32)etohl(l);
+         break;
+      case ECT_UNSIGNED32:
+         memcpy(&l, op->src, sizeof(l));
+         v = etohl(l);
+         break;
+      default:
+         memcpy(&l, op->src, sizeof(l));
+         l = etohl(l);
+         memcpy(&f, &l, sizeof(f));
+         v = f;
+         break;
+   }
+   v *= op->scale;
+   if (op->datatype == ECT_REAL32)
+   {
+      f = (float32)v;
+      memcpy(&l, &f, sizeof(l));
+      l = htoel(l);
+      memcpy(op->dst, &l, sizeof(l));
+      return;
+   }
+   v = (v >= 0) ? (v + 0.5) : (v - 0.5);
+   switch (op->datatype)
+   {
+      case ECT_INTEGER8:
+         v = (v > 127) ? 127 : ((v < -128) ? -128 : v);
+         op->dst[0] = (uint8)(int8)v;
+         break;
+      case ECT_UNSIGNED8:
+         v = (v > 255) ? 255 : ((v < 0) ? 0 : v);
+         op->dst[0] = (uint8)v;
+         break;
+      case ECT_INTEGER16:
+         v = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
+         w = htoes((uint16)(int16)v);
+         memcpy(op->dst, &w, sizeof(w));
+         break;
+      case ECT_UNSIGNED16:
+         v = (v > 65535) ? 65535 : ((v < 0) ? 0 : v);
+         w = htoes((uint16)v);
+         memcpy(op->dst, &w, sizeof(w));
+         break;
+      case ECT_INTEGER32:
+         v = (v > 2147483647.0) ? 2147483647.0 : ((v < -2147483648.0) ? -2147483648.0 : v);
+         l = htoel((uint32)(int32)v);
+         memcpy(op->dst, &l, sizeof(l));
+         break;
+      default:
+         v = (v > 4294967295.0) ? 4294967295.0 : ((v < 0) ? 0 : v);
+         l = htoel((uint32)v);
+         memcpy(op->dst, &l, sizeof(l));
+         break;
+   }
+}
+
+/** Run the routing program. Called by the receive processdata function after
+ * the inputs are copied to the IOmap.
+ *
+ * @param[in]  route          = route struct
+ */
+void nexx_route_run(nex_routet *route)
+{
+   const nex_routeopt *op;
+   int i;
+
+   for (i = 0; i < route->nop; i++)
+   {
+      op = &(route->op[i]);
+      switch (op->type)
+      {
+         case NEX_ROUTE_COPY:
+            memcpy(op->dst, op->src, op->length);
+            break;
+         case NEX_ROUTE_BITS:
+            nexx_route_bits(op);
+            break;
+         default:
+            nexx_route_scale(op);
+            break;
+      }
+   }
+}
+
+/** Remove the routing from the group and release the program.
+ *
+ * @param[in]  route          = route struct
+ */
+void nexx_route_close(nex_routet *route)
+{
+   if (route->context && (route->context->grouplist[route->group].route == route))
+   {
+      route->context->grouplist[route->group].route = NULL;
+   }
+   if (route->op)
+   {
+      osal_free(route->op);
+   }
+   route->op = NULL;
+   route->nop = 0;
+}
+
+#ifdef NEX_VER1
+int nex_route_init(nex_routet *route, uint8 group, const nex_routeentryt *table, int nentries)
+{
+   return nexx_route_init(&nexx_context, route, group, table, nentries);
+}
+#endif
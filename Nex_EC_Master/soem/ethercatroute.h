@@ -0,0 +1,90 @@
+/*
+ * Licensed under the GNU General Public License version 2 with exceptions. See
+ * LICENSE file in the project root for full license information
+ */
+
+/** \file
+ * \brief
+ * Headerfile for ethercatroute.c
+ */
+
+#ifndef _NEX_ECATROUTE_H
+#define _NEX_ECATROUTE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** route operation, byte copy */
+#define NEX_ROUTE_COPY     0
+/** route operation, bit field copy, max. 32 bits */
+#define NEX_ROUTE_BITS     1
+/** route operation, scaled copy of a value */
+#define NEX_ROUTE_SCALE    2
+
+/** one entry of a routing table, copies inputs of a slave to outputs of a slave */
+typedef struct nex_routeentry
+{
+   /** slave that provides the inputs */
+   uint16           srcslave;
+   /** first bit in the inputs of srcslave */
+   uint32           srcbit;
+   /** slave that receives the outputs */
+   uint16           dstslave;
+   /** first bit in the outputs of dstslave */
+   uint32           dstbit;
+   /** number of bits */
+   uint16           bitlen;
+   /** data type for scaling f.e. ECT_INTEGER16, 0 = copy the bits */
+   uint16           datatype;
+   /** scale factor, destination = source * scale */
+   float32          scale;
+} nex_routeentryt;
+
+/** compiled route operation */
+typedef struct nex_routeop
+{
+   uint8            *src;
+   uint8            *dst;
+   /** length in bytes for NEX_ROUTE_COPY, in bits for NEX_ROUTE_BITS */
+   uint16           length;
+   uint8            srcbit;
+   uint8            dstbit;
+   uint8            type;
+   uint16           datatype;
+   float32          scale;
+} nex_routeopt;
+
+/** master-side processdata routing of a group */
+typedef struct nex_route
+{
+   /** context the group is mapped in */
+   nexx_contextt    *context;
+   /** group number */
+   uint8            group;
+   /** routing table, kept by the application */
+   const nex_routeentryt *table;
+   /** number of entries in table */
+   int              nentries;
+   /** compiled program, valid after mapping */
+   nex_routeopt     *op;
+   /** number of operations in program */
+   int              nop;
+} nex_routet;
+
+#ifdef NEX_VER1
+int nex_route_init(nex_routet *route, uint8 group, const nex_routeentryt *table, int nentries);
+#endif
+
+int nexx_route_init(nexx_contextt *context, nex_routet *route, uint8 group,
+   const nex_routeentryt *table, int nentries);
+int nexx_route_compile(nex_routet *route);
+void nexx_route_run(nex_routet *route);
+void nexx_route_close(nex_routet *route);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NEX_ECATROUTE_H */
@@ -83,16 +83,24 @@ int nexx_SoEread(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 elem
    uint8 *bp;
    uint8 *mp;
    uint16 *errorcode;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    boolean NotLast;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timeout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSoEp = (nex_SoEt *)&MbxIn;
-   SoEp = (nex_SoEt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aSoEp = (nex_SoEt *)MbxIn;
+   SoEp = (nex_SoEt *)MbxOut;
    SoEp->MbxHeader.length = htoes(sizeof(nex_SoEt) - sizeof(nex_mbxheadert));
    SoEp->MbxHeader.address = htoes(0x0000);
    SoEp->MbxHeader.priority = 0x00;
@@ -108,18 +116,18 @@ int nexx_SoEread(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 elem
    SoEp->idn = htoes(idn);
    totalsize = 0;
    bp = p;
-   mp = (uint8 *)&MbxIn + sizeof(nex_SoEt);
+   mp = (uint8 *)MbxIn + sizeof(nex_SoEt);
    NotLast = TRUE;
    /* send SoE request to slave */
-   wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+   wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
    if (wkc > 0) /* succeeded to place mailbox in slave ? */
    {
       while (NotLast)
       {
          /* clean mailboxbuffer */
-         nex_clearmbx(&MbxIn);
+         nexx_mbxclear(context, slave, MbxIn, FALSE);
          /* read slave response */
-         wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+         wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
          if (wkc > 0) /* succeeded to read slave response ? */
          {
             /* slave response should be SoE, ReadRes */
@@ -161,7 +169,7 @@ int nexx_SoEread(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 elem
                    (aSoEp->opCode == ECT_SOE_READRES) &&
                    (aSoEp->error == 1))
                {
-                  mp = (uint8 *)&MbxIn + (etohs(aSoEp->MbxHeader.length) + sizeof(nex_mbxheadert) - sizeof(uint16));
+                  mp = (uint8 *)MbxIn + (etohs(aSoEp->MbxHeader.length) + sizeof(nex_mbxheadert) - sizeof(uint16));
                   errorcode = (uint16 *)mp;
                   nexx_SoEerror(context, slave, idn, *errorcode);
                }
@@ -179,6 +187,8 @@ int nexx_SoEread(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 elem
          }
       }
    }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
@@ -205,16 +215,24 @@ int nexx_SoEwrite(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 ele
    uint8 *mp;
    uint8 *hp;
    uint16 *errorcode;
-   nex_mbxbuft MbxIn, MbxOut;
+   nex_mbxbuft *MbxIn, *MbxOut;
    uint8 cnt;
    boolean NotLast;
 
-   nex_clearmbx(&MbxIn);
+   MbxIn = nexx_mbxget(context);
+   MbxOut = nexx_mbxget(context);
+   if (!MbxIn || !MbxOut)
+   {
+      nexx_mbxput(context, MbxIn);
+      nexx_mbxput(context, MbxOut);
+      return 0;
+   }
+   nexx_mbxclear(context, slave, MbxIn, FALSE);
    /* Empty slave out mailbox if something is in. Timeout set to 0 */
-   wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, 0);
-   nex_clearmbx(&MbxOut);
-   aSoEp = (nex_SoEt *)&MbxIn;
-   SoEp = (nex_SoEt *)&MbxOut;
+   wkc = nexx_mbxreceive(context, slave, MbxIn, 0);
+   nexx_mbxclear(context, slave, MbxOut, TRUE);
+   aSoEp = (nex_SoEt *)MbxIn;
+   SoEp = (nex_SoEt *)MbxOut;
    SoEp->MbxHeader.address = htoes(0x0000);
    SoEp->MbxHeader.priority = 0x00;
    SoEp->opCode = ECT_SOE_WRITEREQ;
@@ -222,7 +240,7 @@ int nexx_SoEwrite(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 ele
    SoEp->driveNo = driveNo;
    SoEp->elementflags = elementflags;
    hp = p;
-   mp = (uint8 *)&MbxOut + sizeof(nex_SoEt);
+   mp = (uint8 *)MbxOut + sizeof(nex_SoEt);
    maxdata = context->slavelist[slave].mbx_l - sizeof(nex_SoEt);
    NotLast = TRUE;
    while (NotLast)
@@ -248,15 +266,15 @@ int nexx_SoEwrite(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 ele
       hp += framedatasize;
       psize -= framedatasize;
       /* send SoE request to slave */
-      wkc = nexx_mbxsend(context, slave, (nex_mbxbuft *)&MbxOut, NEX_TIMEOUTTXM);
+      wkc = nexx_mbxsend(context, slave, MbxOut, NEX_TIMEOUTTXM);
       if (wkc > 0) /* succeeded to place mailbox in slave ? */
       {
          if (!NotLast || !nexx_mbxempty(context, slave, timeout))
          {
             /* clean mailboxbuffer */
-            nex_clearmbx(&MbxIn);
+            nexx_mbxclear(context, slave, MbxIn, FALSE);
             /* read slave response */
-            wkc = nexx_mbxreceive(context, slave, (nex_mbxbuft *)&MbxIn, timeout);
+            wkc = nexx_mbxreceive(context, slave, MbxIn, timeout);
             if (wkc > 0) /* succeeded to read slave response ? */
             {
                NotLast = FALSE;
@@ -276,7 +294,7 @@ int nexx_SoEwrite(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 ele
                       (aSoEp->opCode == ECT_SOE_READRES) &&
                       (aSoEp->error == 1))
                   {
-                     mp = (uint8 *)&MbxIn + (etohs(aSoEp->MbxHeader.length) + sizeof(nex_mbxheadert) - sizeof(uint16));
+                     mp = (uint8 *)MbxIn + (etohs(aSoEp->MbxHeader.length) + sizeof(nex_mbxheadert) - sizeof(uint16));
                      errorcode = (uint16 *)mp;
                      nexx_SoEerror(context, slave, idn, *errorcode);
                   }
@@ -294,6 +312,8 @@ int nexx_SoEwrite(nexx_contextt *context, uint16 slave, uint8 driveNo, uint8 ele
          }
       }
    }
+   nexx_mbxput(context, MbxOut);
+   nexx_mbxput(context, MbxIn);
    return wkc;
 }
 
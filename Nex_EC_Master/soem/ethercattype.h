@@ -45,12 +45,21 @@ extern "C"
 #define NEX_MAXLRWDATA      (NEX_MAXECATFRAME - 14 - 2 - 10 - 2 - 4)
 /** size of DC datagram used in first LRW frame */
 #define NEX_FIRSTDCDATAGRAM 20
+/** size of AL status and AL event datagrams used in first frame */
+#define NEX_FIRSTALDATAGRAM 30
 /** standard frame buffer size in bytes */
 #define NEX_BUFSIZE         NEX_MAXECATFRAME
 /** datagram type EtherCAT */
 #define NEX_ECATTYPE        0x1000
-/** number of frame buffers per channel (tx, rx1 rx2) */
-#define NEX_MAXBUF          16
+/** number of frame buffers per channel (tx, rx1 rx2). Limits the number of
+ * processdata frames in flight, one frame per IO segment. Large IOmaps need
+ * NEX_MAXBUF and NEX_MAXIOSEGMENTS raised, f.e. from the build flags. */
+#ifndef NEX_MAXBUF
+#define NEX_MAXBUF          32
+#endif
+#if NEX_MAXBUF > 255
+#error "NEX_MAXBUF must fit in the 8 bit datagram index"
+#endif
 /** timeout value in us for tx frame to return to rx */
 #define NEX_TIMEOUTRET      2000
 /** timeout value in us for safe data transfer, max. triple retry */
@@ -380,6 +389,7 @@ enum
 enum
 {
    ECT_REG_TYPE        = 0x0000,
+   ECT_REG_FMMUCNT     = 0x0004,
    ECT_REG_PORTDES     = 0x0007,
    ECT_REG_ESCSUP      = 0x0008,
    ECT_REG_STADR       = 0x0010,
@@ -393,6 +403,7 @@ enum
    ECT_REG_ALSTATCODE  = 0x0134,
    ECT_REG_PDICTL      = 0x0140,
    ECT_REG_IRQMASK     = 0x0200,
+   ECT_REG_ALEVENT     = 0x0220,
    ECT_REG_RXERR       = 0x0300,
    ECT_REG_FRXERR      = 0x0308,
    ECT_REG_EPUECNT     = 0x030C,
@@ -0,0 +1,160 @@
+/** \file
+ * \brief Parameter backup file test
+ *
+ * Usage : backup_test [fname]
+ * fname = scratch file, default backup_test.bin
+ *
+ * Restores well formed and malformed backup files into a network without
+ * slaves. A valid file restores no items, every malformed file has to be
+ * rejected with -1 before any object is touched. Needs no network adapter.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ethercat.h"
+
+#define HEADSIZE 16
+
+nex_slavet slavelist[NEX_MAXSLAVE];
+int slavecount;
+nexx_contextt context;
+uint8 file[4096];
+int failed;
+
+uint8 *put(uint8 *p, uint32 value, int bytes)
+{
+   int i;
+
+   for (i = 0; i < bytes; i++)
+   {
+      *p++ = (uint8)(value >> (i * 8));
+   }
+   return p;
+}
+
+/* header with nitem items, returns the first item */
+uint8 *head(uint32 nitem)
+{
+   uint8 *p;
+
+   memset(file, 0x00, sizeof(file));
+   memcpy(file, "NEXBAK", 7);
+   file[7] = NEX_BACKUP_VERSION;
+   p = put(file + 8, 0, 4);
+   p = put(p, nitem, 4);
+   return p;
+}
+
+/* item of slave 1 with size data bytes */
+uint8 *item(uint8 *p, uint32 size)
+{
+   p = put(p, 1, 2);
+   *p++ = ECT_MBXT_COE;
+   *p++ = 1;
+   p = put(p, 0x8000, 2);
+   *p++ = 0;
+   *p++ = 0;
+   p = put(p, 2, 4);
+   p = put(p, 0x1234, 4);
+   p = put(p, 1, 4);
+   p = put(p, size, 4);
+   return p;
+}
+
+int writefile(const char *fname, int size)
+{
+   FILE *fp;
+
+   fp = fopen(fname, "wb");
+   if (!fp)
+   {
+      return 0;
+   }
+   if (size && (fwrite(file, 1, size, fp) != (size_t)size))
+   {
+      fclose(fp);
+      return 0;
+   }
+   return !fclose(fp);
+}
+
+void check(const char *name, const char *fname, int size, int expect)
+{
+   int r;
+
+   if (!writefile(fname, size))
+   {
+      printf("%-40s can not write %s\n", name, fname);
+      failed++;
+      return;
+   }
+   r = nexx_restore(&context, fname, 0, FALSE);
+   printf("%-40s %3d %s\n", name, r, (r == expect) ? "ok" : "FAILED");
+   if (r != expect)
+   {
+      failed++;
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   const char *fname = (argc > 1) ? argv[1] : "backup_test.bin";
+   uint8 *p;
+   int r;
+
+   context.slavelist = slavelist;
+   context.slavecount = &slavecount;
+   slavecount = 0;
+
+   p = head(0);
+   check("empty", fname, (int)(p - file), 0);
+
+   p = item(head(2), 4);
+   p = item(p + 4, 2);
+   check("two items", fname, (int)(p - file) + 2, 0);
+
+   p = item(head(1), 4);
+   check("data cut short", fname, (int)(p - file) + 3, -1);
+
+   p = item(head(1), 4);
+   check("item header cut short", fname, (int)(p - file) - 1, -1);
+
+   p = item(head(2), 4);
+   check("more items than in file", fname, (int)(p - file) + 4, -1);
+
+   /* item allocation of 32-bit targets wraps */
+   p = item(head(0x0AAAAAABUL), 4);
+   check("item count wraps allocation", fname, (int)(p - file) + 4, -1);
+
+   p = item(head(0xFFFFFFFFUL), 4);
+   check("item count max", fname, (int)(p - file) + 4, -1);
+
+   p = item(head(1), NEX_BACKUP_MAXDATA + 1);
+   check("item larger than max data", fname, (int)(p - file) + NEX_BACKUP_MAXDATA + 1, -1);
+
+   p = item(head(1), 0xFFFFFFF0UL);
+   check("item size wraps", fname, (int)(p - file) + 16, -1);
+
+   p = item(head(1), 4);
+   file[7] = NEX_BACKUP_VERSION + 1;
+   check("unknown version", fname, (int)(p - file) + 4, -1);
+
+   p = item(head(1), 4);
+   file[0] = 'X';
+   check("bad magic", fname, (int)(p - file) + 4, -1);
+
+   check("header cut short", fname, HEADSIZE - 1, -1);
+   check("empty file", fname, 0, -1);
+
+   remove(fname);
+   r = nexx_restore(&context, fname, 0, FALSE);
+   printf("%-40s %3d %s\n", "missing file", r, (r == -1) ? "ok" : "FAILED");
+   if (r != -1)
+   {
+      failed++;
+   }
+
+   printf("%s\n", failed ? "FAILED" : "all ok");
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+/** \file
+ * \brief Object dictionary cache file test
+ *
+ * Usage : odc_test [fname]
+ * fname = scratch file, default odc_test.bin
+ *
+ * Loads well formed and malformed cache files. A valid file has to load
+ * and answer object queries, every malformed file has to be rejected with
+ * -1 without reading outside the file. Needs no network adapter.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ethercat.h"
+
+uint8 file[4096];
+int failed;
+
+uint8 *put(uint8 *p, uint32 value, int bytes)
+{
+   int i;
+
+   for (i = 0; i < bytes; i++)
+   {
+      *p++ = (uint8)(value >> (i * 8));
+   }
+   return p;
+}
+
+uint8 *head(uint32 ndev)
+{
+   memset(file, 0x00, sizeof(file));
+   memcpy(file, "NEXODC", 7);
+   file[7] = NEX_ODC_VERSION;
+   return put(file + 8, ndev, 4);
+}
+
+uint8 *dev(uint8 *p, uint32 id, uint32 nobj, uint32 nentry, uint32 namesize)
+{
+   p = put(p, 2, 4);
+   p = put(p, id, 4);
+   p = put(p, 1, 4);
+   p = put(p, nobj, 2);
+   p = put(p, 0, 2);
+   p = put(p, nentry, 4);
+   return put(p, namesize, 4);
+}
+
+uint8 *obj(uint8 *p, uint16 index, uint16 nentry, uint32 first, uint32 name)
+{
+   p = put(p, index, 2);
+   p = put(p, ECT_UNSIGNED16, 2);
+   *p++ = 7;
+   *p++ = 0;
+   p = put(p, nentry, 2);
+   p = put(p, first, 4);
+   return put(p, name, 4);
+}
+
+uint8 *entry(uint8 *p, uint8 subindex, uint32 name)
+{
+   *p++ = subindex;
+   *p++ = 0;
+   p = put(p, ECT_UNSIGNED16, 2);
+   p = put(p, 16, 2);
+   p = put(p, 0x07, 2);
+   return put(p, name, 4);
+}
+
+/* one device 0x1000 "Device type" with subindex 0 "value" */
+uint8 *valid(uint8 *p, uint32 id)
+{
+   p = dev(p, id, 1, 1, 19);
+   p = obj(p, 0x1000, 1, 0, 1);
+   p = entry(p, 0, 13);
+   memcpy(p, "\0Device type\0value", 19);
+   return p + 19;
+}
+
+int writefile(const char *fname, int size)
+{
+   FILE *fp;
+
+   fp = fopen(fname, "wb");
+   if (!fp)
+   {
+      return 0;
+   }
+   if (size && (fwrite(file, 1, size, fp) != (size_t)size))
+   {
+      fclose(fp);
+      return 0;
+   }
+   return !fclose(fp);
+}
+
+void check(const char *name, const char *fname, int size, int expect)
+{
+   nex_odct odc;
+   int r;
+
+   if (!writefile(fname, size))
+   {
+      printf("%-40s can not write %s\n", name, fname);
+      failed++;
+      return;
+   }
+   nexx_odc_init(&odc);
+   r = nexx_odc_load(&odc, fname);
+   nexx_odc_free(&odc);
+   printf("%-40s %3d %s\n", name, r, (r == expect) ? "ok" : "FAILED");
+   if (r != expect)
+   {
+      failed++;
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   const char *fname = (argc > 1) ? argv[1] : "odc_test.bin";
+   const nex_odcdevt *d;
+   const nex_odcobjt *o;
+   const nex_odcentryt *e;
+   nex_odct odc;
+   uint8 *p;
+   int r;
+
+   p = head(0);
+   check("empty", fname, (int)(p - file), 0);
+
+   p = valid(head(1), 1);
+   check("one device", fname, (int)(p - file), 1);
+
+   /* the device has to answer queries */
+   nexx_odc_init(&odc);
+   r = nexx_odc_load(&odc, fname);
+   d = nexx_odc_find(&odc, 2, 1, 1);
+   o = d ? nexx_odc_object(d, 0x1000) : NULL;
+   e = o ? nexx_odc_entry(d, o, 0) : NULL;
+   if ((r != 1) || !e || strcmp(nexx_odc_name(d, o->name), "Device type") ||
+       strcmp(nexx_odc_name(d, e->name), "value") || (e->bitlength != 16))
+   {
+      printf("%-40s FAILED\n", "query");
+      failed++;
+   }
+   else
+   {
+      printf("%-40s     ok\n", "query");
+   }
+   /* a device already in the cache is skipped */
+   r = nexx_odc_load(&odc, fname);
+   printf("%-40s %3d %s\n", "load again", r, (r == 0) ? "ok" : "FAILED");
+   if (r != 0)
+   {
+      failed++;
+   }
+   nexx_odc_free(&odc);
+
+   p = valid(valid(head(2), 1), 2);
+   check("two devices", fname, (int)(p - file), 2);
+
+   p = valid(head(2), 1);
+   check("more devices than in file", fname, (int)(p - file), -1);
+
+   p = valid(head(1), 1);
+   check("name pool cut short", fname, (int)(p - file) - 1, -1);
+
+   p = dev(head(1), 1, 1, 1, 19);
+   check("objects cut short", fname, (int)(p - file) + 8, -1);
+
+   /* parts that wrap to a small sum */
+   p = dev(head(1), 1, 1, 1, 0xFFFFFFE8UL);
+   p = obj(p, 0x1000, 1, 0, 1);
+   p = entry(p, 0, 0);
+   check("name pool size wraps", fname, (int)(p - file) + 8, -1);
+
+   p = dev(head(1), 1, 0xFFFF, 0x15555556UL, 1);
+   check("entry count wraps", fname, (int)(p - file) + 64, -1);
+
+   p = dev(head(1), 1, 0, 0, 0);
+   check("no name pool", fname, (int)(p - file), -1);
+
+   p = dev(head(1), 1, 1, 1, 19);
+   p = obj(p, 0x1000, 2, 0, 1);
+   p = entry(p, 0, 13);
+   memcpy(p, "\0Device type\0value", 19);
+   check("object entries outside device", fname, (int)(p - file) + 19, -1);
+
+   /* first + nentry wraps to a range inside the device */
+   p = dev(head(1), 1, 1, 1, 19);
+   p = obj(p, 0x1000, 1, 0xFFFFFFFFUL, 1);
+   p = entry(p, 0, 13);
+   memcpy(p, "\0Device type\0value", 19);
+   check("entry range wraps", fname, (int)(p - file) + 19, -1);
+
+   p = dev(head(1), 1, 1, 1, 19);
+   p = obj(p, 0x1000, 1, 0, 19);
+   p = entry(p, 0, 13);
+   memcpy(p, "\0Device type\0value", 19);
+   check("object name outside pool", fname, (int)(p - file) + 19, -1);
+
+   p = dev(head(1), 1, 1, 1, 19);
+   p = obj(p, 0x1000, 1, 0, 1);
+   p = entry(p, 0, 100);
+   memcpy(p, "\0Device type\0value", 19);
+   check("entry name outside pool", fname, (int)(p - file) + 19, -1);
+
+   p = dev(head(1), 1, 1, 1, 18);
+   p = obj(p, 0x1000, 1, 0, 1);
+   p = entry(p, 0, 13);
+   memcpy(p, "\0Device type\0value", 18);
+   check("name pool not terminated", fname, (int)(p - file) + 18, -1);
+
+   p = valid(head(1), 1);
+   file[7] = NEX_ODC_VERSION + 1;
+   check("unknown version", fname, (int)(p - file), -1);
+
+   check("header cut short", fname, 11, -1);
+   check("empty file", fname, 0, -1);
+
+   remove(fname);
+   nexx_odc_init(&odc);
+   r = nexx_odc_load(&odc, fname);
+   printf("%-40s %3d %s\n", "missing file", r, (r == -1) ? "ok" : "FAILED");
+   if (r != -1)
+   {
+      failed++;
+   }
+
+   printf("%s\n", failed ? "FAILED" : "all ok");
+   return failed ? 1 : 0;
+}
@@ -46,68 +46,39 @@ void CALLBACK RTthread(UINT uTimerID, UINT uMsg, DWORD_PTR dwUser, DWORD_PTR dw1
 }
 
 
+/* PDO mapping of the drives, written only if the drive holds another one */
+static const nex_PDOobjt DrivePDOobj[] =
+{
+	{ 0x1600, 3, { 0x60400010, 0x607A0020, 0x60B80010 } },//keywords, targetposition, touchproble
+	{ 0x1c12, 1, { 0x1600 } },
+	{ 0x1A00, 7, { 0x603F0010, 0x60410010, 0x60610008, 0x60640020, 0x60B90010, 0x60BA0020, 0x60FD0020 } },
+	{ 0x1c13, 1, { 0x1A00 } },
+};
+
+static const nex_PDOprofilet DrivePDOprofile[] =
+{
+	{ 0, 0, 0, sizeof(DrivePDOobj) / sizeof(DrivePDOobj[0]), DrivePDOobj },//any device
+};
+
 int DM3E556(uint16 slave)
 {
+	const nex_PDOprofilet *profile;
 	int retval;
 	uint8 u8val;
-	uint16 u16val;
-	uint32 u32val;
-	uint16 SM2_PDO_OUT = 0x1600;
-	uint16 SM3_PDO_INPUT = 0x1A00;
-	retval = 0;
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u32val = 0x60400010;//keywords
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x01, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x607A0020;
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x02, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60B80010;
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x03, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-//	u32val = 0x60710010;//target Torque
-//	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x04, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u8val = 3;//
-	retval += nex_SDOwrite(slave, SM2_PDO_OUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, 0x1c12, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u16val = SM2_PDO_OUT;//
-	retval += nex_SDOwrite(slave, 0x1c12, 0x01, FALSE, sizeof(u16val), &u16val, NEX_TIMEOUTRXM);
-	u8val = 1;
-	retval += nex_SDOwrite(slave, 0x1c12, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u32val = 0x603F0010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x01, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60410010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x02, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60610008;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x03, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60640020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x04, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60B90010;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x05, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60BA0020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x06, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u32val = 0x60FD0020;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x07, FALSE, sizeof(u32val), &u32val, NEX_TIMEOUTRXM);
-	u8val = 7;
-	retval += nex_SDOwrite(slave, SM3_PDO_INPUT, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-
-	u8val = 0;
-	retval += nex_SDOwrite(slave, 0x1c13, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
-	u16val = SM3_PDO_INPUT;//
-	retval += nex_SDOwrite(slave, 0x1c13, 0x01, FALSE, sizeof(u16val), &u16val, NEX_TIMEOUTRXM);
-	u8val = 1;
-	retval += nex_SDOwrite(slave, 0x1c13, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
+
+	retval = -1;
+	profile = nex_PDOprofile_find(slave, DrivePDOprofile, sizeof(DrivePDOprofile) / sizeof(DrivePDOprofile[0]));
+	if (profile)
+	{
+		retval = nex_PDOprofile_apply(slave, profile, NEX_TIMEOUTRXM);
+	}
 
 	u8val = 8;//operation model
-	retval += nex_SDOwrite(slave, 0x6060, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
+	nex_SDOwrite(slave, 0x6060, 0x00, FALSE, sizeof(u8val), &u8val, NEX_TIMEOUTRXM);
 
     while(EcatError) printf("%s", nex_elist2string());
 
-    printf("AEP slave %d set, retval = %d\n", slave, retval);
+    printf("AEP slave %d set, PDO objects written = %d\n", slave, retval);
     return 1;
 }
 
@@ -147,6 +118,8 @@ void mastersetup(char *ifname)
          }
 
 
+         /* watch AL status of all slaves in the processdata frame */
+         nex_group[0].ALcheck = TRUE;
          nex_config_map(&IOmap);
 
          nex_configdc();